@@ -22,6 +22,7 @@
 #import "OIDAuthorizationRequest.h"
 #import "OIDAuthorizationResponse.h"
 #import "OIDAuthorizationService.h"
+#import "OIDClientCredentialsTokenManager.h"
 #import "OIDError.h"
 #import "OIDErrorUtilities.h"
 #import "OIDExternalUserAgent.h"
@@ -29,14 +30,19 @@
 #import "OIDExternalUserAgentSession.h"
 #import "OIDGrantTypes.h"
 #import "OIDIDToken.h"
+#import "OIDIntrospectionRequest.h"
+#import "OIDIntrospectionResponse.h"
 #import "OIDRegistrationRequest.h"
 #import "OIDRegistrationResponse.h"
 #import "OIDResponseTypes.h"
+#import "OIDRevocationRequest.h"
 #import "OIDScopes.h"
+#import "OIDScopeSet.h"
 #import "OIDScopeUtilities.h"
 #import "OIDServiceConfiguration.h"
 #import "OIDServiceDiscovery.h"
 #import "OIDTokenRequest.h"
+#import "OIDTokenIntrospector.h"
 #import "OIDTokenResponse.h"
 #import "OIDTokenUtilities.h"
 #import "OIDURLSessionProvider.h"
@@ -18,7 +18,9 @@
 
 // Based on the MiniSOAP Sample
 // https://developer.apple.com/library/mac/samplecode/MiniSOAP/Introduction/Intro.html
-// Modified to limit connections to the loopback interface only.
+// Modified to limit connections to the loopback interface only, and to do
+// its socket I/O on a dedicated thread with kqueue instead of CFSocket and
+// CFStream on the current run loop.
 
 #import <TargetConditionals.h>
 
@@ -27,7 +29,7 @@
 #import <Foundation/Foundation.h>
 #import <CoreServices/CoreServices.h>
 
-@class HTTPConnection, HTTPServerRequest, TCPServer;
+@class HTTPConnection, HTTPRequestParser, HTTPResponseWriter, HTTPServerRequest, TCPServer;
 
 extern NSString * const TCPServerErrorDomain;
 
@@ -53,8 +55,11 @@ typedef enum {
     NSString *name;
     NSString *type;
     uint16_t port;
-    CFSocketRef ipv4socket;
-    CFSocketRef ipv6socket;
+    NSRange portRange;
+    int ipv4socket;
+    int ipv6socket;
+    // YES while new connections are left in the listen backlog
+    BOOL acceptPaused;
     NSNetService *netService;
 }
 
@@ -73,12 +78,27 @@ typedef enum {
 - (uint16_t)port;
 - (void)setPort:(uint16_t)value;
 
+// when not empty, the ports tried in turn by -start: instead of the port, up
+// to the first one that is free on the loopback interface
+- (NSRange)portRange;
+- (void)setPortRange:(NSRange)value;
+
 - (BOOL)start:(NSError **)error;
+
+// starts accepting connections on a socket which is already bound to a
+// loopback address and listening, instead of creating the sockets; on
+// success, the receiver takes ownership of the socket
+- (BOOL)startWithListeningSocket:(int)fd error:(NSError **)error;
 - (BOOL)stop;
 
 - (BOOL)hasIPv4Socket;
 - (BOOL)hasIPv6Socket;
 
+// called on the event loop thread when a new connection comes in, with the
+// connected non-blocking socket, which the receiver takes ownership of; by
+// default, wraps the socket in a stream pair and calls the method below
+- (void)handleNewConnectionFromAddress:(NSData *)addr socket:(int)fd;
+
 // called when a new connection comes in; by default, informs the delegate
 - (void)handleNewConnectionFromAddress:(NSData *)addr
                            inputStream:(NSInputStream *)istr
@@ -92,6 +112,11 @@ typedef enum {
     NSURL *docRoot;
     // Currently active connections spawned from the HTTPServer.
     NSMutableArray<HTTPConnection *> *connections;
+    NSUInteger maxConnections;
+    NSUInteger maxHeaderLength;
+    NSUInteger maxBodyLength;
+    NSTimeInterval idleTimeout;
+    NSTimeInterval headerTimeout;
 }
 
 - (Class)connectionClass;
@@ -99,36 +124,69 @@ typedef enum {
 // a new connection comes in; by default, this is HTTPConnection
 - (void)setConnectionClass:(Class)value;
 
+// The limits below apply to connections accepted after they are set.
+
+// the number of connections served at once; further connections wait in
+// the listen backlog until one of them closes (default 16)
+- (NSUInteger)maxConnections;
+- (void)setMaxConnections:(NSUInteger)value;
+
+// the longest request line and headers accepted, in bytes; longer
+// requests are answered with 431 and the connection closed (default 16 KB)
+- (NSUInteger)maxHeaderLength;
+- (void)setMaxHeaderLength:(NSUInteger)value;
+
+// the longest request body accepted, in bytes; larger bodies are answered
+// with 413 and the connection closed (default 64 KB)
+- (NSUInteger)maxBodyLength;
+- (void)setMaxBodyLength:(NSUInteger)value;
+
+// how long a connection may wait for the next request, or for the client
+// to read a response, before it is closed (default 30 seconds)
+- (NSTimeInterval)idleTimeout;
+- (void)setIdleTimeout:(NSTimeInterval)value;
+
+// how long a client may take to send a request once it has started, before
+// the connection is closed (default 10 seconds)
+- (NSTimeInterval)headerTimeout;
+- (void)setHeaderTimeout:(NSTimeInterval)value;
+
 @end
 
 @interface HTTPServer (HTTPServerDelegateMethods)
-// If the delegate implements this method, this is called 
-// by an HTTPServer when a new connection comes in.  If the
+// If the delegate implements this method, this is called on the event
+// loop thread by an HTTPServer when a new connection comes in.  If the
 // delegate wishes to refuse the connection, then it should
 // invalidate the connection object from within this method.
 - (void)HTTPServer:(HTTPServer *)serv didMakeNewConnection:(HTTPConnection *)conn;
 @end
 
 
-// This class represents each incoming client connection.
-@interface HTTPConnection : NSObject <NSStreamDelegate> {
+// This class represents each incoming client connection.  Its socket I/O
+// happens on the event loop thread.
+@interface HTTPConnection : NSObject {
 @private
     __weak id delegate;
     NSData *peerAddress;
     __weak HTTPServer *server;
     NSMutableArray<HTTPServerRequest *> *requests;
-    NSInputStream *istream;
-    NSOutputStream *ostream;
-    NSMutableData *ibuffer;
-    NSMutableData *obuffer;
+    int sockfd;
+    HTTPRequestParser *parser;
+    HTTPResponseWriter *owriter;
+    // response to a request that could not be parsed, sent after the
+    // responses to the requests before it
+    NSData *errorResponse;
+    NSTimeInterval idleTimeout;
+    NSTimeInterval headerTimeout;
+    int timeoutKind;
     BOOL isValid;
     BOOL firstResponseDone;
+    BOOL inputClosed;
+    BOOL closeWhenIdle;
 }
 
-- (id)initWithPeerAddress:(NSData *)addr
-              inputStream:(NSInputStream *)istr
-             outputStream:(NSOutputStream *)ostr
-                forServer:(HTTPServer *)serv;
+// Takes ownership of the connected non-blocking socket.
+- (id)initWithPeerAddress:(NSData *)addr socket:(int)fd forServer:(HTTPServer *)serv;
 
 - (id)delegate;
 - (void)setDelegate:(id)value;
@@ -141,7 +199,8 @@ typedef enum {
 - (HTTPServerRequest *)nextRequest;
 
 - (BOOL)isValid;
-// shut down the connection
+// shut down the connection; may be called on any thread, and takes effect on
+// the event loop thread
 - (void)invalidate;
 
 // perform the default handling action: GET and HEAD requests for files
@@ -152,6 +211,7 @@ typedef enum {
 
 @interface HTTPConnection (HTTPConnectionDelegateMethods)
 // The "didReceiveRequest:" tells the delegate when a new request comes in.
+// Both methods are called on the main thread.
 - (void)HTTPConnection:(HTTPConnection *)conn didReceiveRequest:(HTTPServerRequest *)mess;
 - (void)HTTPConnection:(HTTPConnection *)conn didSendResponse:(HTTPServerRequest *)mess;
 @end
@@ -166,6 +226,7 @@ typedef enum {
     HTTPConnection *connection;
     CFHTTPMessageRef request;
     CFHTTPMessageRef response;
+    NSData *responseData;
     NSInputStream *responseStream;
 }
 
@@ -176,10 +237,19 @@ typedef enum {
 - (CFHTTPMessageRef)request;
 
 // The response may include a body.  As soon as the response is set,
-// the response may be written out to the network.
+// the response may be written out to the network.  May be called on
+// any thread.
 - (CFHTTPMessageRef)response;
 - (void)setResponse:(CFHTTPMessageRef)value;
 
+// A complete response serialized ahead of time, from the status line to
+// the end of the body, as an alternative to setResponse:.  The bytes are
+// written out as they are, so a response that is sent often can be
+// serialized once and shared between requests.  May be called on any
+// thread.
+- (NSData *)responseData;
+- (void)setResponseData:(NSData *)value;
+
 - (NSInputStream *)responseBodyStream;
 // If there is to be a response body stream (when, say, a big
 // file is to be returned, rather than reading the whole thing
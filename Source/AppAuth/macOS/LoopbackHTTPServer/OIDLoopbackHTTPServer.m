@@ -22,19 +22,1014 @@
 
 #import "OIDLoopbackHTTPServer.h"
 #include <sys/socket.h>
+#include <sys/event.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 // We'll ignore the pointer arithmetic warnings for now.
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpointer-arith"
 
+typedef void (^HTTPEventHandler)(void);
+
+// The maximum number of socket events handled per wait of the event loop.
+static const int kHTTPEventLoopMaxEvents = 64;
+
+static BOOL HTTPSetNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return 0 <= flags && 0 == fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// YES if the last socket call failed only because it would have blocked.
+static BOOL HTTPSocketWouldBlock(void) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+// Runs the socket I/O of all servers and connections on a thread of its own,
+// waiting for socket readiness with kqueue.  Each socket is
+// registered with blocks that are called on the loop thread when it becomes
+// readable or writable, or when a timeout set for it expires.  The
+// registrations, and the sockets themselves, must
+// only be used on the loop thread; other threads get there with
+// performBlock:.
+@interface HTTPEventLoop : NSObject {
+@private
+    int pollfd;
+    int wakefds[2];
+    NSThread *thread;
+    NSMutableDictionary<NSNumber *, HTTPEventHandler> *readHandlers;
+    NSMutableDictionary<NSNumber *, HTTPEventHandler> *writeHandlers;
+    NSMutableDictionary<NSNumber *, NSNumber *> *interests;
+    // system uptimes at which the timeout handlers are due
+    NSMutableDictionary<NSNumber *, NSNumber *> *deadlines;
+    NSMutableDictionary<NSNumber *, HTTPEventHandler> *timeoutHandlers;
+    NSMutableArray<dispatch_block_t> *pendingBlocks;
+}
+
+// The loop shared by all servers, or nil if no loop could be started.
++ (HTTPEventLoop *)sharedLoop;
+
+// Runs the block on the loop thread, after the events being handled.  Blocks
+// run in the order they were added.
+- (void)performBlock:(dispatch_block_t)block;
+
+// YES when called on the loop thread.
+- (BOOL)isLoopThread;
+
+// Registers the handlers of a socket.  No events are delivered until they
+// are requested with setReading:writing:forDescriptor:.
+- (void)addDescriptor:(int)fd
+          readHandler:(HTTPEventHandler)readHandler
+         writeHandler:(HTTPEventHandler)writeHandler;
+
+- (void)setReading:(BOOL)reading writing:(BOOL)writing forDescriptor:(int)fd;
+
+// Calls the handler once if the timeout expires before it is set again.  A
+// timeout of 0 cancels the pending one.
+- (void)setTimeout:(NSTimeInterval)timeout forDescriptor:(int)fd handler:(HTTPEventHandler)handler;
+
+// Unregisters a socket; must be called before the socket is closed.
+- (void)removeDescriptor:(int)fd;
+
+@end
+
+enum {
+    kHTTPEventRead = 1 << 0,
+    kHTTPEventWrite = 1 << 1,
+};
+
+@implementation HTTPEventLoop
+
++ (HTTPEventLoop *)sharedLoop {
+    static HTTPEventLoop *sharedLoop;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        HTTPEventLoop *loop = [[HTTPEventLoop alloc] init];
+        if ([loop start]) {
+            sharedLoop = loop;
+        }
+    });
+    return sharedLoop;
+}
+
+- (id)init {
+    self = [super init];
+    pollfd = -1;
+    wakefds[0] = -1;
+    wakefds[1] = -1;
+    readHandlers = [[NSMutableDictionary alloc] init];
+    writeHandlers = [[NSMutableDictionary alloc] init];
+    interests = [[NSMutableDictionary alloc] init];
+    deadlines = [[NSMutableDictionary alloc] init];
+    timeoutHandlers = [[NSMutableDictionary alloc] init];
+    pendingBlocks = [[NSMutableArray alloc] init];
+    return self;
+}
+
+- (BOOL)start {
+    pollfd = kqueue();
+    if (pollfd < 0) {
+        return NO;
+    }
+    if (0 != pipe(wakefds) || !HTTPSetNonBlocking(wakefds[0]) || !HTTPSetNonBlocking(wakefds[1])) {
+        if (0 <= wakefds[0]) close(wakefds[0]);
+        if (0 <= wakefds[1]) close(wakefds[1]);
+        close(pollfd);
+        return NO;
+    }
+
+    // performBlock: writes a byte to the pipe to interrupt the wait for events.
+    int wakefd = wakefds[0];
+    [self addDescriptor:wakefd readHandler:^{
+        uint8_t drain[64];
+        while (0 < read(wakefd, drain, sizeof(drain))) {}
+    } writeHandler:nil];
+    [self setReading:YES writing:NO forDescriptor:wakefd];
+
+    thread = [[NSThread alloc] initWithTarget:self selector:@selector(run) object:nil];
+    [thread setName:@"AppAuth loopback HTTP server"];
+    [thread start];
+    return YES;
+}
+
+- (void)performBlock:(dispatch_block_t)block {
+    // The loop thread runs the pending blocks after the events it handles,
+    // so only other threads need to wake it up.
+    BOOL wake;
+    @synchronized(pendingBlocks) {
+        wake = (0 == [pendingBlocks count]) && [NSThread currentThread] != thread;
+        [pendingBlocks addObject:[block copy]];
+    }
+    if (wake) {
+        uint8_t byte = 0;
+        write(wakefds[1], &byte, sizeof(byte));
+    }
+}
+
+- (BOOL)isLoopThread {
+    return [NSThread currentThread] == thread;
+}
+
+- (void)addDescriptor:(int)fd
+          readHandler:(HTTPEventHandler)readHandler
+         writeHandler:(HTTPEventHandler)writeHandler {
+    NSNumber *key = @(fd);
+    readHandlers[key] = [readHandler copy];
+    writeHandlers[key] = [writeHandler copy];
+}
+
+- (void)setReading:(BOOL)reading writing:(BOOL)writing forDescriptor:(int)fd {
+    NSNumber *key = @(fd);
+    int current = [interests[key] intValue];
+    int wanted = (reading ? kHTTPEventRead : 0) | (writing ? kHTTPEventWrite : 0);
+    if (current == wanted) {
+        return;
+    }
+    interests[key] = wanted ? @(wanted) : nil;
+    struct kevent changes[2];
+    int count = 0;
+    if ((current ^ wanted) & kHTTPEventRead) {
+        EV_SET(&changes[count++], fd, EVFILT_READ, reading ? EV_ADD : EV_DELETE, 0, 0, NULL);
+    }
+    if ((current ^ wanted) & kHTTPEventWrite) {
+        EV_SET(&changes[count++], fd, EVFILT_WRITE, writing ? EV_ADD : EV_DELETE, 0, 0, NULL);
+    }
+    kevent(pollfd, changes, count, NULL, 0, NULL);
+}
+
+- (void)setTimeout:(NSTimeInterval)timeout forDescriptor:(int)fd handler:(HTTPEventHandler)handler {
+    NSNumber *key = @(fd);
+    if (0 < timeout) {
+        deadlines[key] = @([[NSProcessInfo processInfo] systemUptime] + timeout);
+        timeoutHandlers[key] = [handler copy];
+    } else {
+        [deadlines removeObjectForKey:key];
+        [timeoutHandlers removeObjectForKey:key];
+    }
+}
+
+- (void)removeDescriptor:(int)fd {
+    [self setReading:NO writing:NO forDescriptor:fd];
+    [self setTimeout:0 forDescriptor:fd handler:nil];
+    NSNumber *key = @(fd);
+    [readHandlers removeObjectForKey:key];
+    [writeHandlers removeObjectForKey:key];
+}
+
+// Calls the handlers of the expired timeouts, and returns the time until the
+// next one expires, or -1 if there is none.
+- (NSTimeInterval)fireExpiredTimeouts {
+    NSTimeInterval now = [[NSProcessInfo processInfo] systemUptime];
+    for (NSNumber *key in [deadlines allKeys]) {
+        NSNumber *deadline = deadlines[key];
+        if (deadline && [deadline doubleValue] <= now) {
+            HTTPEventHandler handler = timeoutHandlers[key];
+            [deadlines removeObjectForKey:key];
+            [timeoutHandlers removeObjectForKey:key];
+            if (handler) handler();
+        }
+    }
+    NSTimeInterval next = -1;
+    for (NSNumber *deadline in [deadlines allValues]) {
+        NSTimeInterval remaining = MAX(0, [deadline doubleValue] - now);
+        next = (next < 0) ? remaining : MIN(next, remaining);
+    }
+    return next;
+}
+
+- (void)handleDescriptor:(int)fd readable:(BOOL)readable writable:(BOOL)writable {
+    NSNumber *key = @(fd);
+    if (readable && ([interests[key] intValue] & kHTTPEventRead)) {
+        HTTPEventHandler handler = readHandlers[key];
+        if (handler) handler();
+    }
+    // The read handler may have closed the socket or lost interest in writing.
+    if (writable && ([interests[key] intValue] & kHTTPEventWrite)) {
+        HTTPEventHandler handler = writeHandlers[key];
+        if (handler) handler();
+    }
+}
+
+- (void)run {
+    NSTimeInterval wait = -1;
+    while (YES) {
+        @autoreleasepool {
+            struct kevent events[kHTTPEventLoopMaxEvents];
+            struct timespec timeout;
+            timeout.tv_sec = (time_t)MAX(0, wait);
+            timeout.tv_nsec = (long)((MAX(0, wait) - timeout.tv_sec) * NSEC_PER_SEC);
+            int count = kevent(pollfd, NULL, 0, events, kHTTPEventLoopMaxEvents,
+                               (wait < 0) ? NULL : &timeout);
+            for (int i = 0; i < count; i++) {
+                [self handleDescriptor:(int)events[i].ident
+                              readable:events[i].filter == EVFILT_READ
+                              writable:events[i].filter == EVFILT_WRITE];
+            }
+            NSArray<dispatch_block_t> *blocks;
+            @synchronized(pendingBlocks) {
+                blocks = [pendingBlocks copy];
+                [pendingBlocks removeAllObjects];
+            }
+            for (dispatch_block_t block in blocks) {
+                block();
+            }
+            wait = [self fireExpiredTimeouts];
+            @synchronized(pendingBlocks) {
+                if (0 < [pendingBlocks count]) {
+                    // blocks added by blocks run without waiting for events
+                    wait = 0;
+                }
+            }
+        }
+    }
+}
+
+@end
+
+
+// The size of the pooled I/O buffers.  A request that fits into one buffer,
+// as redirects do, is read and parsed without allocating memory.
+static const NSUInteger kHTTPBufferSize = 16 * 1024;
+
+// The number of free buffers kept for reuse.
+static const NSUInteger kHTTPBufferPoolCapacity = 32;
+
+// Fixed-size I/O buffers shared by all connections.  Connections take a
+// buffer while they have bytes to hold, and give it back as soon as they are
+// idle, so a connection that waits for its next request holds no memory.
+@interface HTTPBufferPool : NSObject {
+@private
+    NSMutableArray<NSMutableData *> *freeBuffers;
+}
+
++ (HTTPBufferPool *)sharedPool;
+
+// Returns a buffer of kHTTPBufferSize bytes.
+- (NSMutableData *)acquireBuffer;
+
+// Takes back a buffer returned by acquireBuffer.
+- (void)releaseBuffer:(NSMutableData *)buffer;
+
+@end
+
+@implementation HTTPBufferPool
+
++ (HTTPBufferPool *)sharedPool {
+    static HTTPBufferPool *sharedPool;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPool = [[HTTPBufferPool alloc] init];
+    });
+    return sharedPool;
+}
+
+- (id)init {
+    self = [super init];
+    freeBuffers = [[NSMutableArray alloc] initWithCapacity:kHTTPBufferPoolCapacity];
+    return self;
+}
+
+- (NSMutableData *)acquireBuffer {
+    @synchronized(freeBuffers) {
+        NSMutableData *buffer = [freeBuffers lastObject];
+        if (buffer) {
+            [freeBuffers removeLastObject];
+            return buffer;
+        }
+    }
+    return [[NSMutableData alloc] initWithLength:kHTTPBufferSize];
+}
+
+- (void)releaseBuffer:(NSMutableData *)buffer {
+    if ([buffer length] != kHTTPBufferSize) {
+        return;
+    }
+    @synchronized(freeBuffers) {
+        if ([freeBuffers count] < kHTTPBufferPoolCapacity) {
+            [freeBuffers addObject:buffer];
+        }
+    }
+}
+
+@end
+
+
+typedef enum {
+    kHTTPRequestParserRequestLine,
+    kHTTPRequestParserHeaders,
+    kHTTPRequestParserBody,
+    kHTTPRequestParserChunkSize,
+    kHTTPRequestParserChunkData,
+    kHTTPRequestParserChunkEnd,
+    kHTTPRequestParserTrailers,
+    kHTTPRequestParserError,
+} HTTPRequestParserState;
+
+// Incrementally parses the HTTP/1.1 requests received on a connection.  The
+// parser keeps its position in the receive buffer across reads, so every byte
+// is scanned for line ends once, and the request line and headers are parsed
+// in place as soon as each line is complete.  Bodies are delimited by their
+// Content-Length, or by the chunked transfer coding.  Bytes are read straight
+// into a pooled buffer, which is only replaced by a larger one of its own
+// for a request that does not fit.
+@interface HTTPRequestParser : NSObject {
+@private
+    // the receive buffer, or nil while no bytes are held
+    NSMutableData *buffer;
+    // number of bytes in the buffer
+    NSUInteger bufferLength;
+    NSUInteger maxHeaderLength;
+    NSUInteger maxBodyLength;
+    // the most bytes a request may take on the wire, including the framing
+    // and trailers of a chunked body, which the buffer never grows beyond
+    NSUInteger maxRequestLength;
+    // offset of the first byte of the request being parsed
+    NSUInteger requestStart;
+    // number of bytes of the request being parsed that were already dropped
+    // from the buffer, as they were parsed
+    NSUInteger droppedLength;
+    // offset of the first byte of the line being parsed
+    NSUInteger lineStart;
+    // offset up to which the line being parsed has been scanned for its end
+    NSUInteger scanOffset;
+    HTTPRequestParserState state;
+    NSInteger errorStatusCode;
+    NSString *method;
+    NSString *target;
+    NSString *version;
+    NSURL *url;
+    NSMutableArray<NSString *> *headerNames;
+    NSMutableArray<NSString *> *headerValues;
+    BOOL hasContentLength;
+    BOOL chunked;
+    NSUInteger contentLength;
+    // the decoded body of a chunked request, and the bytes left in its current chunk
+    NSMutableData *chunkedBody;
+    NSUInteger chunkRemaining;
+}
+
+// The request line and headers of a request may not be longer than
+// maxHeaderLength, and its body not longer than maxBodyLength.  A whole
+// request, including the framing and trailers of a chunked body, may not be
+// longer than both together.
+- (id)initWithMaxHeaderLength:(NSUInteger)maxHeader maxBodyLength:(NSUInteger)maxBody;
+
+// Returns where the next read stores its bytes, and the room there.  A
+// capacity of 0 means that the buffer is at its limit, and that the parser
+// failed; copyNextRequest then reports the error.
+- (void *)readBufferWithCapacity:(NSUInteger *)capacity;
+
+// Adds the bytes the last read stored in the read buffer.
+- (void)didReadLength:(NSUInteger)length;
+
+// Gives the buffer back to the pool if it holds no bytes of a request.
+- (void)releaseBufferIfIdle;
+
+// Returns the next complete request, or NULL if more bytes are needed or the
+// bytes received are not a valid request.  The caller must release the
+// returned message.
+- (CFHTTPMessageRef)copyNextRequest CF_RETURNS_RETAINED;
+
+// YES if bytes of a request that is not complete yet have been received.
+- (BOOL)hasPartialRequest;
+
+// The status code to respond with when the bytes received are not a valid
+// request, or 0.  No further requests can be parsed after an error.
+- (NSInteger)errorStatusCode;
+
+@end
+
+@implementation HTTPRequestParser
+
+- (id)init {
+    return nil;
+}
+
+- (id)initWithMaxHeaderLength:(NSUInteger)maxHeader maxBodyLength:(NSUInteger)maxBody {
+    self = [super init];
+    maxHeaderLength = maxHeader;
+    maxBodyLength = maxBody;
+    maxRequestLength = (maxHeader > NSUIntegerMax - maxBody) ? NSUIntegerMax
+                                                             : maxHeader + maxBody;
+    headerNames = [[NSMutableArray alloc] init];
+    headerValues = [[NSMutableArray alloc] init];
+    state = kHTTPRequestParserRequestLine;
+    return self;
+}
+
+- (NSInteger)errorStatusCode {
+    return errorStatusCode;
+}
+
+- (void)dealloc {
+    [[HTTPBufferPool sharedPool] releaseBuffer:buffer];
+}
+
+- (BOOL)hasPartialRequest {
+    // the parsed bytes of a request may have been dropped before it is complete
+    return requestStart < bufferLength || state != kHTTPRequestParserRequestLine;
+}
+
+- (void *)readBufferWithCapacity:(NSUInteger *)capacity {
+    if (!buffer) {
+        buffer = [[HTTPBufferPool sharedPool] acquireBuffer];
+    }
+    // Drops the requests that were already handed off and, once the headers
+    // of the request being parsed are parsed, its bytes up to the line or
+    // chunk being parsed, so that a chunked body is not held twice.
+    BOOL inHeader = (state == kHTTPRequestParserRequestLine || state == kHTTPRequestParserHeaders);
+    NSUInteger keepStart = inHeader ? requestStart : lineStart;
+    if (0 < keepStart) {
+        NSUInteger remaining = bufferLength - keepStart;
+        if (0 < remaining) {
+            memmove([buffer mutableBytes], [buffer mutableBytes] + keepStart, remaining);
+        }
+        droppedLength += keepStart - requestStart;
+        bufferLength = remaining;
+        lineStart -= keepStart;
+        scanOffset -= keepStart;
+        requestStart = 0;
+    }
+    if (bufferLength == [buffer length]) {
+        // The request does not fit; it continues in a larger buffer of its
+        // own, up to the longest request accepted.  A request that does not
+        // fit even then fails the limits before the buffer is full, so a
+        // full buffer at the limit is only a safeguard.
+        NSUInteger limit = MAX(maxRequestLength, kHTTPBufferSize);
+        if ([buffer length] >= limit) {
+            [self failWithStatusCode:inHeader ? 431 : 413];
+            *capacity = 0;
+            return NULL;
+        }
+        NSUInteger length = ([buffer length] > limit / 2) ? limit : 2 * [buffer length];
+        NSMutableData *larger = [[NSMutableData alloc] initWithLength:length];
+        memcpy([larger mutableBytes], [buffer bytes], bufferLength);
+        [[HTTPBufferPool sharedPool] releaseBuffer:buffer];
+        buffer = larger;
+    }
+    *capacity = [buffer length] - bufferLength;
+    return [buffer mutableBytes] + bufferLength;
+}
+
+- (void)didReadLength:(NSUInteger)length {
+    bufferLength += length;
+}
+
+- (void)releaseBufferIfIdle {
+    if (buffer && ![self hasPartialRequest]) {
+        [[HTTPBufferPool sharedPool] releaseBuffer:buffer];
+        buffer = nil;
+        bufferLength = 0;
+        requestStart = 0;
+        lineStart = 0;
+        scanOffset = 0;
+    }
+}
+
+- (void)failWithStatusCode:(NSInteger)statusCode {
+    state = kHTTPRequestParserError;
+    errorStatusCode = statusCode;
+}
+
+static NSString *HTTPRequestParserString(const uint8_t *bytes, NSUInteger length) {
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSISOLatin1StringEncoding];
+}
+
+// Parses a non-empty string of decimal (or hexadecimal) digits that is not
+// longer than the limit.
+static BOOL HTTPRequestParserParseLength(const uint8_t *digits,
+                                         NSUInteger count,
+                                         BOOL hex,
+                                         NSUInteger limit,
+                                         NSUInteger *length) {
+    if (0 == count) {
+        return NO;
+    }
+    NSUInteger base = hex ? 16 : 10;
+    NSUInteger value = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        uint8_t c = digits[i];
+        NSUInteger digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (hex && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (hex && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return NO;
+        }
+        if (value > (limit - digit) / base) {
+            return NO;
+        }
+        value = value * base + digit;
+    }
+    *length = value;
+    return YES;
+}
+
+- (BOOL)parseRequestLine:(const uint8_t *)line length:(NSUInteger)length {
+    // request-line = method SP request-target SP HTTP-version
+    const uint8_t *firstSpace = memchr(line, ' ', length);
+    if (!firstSpace || firstSpace == line) {
+        return NO;
+    }
+    const uint8_t *lastSpace = line + length - 1;
+    while (lastSpace > firstSpace && *lastSpace != ' ') {
+        lastSpace--;
+    }
+    const uint8_t *targetStart = firstSpace + 1;
+    const uint8_t *versionStart = lastSpace + 1;
+    NSUInteger versionLength = line + length - versionStart;
+    if (lastSpace <= targetStart || versionLength < 5 || 0 != memcmp(versionStart, "HTTP/", 5)) {
+        return NO;
+    }
+    method = HTTPRequestParserString(line, firstSpace - line);
+    target = HTTPRequestParserString(targetStart, lastSpace - targetStart);
+    version = HTTPRequestParserString(versionStart, versionLength);
+    return YES;
+}
+
+- (BOOL)parseHeaderLine:(const uint8_t *)line length:(NSUInteger)length {
+    // header-field = field-name ":" OWS field-value OWS
+    // Obsolete line folding is rejected, as allowed by RFC 7230 section 3.2.4.
+    const uint8_t *colon = memchr(line, ':', length);
+    if (!colon || colon == line || line[0] == ' ' || line[0] == '\t') {
+        [self failWithStatusCode:400];
+        return NO;
+    }
+    const uint8_t *valueStart = colon + 1;
+    const uint8_t *valueEnd = line + length;
+    while (valueStart < valueEnd && (*valueStart == ' ' || *valueStart == '\t')) {
+        valueStart++;
+    }
+    while (valueEnd > valueStart && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) {
+        valueEnd--;
+    }
+    NSString *fieldName = HTTPRequestParserString(line, colon - line);
+    NSString *fieldValue = HTTPRequestParserString(valueStart, valueEnd - valueStart);
+    if (NSOrderedSame == [fieldName caseInsensitiveCompare:@"Content-Length"]) {
+        if (hasContentLength
+            || !HTTPRequestParserParseLength(valueStart, valueEnd - valueStart, NO, NSUIntegerMax,
+                                             &contentLength)) {
+            [self failWithStatusCode:400];
+            return NO;
+        }
+        hasContentLength = YES;
+    } else if (NSOrderedSame == [fieldName caseInsensitiveCompare:@"Transfer-Encoding"]) {
+        // chunked is the only transfer coding a request body can be sent with here
+        if (chunked || NSOrderedSame != [fieldValue caseInsensitiveCompare:@"chunked"]) {
+            [self failWithStatusCode:501];
+            return NO;
+        }
+        chunked = YES;
+    }
+    [headerNames addObject:fieldName];
+    [headerValues addObject:fieldValue];
+    return YES;
+}
+
+// Called once the empty line ending the headers was parsed.
+- (BOOL)finishHeaders {
+    if (chunked && hasContentLength) {
+        // An ambiguous body length is how requests are smuggled (RFC 7230 section 3.3.3).
+        [self failWithStatusCode:400];
+        return NO;
+    }
+    if (contentLength > maxBodyLength) {
+        [self failWithStatusCode:413];
+        return NO;
+    }
+
+    // The request target of a request to the loopback server is normally in
+    // origin-form, so the absolute URL is formed from the Host header.
+    NSString *host = nil;
+    for (NSUInteger i = 0; i < [headerNames count]; i++) {
+        if (NSOrderedSame == [headerNames[i] caseInsensitiveCompare:@"Host"]) {
+            host = headerValues[i];
+            break;
+        }
+    }
+    if ([target hasPrefix:@"/"] && [host length]) {
+        url = [NSURL URLWithString:[NSString stringWithFormat:@"http://%@%@", host, target]];
+    } else {
+        url = [NSURL URLWithString:target];
+    }
+    if (!url) {
+        [self failWithStatusCode:400];
+        return NO;
+    }
+
+    if (chunked) {
+        chunkedBody = [[NSMutableData alloc] init];
+        state = kHTTPRequestParserChunkSize;
+    } else {
+        state = kHTTPRequestParserBody;
+    }
+    return YES;
+}
+
+- (BOOL)parseChunkSizeLine:(const uint8_t *)line length:(NSUInteger)length {
+    // chunk-size [ chunk-ext ] CRLF; extensions are ignored
+    const uint8_t *extension = memchr(line, ';', length);
+    NSUInteger digits = extension ? (NSUInteger)(extension - line) : length;
+    while (0 < digits && (line[digits - 1] == ' ' || line[digits - 1] == '\t')) {
+        digits--;
+    }
+    NSUInteger limit = maxBodyLength - [chunkedBody length];
+    if (!HTTPRequestParserParseLength(line, digits, YES, NSUIntegerMax, &chunkRemaining)) {
+        [self failWithStatusCode:400];
+        return NO;
+    }
+    if (chunkRemaining > limit) {
+        [self failWithStatusCode:413];
+        return NO;
+    }
+    state = (0 == chunkRemaining) ? kHTTPRequestParserTrailers : kHTTPRequestParserChunkData;
+    return YES;
+}
+
+// Parses the line ending at the next LF in the buffer, if any.  NO return
+// means that more bytes are needed, or that the line is not valid.
+- (BOOL)parseLine {
+    const uint8_t *bytes = [buffer bytes];
+    NSUInteger length = bufferLength;
+    const uint8_t *lf = NULL;
+    if (scanOffset < length) {
+        lf = memchr(bytes + scanOffset, '\n', length - scanOffset);
+    }
+    // Request lines and headers are limited as a whole, other lines on their
+    // own, and the chunk framing and trailers along with the whole request.
+    BOOL inHeader = (state == kHTTPRequestParserRequestLine || state == kHTTPRequestParserHeaders);
+    NSUInteger limitStart = inHeader ? requestStart : lineStart;
+    NSUInteger end = lf ? (NSUInteger)(lf - bytes) : length;
+    if (end - limitStart > maxHeaderLength) {
+        [self failWithStatusCode:inHeader ? 431 : 400];
+        return NO;
+    }
+    if (!inHeader && droppedLength + (end - requestStart) > maxRequestLength) {
+        [self failWithStatusCode:413];
+        return NO;
+    }
+    if (!lf) {
+        // The line is incomplete; the next call resumes scanning where this one stopped.
+        scanOffset = length;
+        return NO;
+    }
+
+    NSUInteger nextLineStart = end + 1;
+    NSUInteger lineLength = end - lineStart;
+    if (0 < lineLength && '\r' == bytes[lineStart + lineLength - 1]) {
+        lineLength--;
+    }
+    const uint8_t *line = bytes + lineStart;
+    lineStart = nextLineStart;
+    scanOffset = nextLineStart;
+
+    switch (state) {
+    case kHTTPRequestParserRequestLine:
+        if (0 == lineLength) {
+            // Empty lines ahead of a request line are ignored (RFC 7230 section 3.5).
+            requestStart = nextLineStart;
+            return YES;
+        }
+        if (![self parseRequestLine:line length:lineLength]) {
+            [self failWithStatusCode:400];
+            return NO;
+        }
+        state = kHTTPRequestParserHeaders;
+        return YES;
+    case kHTTPRequestParserHeaders:
+        if (0 == lineLength) {
+            return [self finishHeaders];
+        }
+        return [self parseHeaderLine:line length:lineLength];
+    case kHTTPRequestParserChunkSize:
+        return [self parseChunkSizeLine:line length:lineLength];
+    case kHTTPRequestParserChunkEnd:
+        if (0 != lineLength) {
+            [self failWithStatusCode:400];
+            return NO;
+        }
+        state = kHTTPRequestParserChunkSize;
+        return YES;
+    case kHTTPRequestParserTrailers:
+        // Trailer fields are not needed and are dropped.  The empty line
+        // ending them completes the request, which copyNextRequest checks.
+        if (0 == lineLength) {
+            state = kHTTPRequestParserBody;
+            contentLength = 0;
+        }
+        return YES;
+    default:
+        return NO;
+    }
+}
+
+- (CFHTTPMessageRef)copyNextRequest {
+    while (YES) {
+        if (state == kHTTPRequestParserError) {
+            return NULL;
+        } else if (state == kHTTPRequestParserBody) {
+            if (bufferLength - lineStart < contentLength) {
+                return NULL;
+            }
+            break;
+        } else if (state == kHTTPRequestParserChunkData) {
+            NSUInteger available = MIN(bufferLength - lineStart, chunkRemaining);
+            [chunkedBody appendBytes:[buffer bytes] + lineStart length:available];
+            lineStart += available;
+            scanOffset = lineStart;
+            chunkRemaining -= available;
+            if (0 < chunkRemaining) {
+                return NULL;
+            }
+            state = kHTTPRequestParserChunkEnd;
+        } else if (![self parseLine]) {
+            return NULL;
+        }
+    }
+
+    CFHTTPMessageRef message = CFHTTPMessageCreateRequest(kCFAllocatorDefault,
+                                                          (__bridge CFStringRef)method,
+                                                          (__bridge CFURLRef)url,
+                                                          (__bridge CFStringRef)version);
+    for (NSUInteger i = 0; i < [headerNames count]; i++) {
+        CFHTTPMessageSetHeaderFieldValue(message,
+                                         (__bridge CFStringRef)headerNames[i],
+                                         (__bridge CFStringRef)headerValues[i]);
+    }
+    if (chunkedBody) {
+        CFHTTPMessageSetBody(message, (__bridge CFDataRef)chunkedBody);
+    } else if (0 < contentLength) {
+        NSData *body = [buffer subdataWithRange:NSMakeRange(lineStart, contentLength)];
+        CFHTTPMessageSetBody(message, (__bridge CFDataRef)body);
+    }
+
+    // Starts on the next request, which may already be buffered.
+    requestStart = lineStart + contentLength;
+    droppedLength = 0;
+    lineStart = requestStart;
+    scanOffset = requestStart;
+    state = kHTTPRequestParserRequestLine;
+    method = nil;
+    target = nil;
+    version = nil;
+    url = nil;
+    [headerNames removeAllObjects];
+    [headerValues removeAllObjects];
+    hasContentLength = NO;
+    chunked = NO;
+    contentLength = 0;
+    chunkedBody = nil;
+    return message;
+}
+
+@end
+
+
+// The maximum number of buffers passed to a single sendmsg() call.
+static const int kHTTPResponseWriterMaxSegments = 16;
+
+// Queues the immutable buffers of outgoing responses, such as the serialized
+// headers and the body of each response, and writes them to a socket with
+// scatter/gather I/O.  Partially written buffers are tracked by offset, so
+// no bytes are ever moved or copied.
+@interface HTTPResponseWriter : NSObject {
+@private
+    NSMutableArray<NSData *> *segments;
+    // the pooled buffer each segment is in, or NSNull
+    NSMutableArray *segmentBuffers;
+    // number of bytes of the first segment already written
+    NSUInteger offset;
+}
+
+- (void)appendData:(NSData *)data;
+
+// Queues the first length bytes of a buffer from the HTTPBufferPool, and
+// gives the buffer back to the pool once they are written.
+- (void)appendPooledBuffer:(NSMutableData *)buffer length:(NSUInteger)length;
+
+- (BOOL)hasPendingBytes;
+
+// Writes as many of the queued bytes as the socket accepts.  NO return
+// means that the socket failed for another reason than being full.
+- (BOOL)writeToSocket:(int)fd;
+
+@end
+
+@implementation HTTPResponseWriter
+
+- (id)init {
+    self = [super init];
+    segments = [[NSMutableArray alloc] init];
+    segmentBuffers = [[NSMutableArray alloc] init];
+    return self;
+}
+
+- (void)dealloc {
+    for (id buffer in segmentBuffers) {
+        if (buffer != [NSNull null]) {
+            [[HTTPBufferPool sharedPool] releaseBuffer:buffer];
+        }
+    }
+}
+
+- (void)appendData:(NSData *)data {
+    if (0 < [data length]) {
+        [segments addObject:[data copy]];
+        [segmentBuffers addObject:[NSNull null]];
+    }
+}
+
+- (void)appendPooledBuffer:(NSMutableData *)buffer length:(NSUInteger)length {
+    NSData *segment = [NSData dataWithBytesNoCopy:[buffer mutableBytes]
+                                           length:length
+                                     freeWhenDone:NO];
+    [segments addObject:segment];
+    [segmentBuffers addObject:buffer];
+}
+
+- (BOOL)hasPendingBytes {
+    return 0 < [segments count];
+}
+
+- (BOOL)writeToSocket:(int)fd {
+    while (0 < [segments count]) {
+        struct iovec iov[kHTTPResponseWriterMaxSegments];
+        int count = 0;
+        NSUInteger queued = 0;
+        for (NSData *segment in segments) {
+            NSUInteger skip = (0 == count) ? offset : 0;
+            iov[count].iov_base = (void *)([segment bytes] + skip);
+            iov[count].iov_len = [segment length] - skip;
+            queued += iov[count].iov_len;
+            if (kHTTPResponseWriterMaxSegments == ++count) break;
+        }
+
+        // accepted sockets have SO_NOSIGPIPE set, so a closed peer does not raise SIGPIPE
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t writ = sendmsg(fd, &msg, 0);
+        if (writ < 0) {
+            return HTTPSocketWouldBlock();
+        }
+
+        // drops the segments that were written completely
+        NSUInteger remaining = (NSUInteger)writ;
+        while (0 < remaining) {
+            NSUInteger unwritten = [segments[0] length] - offset;
+            if (remaining < unwritten) {
+                offset += remaining;
+                break;
+            }
+            remaining -= unwritten;
+            offset = 0;
+            [segments removeObjectAtIndex:0];
+            id buffer = segmentBuffers[0];
+            [segmentBuffers removeObjectAtIndex:0];
+            if (buffer != [NSNull null]) {
+                [[HTTPBufferPool sharedPool] releaseBuffer:buffer];
+            }
+        }
+        if ((NSUInteger)writ < queued) {
+            // the socket is full
+            return YES;
+        }
+    }
+    return YES;
+}
+
+@end
+
+// Serializes the status line and the header fields of a response.  The
+// body is written from its own buffer.
+static NSData *HTTPCopyResponseHeaderData(CFHTTPMessageRef response) {
+    NSString *statusLine = (__bridge_transfer NSString *)CFHTTPMessageCopyResponseStatusLine(response);
+    NSDictionary<NSString *, NSString *> *fields =
+        (__bridge_transfer NSDictionary *)CFHTTPMessageCopyAllHeaderFields(response);
+    NSMutableString *header = [NSMutableString stringWithFormat:@"%@\r\n", statusLine];
+    for (NSString *fieldName in fields) {
+        [header appendFormat:@"%@: %@\r\n", fieldName, fields[fieldName]];
+    }
+    [header appendString:@"\r\n"];
+    return [header dataUsingEncoding:NSISOLatin1StringEncoding allowLossyConversion:YES];
+}
+
+
+// Serializes a response without body to a request that could not be parsed,
+// announcing that the connection is closed.
+static NSData *HTTPCopyErrorResponseData(NSInteger statusCode) {
+    CFHTTPMessageRef response = CFHTTPMessageCreateResponse(kCFAllocatorDefault, statusCode, NULL, kCFHTTPVersion1_1);
+    CFHTTPMessageSetHeaderFieldValue(response, CFSTR("Content-Length"), CFSTR("0"));
+    CFHTTPMessageSetHeaderFieldValue(response, CFSTR("Connection"), CFSTR("close"));
+    NSData *data = HTTPCopyResponseHeaderData(response);
+    CFRelease(response);
+    return data;
+}
+
+// YES if the client asked for the connection to be closed after the response
+// to the request, or, with HTTP/1.0, did not ask for it to be kept open.
+static BOOL HTTPRequestClosesConnection(CFHTTPMessageRef request) {
+    NSString *version = (__bridge_transfer NSString *)CFHTTPMessageCopyVersion(request);
+    NSString *connection = (__bridge_transfer NSString *)CFHTTPMessageCopyHeaderFieldValue(request, CFSTR("Connection"));
+    NSMutableSet<NSString *> *options = [NSMutableSet set];
+    for (NSString *option in [[connection lowercaseString] componentsSeparatedByString:@","]) {
+        [options addObject:[option stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]]];
+    }
+    if ([options containsObject:@"close"]) {
+        return YES;
+    }
+    return [version isEqual:(__bridge NSString *)kCFHTTPVersion1_0] && ![options containsObject:@"keep-alive"];
+}
+
+static const NSUInteger kHTTPServerDefaultMaxConnections = 16;
+static const NSUInteger kHTTPServerDefaultMaxHeaderLength = 16 * 1024;
+static const NSUInteger kHTTPServerDefaultMaxBodyLength = 64 * 1024;
+static const NSTimeInterval kHTTPServerDefaultIdleTimeout = 30;
+static const NSTimeInterval kHTTPServerDefaultHeaderTimeout = 10;
+
+// The number of pipelined requests a connection parses ahead of the
+// responses; reading stops while that many responses are outstanding.
+static const NSUInteger kHTTPConnectionMaxPendingRequests = 8;
+
+enum {
+    kHTTPConnectionNoTimeout,
+    // waiting for the next request
+    kHTTPConnectionIdleTimeout,
+    // waiting for the rest of a request
+    kHTTPConnectionHeaderTimeout,
+    // waiting for the client to read the response
+    kHTTPConnectionWriteTimeout,
+};
+
+@interface TCPServer ()
+// Stops or resumes accepting connections; while stopped, new connections wait
+// in the listen backlog.  Called on the event loop thread.
+- (void)setAcceptsConnections:(BOOL)accepts;
+@end
+
+@interface HTTPConnection ()
+- (void)invalidateWhenIdle;
+@end
+
 @implementation HTTPServer
 
 - (id)init {
     self = [super init];
     connClass = [HTTPConnection self];
     connections = [[NSMutableArray alloc] init];
+    maxConnections = kHTTPServerDefaultMaxConnections;
+    maxHeaderLength = kHTTPServerDefaultMaxHeaderLength;
+    maxBodyLength = kHTTPServerDefaultMaxBodyLength;
+    idleTimeout = kHTTPServerDefaultIdleTimeout;
+    headerTimeout = kHTTPServerDefaultHeaderTimeout;
     return self;
 }
 
@@ -46,22 +1041,83 @@
     connClass = value;
 }
 
+- (NSUInteger)maxConnections {
+    return maxConnections;
+}
+
+- (void)setMaxConnections:(NSUInteger)value {
+    maxConnections = value;
+}
+
+- (NSUInteger)maxHeaderLength {
+    return maxHeaderLength;
+}
+
+- (void)setMaxHeaderLength:(NSUInteger)value {
+    maxHeaderLength = value;
+}
+
+- (NSUInteger)maxBodyLength {
+    return maxBodyLength;
+}
+
+- (void)setMaxBodyLength:(NSUInteger)value {
+    maxBodyLength = value;
+}
+
+- (NSTimeInterval)idleTimeout {
+    return idleTimeout;
+}
+
+- (void)setIdleTimeout:(NSTimeInterval)value {
+    idleTimeout = value;
+}
+
+- (NSTimeInterval)headerTimeout {
+    return headerTimeout;
+}
+
+- (void)setHeaderTimeout:(NSTimeInterval)value {
+    headerTimeout = value;
+}
+
 // Removes the connection from the list of active connections.
 - (void)removeConnection:(HTTPConnection *)connection {
     [connections removeObject:connection];
+    if ([connections count] < maxConnections) {
+        [self setAcceptsConnections:YES];
+    }
 }
 
-// Converts the TCPServer delegate notification into the HTTPServer delegate method.
-- (void)handleNewConnectionFromAddress:(NSData *)addr inputStream:(NSInputStream *)istr outputStream:(NSOutputStream *)ostr {
-    HTTPConnection *connection = [[connClass alloc] initWithPeerAddress:addr inputStream:istr outputStream:ostr forServer:self];
+// Creates the HTTPConnection for a socket accepted by the TCPServer.
+- (void)handleNewConnectionFromAddress:(NSData *)addr socket:(int)fd {
+    HTTPConnection *connection = [[connClass alloc] initWithPeerAddress:addr socket:fd forServer:self];
     // Adds connection to the active connection list to retain it.
     [connections addObject:connection];
+    if ([connections count] >= maxConnections) {
+        // Leaves further connections in the kernel's listen backlog until one
+        // of these closes, rather than let local clients exhaust the server.
+        [self setAcceptsConnections:NO];
+    }
     [connection setDelegate:[self delegate]];
     if ([self delegate] && [[self delegate] respondsToSelector:@selector(HTTPServer:didMakeNewConnection:)]) {
         [[self delegate] HTTPServer:self didMakeNewConnection:connection];
     }
 }
 
+- (BOOL)stop {
+    [super stop];
+    // Connections are closed once they have sent the responses to the
+    // requests they already received.
+    NSMutableArray<HTTPConnection *> *active = connections;
+    [[HTTPEventLoop sharedLoop] performBlock:^{
+        for (HTTPConnection *connection in [active copy]) {
+            [connection invalidateWhenIdle];
+        }
+    }];
+    return YES;
+}
+
 @end
 
 
@@ -71,23 +1127,37 @@
     return nil;
 }
 
-- (id)initWithPeerAddress:(NSData *)addr inputStream:(NSInputStream *)istr outputStream:(NSOutputStream *)ostr forServer:(HTTPServer *)serv {
+- (id)initWithPeerAddress:(NSData *)addr socket:(int)fd forServer:(HTTPServer *)serv {
+    self = [super init];
     peerAddress = [addr copy];
     server = serv;
-    istream = istr;
-    ostream = ostr;
-    [istream setDelegate:self];
-    [ostream setDelegate:self];
-    [istream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:(id)kCFRunLoopCommonModes];
-    [ostream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:(id)kCFRunLoopCommonModes];
-    [istream open];
-    [ostream open];
+    sockfd = fd;
+    requests = [[NSMutableArray alloc] init];
+    parser = [[HTTPRequestParser alloc] initWithMaxHeaderLength:(serv ? [serv maxHeaderLength] : kHTTPServerDefaultMaxHeaderLength)
+                                                  maxBodyLength:(serv ? [serv maxBodyLength] : kHTTPServerDefaultMaxBodyLength)];
+    owriter = [[HTTPResponseWriter alloc] init];
+    idleTimeout = serv ? [serv idleTimeout] : kHTTPServerDefaultIdleTimeout;
+    headerTimeout = serv ? [serv headerTimeout] : kHTTPServerDefaultHeaderTimeout;
     isValid = YES;
+    // The handlers keep the connection alive until it is invalidated.
+    HTTPEventLoop *loop = [HTTPEventLoop sharedLoop];
+    [loop performBlock:^{
+        [loop addDescriptor:fd readHandler:^{
+            [self readIncomingBytes];
+        } writeHandler:^{
+            [self processOutgoingBytes];
+        }];
+        [self updateEvents];
+    }];
     return self;
 }
 
 - (void)dealloc {
-    [self invalidate];
+    // The handlers keep the connection alive until it is invalidated, so
+    // only a socket that was never registered with the loop is left here.
+    if (0 <= sockfd) {
+        close(sockfd);
+    }
 }
 
 - (id)delegate {
@@ -107,9 +1177,11 @@
 }
 
 - (HTTPServerRequest *)nextRequest {
-  for (HTTPServerRequest *request in requests) {
-    if (![request response]) {
-      return request;
+  @synchronized(requests) {
+    for (HTTPServerRequest *request in requests) {
+      if (![request response] && ![request responseData]) {
+        return request;
+      }
     }
   }
   return nil;
@@ -120,18 +1192,117 @@
 }
 
 - (void)invalidate {
+    HTTPEventLoop *loop = [HTTPEventLoop sharedLoop];
+    if (![loop isLoopThread]) {
+        // The socket, parser and writer are only used on the loop thread, so
+        // a delegate on the main thread tears them down there.
+        [loop performBlock:^{
+            [self invalidate];
+        }];
+        return;
+    }
     if (isValid) {
         isValid = NO;
         [server removeConnection:self];
-        [istream setDelegate:nil];
-        [ostream setDelegate:nil];
-        [istream close];
-        [ostream close];
-        istream = nil;
-        ostream = nil;
-        ibuffer = nil;
-        obuffer = nil;
-        requests = nil;
+        [loop removeDescriptor:sockfd];
+        close(sockfd);
+        sockfd = -1;
+        parser = nil;
+        owriter = nil;
+        errorResponse = nil;
+        @synchronized(requests) {
+            [requests removeAllObjects];
+        }
+    }
+}
+
+// YES if every response was written out.
+- (BOOL)isIdle {
+    return 0 == [requests count] && !errorResponse && ![owriter hasPendingBytes];
+}
+
+// Closes the connection as soon as no response is pending.
+- (void)invalidateWhenIdle {
+    closeWhenIdle = YES;
+    if ([self isIdle]) {
+        [self invalidate];
+    }
+}
+
+// Waits for the socket to be readable while more requests are accepted, and
+// writable while there are queued bytes to write, and arms the timeout of
+// what the connection waits for.
+- (void)updateEvents {
+    if (!isValid) {
+        return;
+    }
+    HTTPEventLoop *loop = [HTTPEventLoop sharedLoop];
+    BOOL writing = [owriter hasPendingBytes];
+    BOOL reading = !inputClosed && [requests count] < kHTTPConnectionMaxPendingRequests;
+    [loop setReading:reading writing:writing forDescriptor:sockfd];
+
+    int kind = kHTTPConnectionNoTimeout;
+    if (writing) {
+        kind = kHTTPConnectionWriteTimeout;
+    } else if (0 < [requests count]) {
+        // waiting for the delegate to respond
+        kind = kHTTPConnectionNoTimeout;
+    } else if ([parser hasPartialRequest]) {
+        kind = kHTTPConnectionHeaderTimeout;
+    } else {
+        kind = kHTTPConnectionIdleTimeout;
+    }
+    // A partial request keeps the deadline of its first bytes, while a write
+    // deadline is renewed as long as the client keeps reading.
+    if (kind != timeoutKind || kind == kHTTPConnectionWriteTimeout) {
+        timeoutKind = kind;
+        NSTimeInterval timeout = 0;
+        if (kind == kHTTPConnectionHeaderTimeout) {
+            timeout = headerTimeout;
+        } else if (kind != kHTTPConnectionNoTimeout) {
+            timeout = idleTimeout;
+        }
+        [loop setTimeout:timeout forDescriptor:sockfd handler:^{
+            [self invalidate];
+        }];
+    }
+}
+
+- (void)readIncomingBytes {
+    // reads straight into the parser's pooled buffer
+    NSUInteger capacity = 0;
+    void *buffer = [parser readBufferWithCapacity:&capacity];
+    if (0 == capacity) {
+        // the request is too long; answers it with the parser's error
+        [self processBufferedRequests];
+        [self processOutgoingBytes];
+        return;
+    }
+    ssize_t len = recv(sockfd, buffer, capacity, 0);
+    if (0 < len) {
+        [parser didReadLength:len];
+        [self processBufferedRequests];
+        [parser releaseBufferIfIdle];
+        [self processOutgoingBytes];
+    } else if (0 == len) {
+        [parser releaseBufferIfIdle];
+        // No more requests are coming in; the connection is closed once the
+        // responses to the requests already received are sent.
+        inputClosed = YES;
+        [self updateEvents];
+        [self invalidateWhenIdle];
+    } else if (!HTTPSocketWouldBlock()) {
+        [self invalidate];
+    }
+}
+
+// Hands off the complete requests in the receive buffer, as long as fewer
+// than kHTTPConnectionMaxPendingRequests responses are outstanding.
+- (void)processBufferedRequests {
+    while (isValid && !inputClosed && [requests count] < kHTTPConnectionMaxPendingRequests) {
+        if (![self processIncomingBytes]) {
+            break;
+        }
     }
 }
 
@@ -139,46 +1310,35 @@
 // should call again as the buffered bytes may have another complete
 // request available.
 - (BOOL)processIncomingBytes {
-    CFHTTPMessageRef working = CFHTTPMessageCreateEmpty(kCFAllocatorDefault, TRUE);
-    CFHTTPMessageAppendBytes(working, [ibuffer bytes], [ibuffer length]);
-
-    // This "try and possibly succeed" approach is potentially expensive
-    // (lots of bytes being copied around), but the only API available for
-    // the server to use, short of doing the parsing itself.
-
-    // HTTPConnection does not handle the chunked transfer encoding
-    // described in the HTTP spec.  And if there is no Content-Length
-    // header, then the request is the remainder of the stream bytes.
-
-    if (CFHTTPMessageIsHeaderComplete(working)) {
-        NSString *contentLengthValue = (__bridge_transfer NSString *)CFHTTPMessageCopyHeaderFieldValue(working, (CFStringRef)@"Content-Length");
-        
-        unsigned contentLength = contentLengthValue ? [contentLengthValue intValue] : 0;
-        NSData *body = (__bridge_transfer NSData *)CFHTTPMessageCopyBody(working);
-        NSUInteger bodyLength = [body length];
-        if (contentLength <= bodyLength) {
-            NSData *newBody = [NSData dataWithBytes:[body bytes] length:contentLength];
-            [ibuffer setLength:0];
-            [ibuffer appendBytes:([body bytes] + contentLength) length:(bodyLength - contentLength)];
-            CFHTTPMessageSetBody(working, (__bridge CFDataRef)newBody);
-        } else {
-            CFRelease(working);
-            return NO;
+    CFHTTPMessageRef working = [parser copyNextRequest];
+    if (!working) {
+        NSInteger statusCode = [parser errorStatusCode];
+        if (statusCode) {
+            // The connection is out of sync with the client, so no further
+            // request on it can be parsed.  The requests received before are
+            // answered, then the error, and then the connection is closed.
+            errorResponse = HTTPCopyErrorResponseData(statusCode);
+            inputClosed = YES;
+            closeWhenIdle = YES;
         }
-    } else {
         return NO;
     }
 
+    if (HTTPRequestClosesConnection(working)) {
+        // Requests after this one are not read (RFC 7230 section 6.6).
+        inputClosed = YES;
+        closeWhenIdle = YES;
+    }
+
     HTTPServerRequest *request = [[HTTPServerRequest alloc] initWithRequest:working connection:self];
-    if (!requests) {
-        requests = [[NSMutableArray alloc] init];
+    @synchronized(requests) {
+        [requests addObject:request];
     }
-    [requests addObject:request];
     if (delegate && [delegate respondsToSelector:@selector(HTTPConnection:didReceiveRequest:)]) {
         // Schedules the delegate to be executed later on the main thread. Cannot call the delegate
-        // directly as this method is called in a loop in order to process multiple messages, and
-        // the delegate may choose to stop and dealloc the listener – so we need queue the messages
-        // and process them separately.
+        // directly as this method is called on the event loop thread in a loop in order to process
+        // multiple messages, and the delegate may choose to stop and dealloc the listener – so we
+        // need queue the messages and process them separately.
         id myDelegate = delegate;
         dispatch_async(dispatch_get_main_queue(), ^() {
           [myDelegate HTTPConnection:self didReceiveRequest:request];
@@ -193,128 +1353,103 @@
 
 - (void)processOutgoingBytes {
     // The HTTP headers, then the body if any, then the response stream get
-    // written out, in that order.  The Content-Length: header is assumed to
-    // be properly set in the response.  Outgoing responses are processed in
-    // the order the requests were received (required by HTTP).
-
-    // Write as many bytes as possible, from buffered bytes, response
+    // written out, in that order.  A Content-Length: header is added to
+    // responses without one when their length is known; otherwise the
+    // connection is closed after the response, to delimit its body.
+    // Outgoing responses are processed in the order the requests were
+    // received (required by HTTP), so pipelined requests are answered in
+    // order.
+
+    // Write as many bytes as possible, from queued bytes, response
     // headers and body, and response stream.
 
-    if (![ostream hasSpaceAvailable]) {
-        return;
-    }
-
-    NSUInteger olen = [obuffer length];
-    if (0 < olen) {
-        NSInteger writ = [ostream write:[obuffer bytes] maxLength:olen];
-        // buffer any unwritten bytes for later writing
-        if (writ < olen) {
-            memmove([obuffer mutableBytes], [obuffer mutableBytes] + writ, olen - writ);
-            [obuffer setLength:olen - writ];
-            return;
+    while (isValid) {
+        if (![owriter writeToSocket:sockfd]) {
+            [self invalidate];
+            break;
+        }
+        if ([owriter hasPendingBytes]) {
+            // continued when the socket is writable again
+            break;
         }
-        [obuffer setLength:0];
-    }
-
-    NSUInteger cnt = requests ? [requests count] : 0;
-    HTTPServerRequest *req = (0 < cnt) ? [requests objectAtIndex:0] : nil;
 
-    CFHTTPMessageRef cfresp = req ? [req response] : NULL;
-    if (!cfresp) return;
+        HTTPServerRequest *req = nil;
+        @synchronized(requests) {
+            req = [requests firstObject];
+        }
 
-    if (!obuffer) {
-        obuffer = [[NSMutableData alloc] init];
-    }
+        if (!req) {
+            if (errorResponse) {
+                [owriter appendData:errorResponse];
+                errorResponse = nil;
+                continue;
+            }
+            break;
+        }
 
-    if (!firstResponseDone) {
-        firstResponseDone = YES;
-        NSData *serialized = (__bridge_transfer NSData *)CFHTTPMessageCopySerializedMessage(cfresp);
-        NSUInteger olen = [serialized length];
-        if (0 < olen) {
-            NSInteger writ = [ostream write:[serialized bytes] maxLength:olen];
-            if (writ < olen) {
-                // buffer any unwritten bytes for later writing
-                [obuffer setLength:(olen - writ)];
-                memmove([obuffer mutableBytes], [serialized bytes] + writ, olen - writ);
-                return;
+        CFHTTPMessageRef cfresp = [req response];
+        NSData *serialized = [req responseData];
+        if (!cfresp && !serialized) break;
+
+        NSInputStream *respStream = serialized ? nil : [req responseBodyStream];
+        if (!firstResponseDone) {
+            firstResponseDone = YES;
+            if (serialized) {
+                [owriter appendData:serialized];
+            } else {
+                NSData *body = (__bridge_transfer NSData *)CFHTTPMessageCopyBody(cfresp);
+                NSString *contentLength = (__bridge_transfer NSString *)CFHTTPMessageCopyHeaderFieldValue(cfresp, CFSTR("Content-Length"));
+                if (!contentLength && !respStream) {
+                    CFHTTPMessageSetHeaderFieldValue(cfresp, CFSTR("Content-Length"), (__bridge CFStringRef)[NSString stringWithFormat:@"%lu", (unsigned long)[body length]]);
+                } else if (!contentLength) {
+                    inputClosed = YES;
+                    closeWhenIdle = YES;
+                }
+                [owriter appendData:HTTPCopyResponseHeaderData(cfresp)];
+                [owriter appendData:body];
             }
+            continue;
         }
-    }
 
-    NSInputStream *respStream = [req responseBodyStream];
-    if (respStream) {
-        if ([respStream streamStatus] == NSStreamStatusNotOpen) {
-            [respStream open];
+        if (respStream) {
+            if ([respStream streamStatus] == NSStreamStatusNotOpen) {
+                [respStream open];
+            }
+            // read some bytes from the stream into a pooled buffer, which
+            // the writer gives back once they are written
+            HTTPBufferPool *pool = [HTTPBufferPool sharedPool];
+            NSMutableData *chunk = [pool acquireBuffer];
+            NSInteger read = [respStream read:[chunk mutableBytes] maxLength:[chunk length]];
+            if (0 < read) {
+                [owriter appendPooledBuffer:chunk length:read];
+                continue;
+            }
+            [pool releaseBuffer:chunk];
         }
-        // read some bytes from the stream into our local buffer
-        [obuffer setLength:16 * 1024];
-        NSInteger read = [respStream read:[obuffer mutableBytes] maxLength:[obuffer length]];
-        [obuffer setLength:read];
-    }
 
-    if (0 == [obuffer length]) {
-        // When we get to this point with an empty buffer, then the
-        // processing of the response is done. If the input stream
-        // is closed or at EOF, then no more requests are coming in.
+        // When we get to this point with nothing queued, then the
+        // processing of the response is done.
         if (delegate && [delegate respondsToSelector:@selector(HTTPConnection:didSendResponse:)]) {
-            [delegate HTTPConnection:self didSendResponse:req];
-        }
-        [requests removeObjectAtIndex:0];
-        firstResponseDone = NO;
-        if ([istream streamStatus] == NSStreamStatusAtEnd && [requests count] == 0) {
-            [self invalidate];
+            id myDelegate = delegate;
+            dispatch_async(dispatch_get_main_queue(), ^() {
+              [myDelegate HTTPConnection:self didSendResponse:req];
+            });
         }
-        return;
-    }
-
-    olen = [obuffer length];
-    if (0 < olen) {
-        NSInteger writ = [ostream write:[obuffer bytes] maxLength:olen];
-        // buffer any unwritten bytes for later writing
-        if (writ < olen) {
-            memmove([obuffer mutableBytes], [obuffer mutableBytes] + writ, olen - writ);
+        @synchronized(requests) {
+            [requests removeObjectAtIndex:0];
         }
-        [obuffer setLength:olen - writ];
+        firstResponseDone = NO;
+        // parses the requests that were pipelined behind the one answered
+        [self processBufferedRequests];
+        [parser releaseBufferIfIdle];
     }
-}
 
-- (void)stream:(NSStream *)stream handleEvent:(NSStreamEvent)streamEvent {
-    switch(streamEvent) {
-    case NSStreamEventHasBytesAvailable:;
-        uint8_t buf[16 * 1024];
-        uint8_t *buffer = NULL;
-        NSUInteger len = 0;
-        if (![istream getBuffer:&buffer length:&len]) {
-            NSInteger amount = [istream read:buf maxLength:sizeof(buf)];
-            buffer = buf;
-            len = amount;
-        }
-        if (0 < len) {
-            if (!ibuffer) {
-                ibuffer = [[NSMutableData alloc] init];
-            }
-            [ibuffer appendBytes:buffer length:len];
-        }
-        do {} while ([self processIncomingBytes]);
-        break;
-    case NSStreamEventHasSpaceAvailable:;
-        [self processOutgoingBytes];
-        break;
-    case NSStreamEventEndEncountered:;
-        [self processIncomingBytes];
-        if (stream == ostream) {
-            // When the output stream is closed, no more writing will succeed and
-            // will abandon the processing of any pending requests and further
-            // incoming bytes.
-            [self invalidate];
-        }
-        break;
-    case NSStreamEventErrorOccurred:;
-        NSLog(@"HTTPServer stream error: %@", [stream streamError]);
-        break;
-    default:
-        break;
+    // If the client closed its side of the connection, or asked for it to
+    // be closed, then no more requests are coming in.
+    if (isValid && closeWhenIdle && [self isIdle]) {
+        [self invalidate];
     }
+    [self updateEvents];
 }
 
 - (void)performDefaultRequestHandling:(HTTPServerRequest *)mess {
@@ -372,7 +1507,27 @@
         response = (CFHTTPMessageRef)CFRetain(value);
         if (response) {
             // check to see if the response can now be sent out
-            [connection processOutgoingBytes];
+            HTTPConnection *conn = connection;
+            [[HTTPEventLoop sharedLoop] performBlock:^{
+                [conn processOutgoingBytes];
+            }];
+        }
+    }
+}
+
+- (NSData *)responseData {
+    return responseData;
+}
+
+- (void)setResponseData:(NSData *)value {
+    if (value != responseData) {
+        responseData = [value copy];
+        if (responseData) {
+            // check to see if the response can now be sent out
+            HTTPConnection *conn = connection;
+            [[HTTPEventLoop sharedLoop] performBlock:^{
+                [conn processOutgoingBytes];
+            }];
         }
     }
 }
@@ -394,6 +1549,9 @@ NSString * const TCPServerErrorDomain = @"TCPServerErrorDomain";
 @implementation TCPServer
 
 - (id)init {
+    self = [super init];
+    ipv4socket = -1;
+    ipv6socket = -1;
     return self;
 }
 
@@ -447,6 +1605,14 @@ NSString * const TCPServerErrorDomain = @"TCPServerErrorDomain";
     port = value;
 }
 
+- (NSRange)portRange {
+    return portRange;
+}
+
+- (void)setPortRange:(NSRange)value {
+    portRange = value;
+}
+
 - (void)handleNewConnectionFromAddress:(NSData *)addr inputStream:(NSInputStream *)istr outputStream:(NSOutputStream *)ostr {
     // if the delegate implements the delegate method, call it
     if (delegate && [(NSObject*)delegate respondsToSelector:@selector(TCPServer:didReceiveConnectionFromAddress:inputStream:outputStream:)]) {
@@ -454,119 +1620,238 @@ NSString * const TCPServerErrorDomain = @"TCPServerErrorDomain";
     }
 }
 
-// This function is called by CFSocket when a new connection comes in.
-// We gather some data here, and convert the function call to a method
-// invocation on TCPServer.
-static void TCPServerAcceptCallBack(CFSocketRef socket, CFSocketCallBackType type, CFDataRef address, const void *data, void *info) {
-    TCPServer *server = (__bridge TCPServer *)info;
-    if (kCFSocketAcceptCallBack == type) {
-        // for an AcceptCallBack, the data parameter is a pointer to a CFSocketNativeHandle
-        CFSocketNativeHandle nativeSocketHandle = *(CFSocketNativeHandle *)data;
-        uint8_t name[SOCK_MAXADDRLEN];
+- (void)handleNewConnectionFromAddress:(NSData *)addr socket:(int)fd {
+    CFReadStreamRef readStream = NULL;
+    CFWriteStreamRef writeStream = NULL;
+    CFStreamCreatePairWithSocket(kCFAllocatorDefault, fd, &readStream, &writeStream);
+    if (readStream && writeStream) {
+        CFReadStreamSetProperty(readStream, kCFStreamPropertyShouldCloseNativeSocket, kCFBooleanTrue);
+        CFWriteStreamSetProperty(writeStream, kCFStreamPropertyShouldCloseNativeSocket, kCFBooleanTrue);
+        [self handleNewConnectionFromAddress:addr inputStream:(__bridge NSInputStream *)readStream outputStream:(__bridge NSOutputStream *)writeStream];
+    } else {
+        // on any failure, need to destroy the socket
+        // since we are not going to use it any more
+        close(fd);
+    }
+    if (readStream) CFRelease(readStream);
+    if (writeStream) CFRelease(writeStream);
+}
+
+- (void)setAcceptsConnections:(BOOL)accepts {
+    acceptPaused = !accepts;
+    HTTPEventLoop *loop = [HTTPEventLoop sharedLoop];
+    if (0 <= ipv4socket) {
+        [loop setReading:accepts writing:NO forDescriptor:ipv4socket];
+    }
+    if (0 <= ipv6socket) {
+        [loop setReading:accepts writing:NO forDescriptor:ipv6socket];
+    }
+}
+
+// Called on the event loop thread when a listening socket is readable.
+// Accepts the pending connections, until accepting is stopped, and converts
+// them into calls of handleNewConnectionFromAddress:socket:.
+- (void)acceptConnectionsOnSocket:(int)listenfd {
+    while (!acceptPaused) {
+        struct sockaddr_storage name;
         socklen_t namelen = sizeof(name);
-        NSData *peer = nil;
-        if (0 == getpeername(nativeSocketHandle, (struct sockaddr *)name, &namelen)) {
-            peer = [NSData dataWithBytes:name length:namelen];
-        }
-        CFReadStreamRef readStream = NULL;
-	CFWriteStreamRef writeStream = NULL;
-        CFStreamCreatePairWithSocket(kCFAllocatorDefault, nativeSocketHandle, &readStream, &writeStream);
-        if (readStream && writeStream) {
-            CFReadStreamSetProperty(readStream, kCFStreamPropertyShouldCloseNativeSocket, kCFBooleanTrue);
-            CFWriteStreamSetProperty(writeStream, kCFStreamPropertyShouldCloseNativeSocket, kCFBooleanTrue);
-            [server handleNewConnectionFromAddress:peer inputStream:(__bridge NSInputStream *)readStream outputStream:(__bridge NSOutputStream *)writeStream];
-        } else {
-            // on any failure, need to destroy the CFSocketNativeHandle
-            // since we are not going to use it any more
-            close(nativeSocketHandle);
+        int fd = accept(listenfd, (struct sockaddr *)&name, &namelen);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, (void *)&yes, sizeof(yes));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *)&yes, sizeof(yes));
+        if (!HTTPSetNonBlocking(fd)) {
+            close(fd);
+            continue;
         }
-        if (readStream) CFRelease(readStream);
-        if (writeStream) CFRelease(writeStream);
+        NSData *peer = [NSData dataWithBytes:&name length:namelen];
+        [self handleNewConnectionFromAddress:peer socket:fd];
     }
 }
 
-- (BOOL)start:(NSError **)error {
-    CFSocketContext socketCtxt = {0, (__bridge void *)(self), NULL, NULL, NULL};
-    ipv4socket = CFSocketCreate(kCFAllocatorDefault, PF_INET, SOCK_STREAM, IPPROTO_TCP, kCFSocketAcceptCallBack, (CFSocketCallBack)&TCPServerAcceptCallBack, &socketCtxt);
-    ipv6socket = CFSocketCreate(kCFAllocatorDefault, PF_INET6, SOCK_STREAM, IPPROTO_TCP, kCFSocketAcceptCallBack, (CFSocketCallBack)&TCPServerAcceptCallBack, &socketCtxt);
-
-    if (NULL == ipv4socket || NULL == ipv6socket) {
-        if (error) *error = [[NSError alloc] initWithDomain:TCPServerErrorDomain code:kTCPServerNoSocketsAvailable userInfo:nil];
-        if (ipv4socket) CFRelease(ipv4socket);
-        if (ipv6socket) CFRelease(ipv6socket);
-        ipv4socket = NULL;
-        ipv6socket = NULL;
-        return NO;
+// Creates a socket bound to the loopback address of the family on the port,
+// and listening for connections; or returns -1, with the errno in *err.
+static int TCPServerCreateLoopbackSocket(int family, uint16_t port, int *err) {
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    memset(&addr, 0, sizeof(addr));
+    if (AF_INET6 == family) {
+        struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)&addr;
+        addrlen = sizeof(*addr6);
+        addr6->sin6_len = addrlen;
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        memcpy(&(addr6->sin6_addr), &in6addr_loopback, sizeof(addr6->sin6_addr));
+    } else {
+        struct sockaddr_in *addr4 = (struct sockaddr_in *)&addr;
+        addrlen = sizeof(*addr4);
+        addr4->sin_len = addrlen;
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(port);
+        addr4->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
     }
 
+    int fd = socket(family, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        *err = errno;
+        return -1;
+    }
     int yes = 1;
-    setsockopt(CFSocketGetNative(ipv4socket), SOL_SOCKET, SO_REUSEADDR, (void *)&yes, sizeof(yes));
-    setsockopt(CFSocketGetNative(ipv6socket), SOL_SOCKET, SO_REUSEADDR, (void *)&yes, sizeof(yes));
-
-    // set up the IPv4 endpoint; if port is 0, this will cause the kernel to choose a port for us
-    struct sockaddr_in addr4;
-    memset(&addr4, 0, sizeof(addr4));
-    addr4.sin_len = sizeof(addr4);
-    addr4.sin_family = AF_INET;
-    addr4.sin_port = htons(port);
-    addr4.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    NSData *address4 = [NSData dataWithBytes:&addr4 length:sizeof(addr4)];
-
-    if (kCFSocketSuccess == CFSocketSetAddress(ipv4socket, (CFDataRef)address4)) {
-        if (0 == port) {
-            // now that the binding was successful, we get the port number
-            // -- we will need it for the v6 endpoint and for the NSNetService
-            NSData *addr = (__bridge_transfer NSData *)CFSocketCopyAddress(ipv4socket);
-            memcpy(&addr4, [addr bytes], [addr length]);
-            port = ntohs(addr4.sin_port);
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (void *)&yes, sizeof(yes));
+    if (AF_INET6 == family) {
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (void *)&yes, sizeof(yes));
+    }
+    if (0 != bind(fd, (struct sockaddr *)&addr, addrlen) || 0 != listen(fd, SOMAXCONN) ||
+        !HTTPSetNonBlocking(fd)) {
+        *err = errno;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Returns the port a socket is bound to.
+static uint16_t TCPServerBoundPort(int fd) {
+    struct sockaddr_storage addr;
+    socklen_t addrlen = sizeof(addr);
+    if (0 != getsockname(fd, (struct sockaddr *)&addr, &addrlen)) {
+        return 0;
+    }
+    if (addr.ss_family == AF_INET6) {
+        return ntohs(((struct sockaddr_in6 *)&addr)->sin6_port);
+    }
+    return ntohs(((struct sockaddr_in *)&addr)->sin_port);
+}
+
+// The number of kernel-chosen ports tried when the other address family turns
+// out to be taken on the port chosen for IPv4.
+static const NSUInteger kTCPServerEphemeralPortAttempts = 4;
+
+// Binds the IPv4 and IPv6 loopback sockets to the port. With port 0, the kernel
+// chooses the port for IPv4, and IPv6 is then bound to the same one; otherwise
+// both families are bound at the same time. Fails if neither family could be
+// bound or, when strict, if either port was taken, so that another port can be
+// tried; a family which is just unavailable never fails the bind.
+- (BOOL)bindSocketsToPort:(uint16_t)candidate strict:(BOOL)strict {
+    __block int fd6 = -1;
+    __block int err6 = 0;
+    int fd4 = -1;
+    int err4 = 0;
+    if (0 == candidate) {
+        fd4 = TCPServerCreateLoopbackSocket(AF_INET, 0, &err4);
+        if (0 <= fd4) {
+            candidate = TCPServerBoundPort(fd4);
         }
+        fd6 = TCPServerCreateLoopbackSocket(AF_INET6, candidate, &err6);
     } else {
-        if (ipv4socket) CFRelease(ipv4socket);
-        ipv4socket = NULL;
-    }
-
-    // set up the IPv6 endpoint
-    struct sockaddr_in6 addr6;
-    memset(&addr6, 0, sizeof(addr6));
-    addr6.sin6_len = sizeof(addr6);
-    addr6.sin6_family = AF_INET6;
-    addr6.sin6_port = htons(port);
-    memcpy(&(addr6.sin6_addr), &in6addr_loopback, sizeof(addr6.sin6_addr));
-    NSData *address6 = [NSData dataWithBytes:&addr6 length:sizeof(addr6)];
-
-    if (kCFSocketSuccess == CFSocketSetAddress(ipv6socket, (CFDataRef)address6)) {
-        if (0 == port) {
-            // In this case the IPv4 socket failed to bind but the IPv6 socket succeeded
-            // Get the port number of the IPv6 socket
-            NSData *addr = (__bridge_transfer NSData *)CFSocketCopyAddress(ipv6socket);
-            memcpy(&addr6, [addr bytes], [addr length]);
-            port = ntohs(addr6.sin6_port);
+        dispatch_group_t group = dispatch_group_create();
+        dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0);
+        dispatch_group_async(group, queue, ^{
+            fd6 = TCPServerCreateLoopbackSocket(AF_INET6, candidate, &err6);
+        });
+        fd4 = TCPServerCreateLoopbackSocket(AF_INET, candidate, &err4);
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    }
+
+    BOOL taken = (fd4 < 0 && EADDRINUSE == err4) || (fd6 < 0 && EADDRINUSE == err6);
+    if ((fd4 < 0 && fd6 < 0) || (strict && taken)) {
+        if (0 <= fd4) close(fd4);
+        if (0 <= fd6) close(fd6);
+        return NO;
+    }
+    ipv4socket = fd4;
+    ipv6socket = fd6;
+    port = TCPServerBoundPort(0 <= fd4 ? fd4 : fd6);
+    return YES;
+}
+
+- (BOOL)start:(NSError **)error {
+    if (![HTTPEventLoop sharedLoop]) {
+        if (error) *error = [[NSError alloc] initWithDomain:TCPServerErrorDomain code:kTCPServerNoSocketsAvailable userInfo:nil];
+        return NO;
+    }
+
+    // try each port of the range, or the port alone; a kernel-chosen port is
+    // retried a few times, in case the other family is taken on it. Only the
+    // last attempt settles for a single family.
+    NSUInteger attempts = 1;
+    if (0 < portRange.length) {
+        attempts = portRange.length;
+    } else if (0 == port) {
+        attempts = kTCPServerEphemeralPortAttempts;
+    }
+    BOOL bound = NO;
+    for (NSUInteger i = 0; i < attempts && !bound; i++) {
+        NSUInteger candidate = (0 < portRange.length) ? portRange.location + i : port;
+        if (0 < portRange.length && (0 == candidate || UINT16_MAX < candidate)) {
+            continue;
         }
-    } else {
-        if (ipv6socket) CFRelease(ipv6socket);
-        ipv6socket = NULL;
+        bound = [self bindSocketsToPort:(uint16_t)candidate strict:(i + 1 < attempts)];
     }
 
-    if (!ipv4socket && !ipv6socket) {
+    if (!bound) {
         // Couldn't bind an IPv4 or IPv6 socket, return an error
         if (error) *error = [[NSError alloc] initWithDomain:TCPServerErrorDomain code:kTCPServerCouldNotBindToIPv4Address userInfo:nil];
         return NO;
     }
+    [self startAcceptingConnections];
+    return YES;
+}
 
-    // set up the run loop sources for the sockets
-    CFRunLoopRef cfrl = CFRunLoopGetCurrent();
-
-    if (ipv4socket) {
-        CFRunLoopSourceRef source4 = CFSocketCreateRunLoopSource(kCFAllocatorDefault, ipv4socket, 0);
-        CFRunLoopAddSource(cfrl, source4, kCFRunLoopCommonModes);
-        CFRelease(source4);
+- (BOOL)startWithListeningSocket:(int)fd error:(NSError **)error {
+    // the socket must be listening on a loopback address
+    struct sockaddr_storage addr;
+    socklen_t addrlen = sizeof(addr);
+    int listening = 0;
+    socklen_t optlen = sizeof(listening);
+    BOOL loopback = NO;
+    if (0 == getsockname(fd, (struct sockaddr *)&addr, &addrlen)) {
+        if (AF_INET == addr.ss_family) {
+            struct sockaddr_in *addr4 = (struct sockaddr_in *)&addr;
+            loopback = (htonl(INADDR_LOOPBACK) == addr4->sin_addr.s_addr);
+        } else if (AF_INET6 == addr.ss_family) {
+            struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)&addr;
+            loopback = IN6_IS_ADDR_LOOPBACK(&(addr6->sin6_addr));
+        }
+    }
+    if (!loopback || 0 != getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &optlen) ||
+        !listening || ![HTTPEventLoop sharedLoop] || !HTTPSetNonBlocking(fd)) {
+        if (error) *error = [[NSError alloc] initWithDomain:TCPServerErrorDomain code:kTCPServerNoSocketsAvailable userInfo:nil];
+        return NO;
     }
 
-    if (ipv6socket) {
-        CFRunLoopSourceRef source6 = CFSocketCreateRunLoopSource(kCFAllocatorDefault, ipv6socket, 0);
-        CFRunLoopAddSource(cfrl, source6, kCFRunLoopCommonModes);
-        CFRelease(source6);
+    if (AF_INET6 == addr.ss_family) {
+        ipv6socket = fd;
+    } else {
+        ipv4socket = fd;
     }
+    port = TCPServerBoundPort(fd);
+    [self startAcceptingConnections];
+    return YES;
+}
+
+// Registers the listening sockets with the event loop, and publishes the
+// service.
+- (void)startAcceptingConnections {
+    // start accepting connections on the event loop thread
+    HTTPEventLoop *loop = [HTTPEventLoop sharedLoop];
+    __weak TCPServer *weakSelf = self;
+    int fd4 = ipv4socket;
+    int fd6 = ipv6socket;
+    [loop performBlock:^{
+        for (int i = 0; i < 2; i++) {
+            int listenfd = (0 == i) ? fd4 : fd6;
+            if (0 <= listenfd) {
+                [loop addDescriptor:listenfd readHandler:^{
+                    [weakSelf acceptConnectionsOnSocket:listenfd];
+                } writeHandler:nil];
+                [loop setReading:YES writing:NO forDescriptor:listenfd];
+            }
+        }
+    }];
 
     // we can only publish the service if we have a type to publish with
     if (nil != type) {
@@ -583,32 +1868,39 @@ static void TCPServerAcceptCallBack(CFSocketRef socket, CFSocketCallBackType typ
         netService = [[NSNetService alloc] initWithDomain:publishingDomain type:type name:publishingName port:port];
         [netService publish];
     }
-
-    return YES;
 }
 
 - (BOOL)stop {
     [netService stop];
     netService = nil;
-    if (ipv4socket) {
-      CFSocketInvalidate(ipv4socket);
-      CFRelease(ipv4socket);
-      ipv4socket = NULL;
-    }
-    if (ipv6socket) {
-      CFSocketInvalidate(ipv6socket);
-      CFRelease(ipv6socket);
-      ipv6socket = NULL;
+    int fd4 = ipv4socket;
+    int fd6 = ipv6socket;
+    ipv4socket = -1;
+    ipv6socket = -1;
+    if (0 <= fd4 || 0 <= fd6) {
+        // the sockets are closed on the event loop thread, so that no event
+        // for them can still be pending
+        HTTPEventLoop *loop = [HTTPEventLoop sharedLoop];
+        [loop performBlock:^{
+            if (0 <= fd4) {
+                [loop removeDescriptor:fd4];
+                close(fd4);
+            }
+            if (0 <= fd6) {
+                [loop removeDescriptor:fd6];
+                close(fd6);
+            }
+        }];
     }
     return YES;
 }
 
 - (BOOL)hasIPv4Socket {
-    return ipv4socket != nil;
+    return 0 <= ipv4socket;
 }
 
 - (BOOL)hasIPv6Socket {
-    return ipv6socket != nil;
+    return 0 <= ipv6socket;
 }
 
 @end
@@ -39,6 +39,12 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property(nonatomic, strong, nullable) id<EkoOIDExternalUserAgentSession> currentAuthorizationFlow;
 
+/*! @brief The base URL of the running listener, or nil if it is not running.
+    @discussion The same URL as returned by the @c startHTTPListener: method which started the
+        listener, so that requests made later on can be built without starting it again.
+ */
+@property(nonatomic, readonly, nullable) NSURL *listenerURL;
+
 /*! @brief Creates an a loopback HTTP redirect URI handler with the given success URL.
     @param successURL The URL that the user is redirected to after the external user-agent request flow completes
         either with a result of success or error. The contents of this page should instruct the user
@@ -49,6 +55,22 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (instancetype)initWithSuccessURL:(nullable NSURL *)successURL;
 
+/*! @brief Registers an external user-agent session to receive the redirect carrying @c state.
+    @param session The session of a request that redirects to this listener.
+    @param state The @c state parameter of the session's request.
+    @discussion Incoming redirects are routed by their @c state parameter, so any number of
+        sessions can be in progress on the same listener. A registered session is removed once it
+        handles a redirect, and unlike with @c currentAuthorizationFlow, the listener keeps running
+        for the sessions that follow; call @c cancelHTTPListener to stop it.
+ */
+- (void)addAuthorizationFlow:(id<EkoOIDExternalUserAgentSession>)session
+                    forState:(NSString *)state;
+
+/*! @brief Unregisters the session added for @c state, without notifying it.
+    @param state The @c state parameter the session was registered with.
+ */
+- (void)removeAuthorizationFlowForState:(NSString *)state;
+
 /*! @brief Starts listening on the loopback interface on a specified port, and returns a URL
         with the base address. Use the returned redirect URI to build a @c EkoOIDExternalUserAgentRequest,
         and once you initiate the request, set the resulting @c EkoOIDExternalUserAgentSession to
@@ -56,27 +78,53 @@ NS_ASSUME_NONNULL_BEGIN
     @param returnError The error if an error occurred while starting the local HTTP server.
     @param port The manually specified port, or 0 for a random available port.
     @return The URL containing the address of the server with the specified port, or nil if there was an error.
-    @discussion Each instance of @c EkoOIDRedirectHTTPHandler can only listen for a single response.
-        Calling this more than once will result in the previous listener being cancelled (equivalent
-        of @c cancelHTTPListener being called).
+    @discussion The listener is kept when it is running on @c port, or @c port is 0, so starting
+        it ahead of the request leaves no socket setup on the way to showing the browser. Only the
+        @c currentAuthorizationFlow is then cancelled, since the sessions registered with
+        @c addAuthorizationFlow:forState: are still waiting for their redirects. Otherwise the
+        listener is replaced (equivalent of @c cancelHTTPListener being called).
  */
 - (NSURL *)startHTTPListener:(NSError **)returnError withPort:(uint16_t)port;
 
+/*! @brief Starts listening on the loopback interface on the first available port of a range, and
+        returns a URL with the base address.
+    @param returnError The error if an error occurred while starting the local HTTP server.
+    @param portRange The ports to try in turn, such as the ones registered with the authorization
+        server.
+    @return The URL containing the address of the server with the port it is listening on, or nil
+        if no port of the range was available.
+    @discussion As with @c startHTTPListener:withPort:, a listener already running on a port of
+        the range is kept, and only its @c currentAuthorizationFlow is cancelled.
+ */
+- (nullable NSURL *)startHTTPListener:(NSError **)returnError withPortRange:(NSRange)portRange;
+
+/*! @brief Starts listening on a socket which the app has already bound to a loopback address and
+        set listening, and returns a URL with the base address.
+    @param returnError The error if the socket is not a listening loopback socket.
+    @param socket The listening socket. On success, the handler takes ownership of it.
+    @return The URL containing the address of the server with the port of the socket, or nil if
+        there was an error.
+    @discussion Binding the socket early, for instance at launch, leaves no socket setup on the
+        way to showing the browser. Any previous listener is cancelled (equivalent of
+        @c cancelHTTPListener being called).
+ */
+- (nullable NSURL *)startHTTPListener:(NSError **)returnError withListeningSocket:(int)socket;
+
 /*! @brief Starts listening on the loopback interface on a random available port, and returns a URL
         with the base address. Use the returned redirect URI to build a @c EkoOIDExternalUserAgentRequest,
         and once you initiate the request, set the resulting @c EkoOIDExternalUserAgentSession to
         @c currentAuthorizationFlow so the response can be handled.
     @param returnError The error if an error occurred while starting the local HTTP server.
     @return The URL containing the address of the server with the randomly assigned available port.
-    @discussion Each instance of @c EkoOIDRedirectHTTPHandler can only listen for a single response.
-        Calling this more than once will result in the previous listener being cancelled (equivalent
-        of @c cancelHTTPListener being called).
+    @discussion Calling this more than once cancels the @c currentAuthorizationFlow, and keeps
+        the listener running on its port along with its registered sessions.
  */
 - (NSURL *)startHTTPListener:(NSError **)returnError;
 
 /*! @brief Stops listening the loopback interface and sends an cancellation error (in the domain
         ::EkoOIDGeneralErrorDomain, with the code ::EkoOIDErrorCodeProgramCanceledAuthorizationFlow) to
-        the @c currentAuthorizationFlow.  Has no effect if called when no requests are pending.
+        the @c currentAuthorizationFlow and all registered sessions.  Has no effect if called when
+        no requests are pending.
     @discussion The HTTP listener is stopped automatically on receiving a valid response (regardless
         of whether the request succeeded or not), this method should not be called except when
         abandoning the external user-agent request.
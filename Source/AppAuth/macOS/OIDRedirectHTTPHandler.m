@@ -26,6 +26,11 @@
 #import "OIDErrorUtilities.h"
 #import "OIDExternalUserAgentSession.h"
 #import "OIDLoopbackHTTPServer.h"
+#import "OIDURLQueryComponent.h"
+
+/*! @brief The name of the parameter that identifies the request a redirect responds to.
+ */
+static NSString *const kStateParameter = @"state";
 
 /*! @brief Page that is returned following a completed authorization. Show your own page instead by
         supplying a URL in @c initWithSuccessURL that the user will be redirected to.
@@ -51,9 +56,56 @@ static NSString *const kHTMLErrorMissingCurrentAuthorizationFlow =
 static NSString *const kHTMLErrorRedirectNotValid =
     @"<html><body>AppAuth Error: Not a valid redirect.</body></html>";
 
+/*! @brief Serializes a response with an HTML body, ready to be written to a connection.
+    @param statusCode The HTTP status code of the response.
+    @param location The value of the @c Location header, or nil for none.
+    @param bodyText The HTML body of the response.
+ */
+static NSData *EkoOIDSerializedHTMLResponse(NSInteger statusCode,
+                                            NSURL *location,
+                                            NSString *bodyText) {
+  NSData *data = [bodyText dataUsingEncoding:NSUTF8StringEncoding];
+
+  CFHTTPMessageRef response = CFHTTPMessageCreateResponse(kCFAllocatorDefault,
+                                                          statusCode,
+                                                          NULL,
+                                                          kCFHTTPVersion1_1);
+  if (location) {
+    CFHTTPMessageSetHeaderFieldValue(response,
+                                     (__bridge CFStringRef)@"Location",
+                                     (__bridge CFStringRef)location.absoluteString);
+  }
+  CFHTTPMessageSetHeaderFieldValue(response,
+                                   (__bridge CFStringRef)@"Content-Length",
+                                   (__bridge CFStringRef)[NSString stringWithFormat:@"%lu",
+                                       (unsigned long)data.length]);
+  CFHTTPMessageSetBody(response, (__bridge CFDataRef)data);
+
+  NSData *serialized = (__bridge_transfer NSData *)CFHTTPMessageCopySerializedMessage(response);
+  CFRelease(response);
+  return serialized;
+}
+
 @implementation EkoOIDRedirectHTTPHandler {
   HTTPServer *_httpServ;
   NSURL *_successURL;
+
+  /*! @brief The response to a handled redirect: the completion page, or a redirect to
+          @c _successURL when one is set.
+   */
+  NSData *_successResponse;
+
+  /*! @brief The response to a request that is not a valid redirect.
+   */
+  NSData *_redirectNotValidResponse;
+
+  /*! @brief The response to a request received while there is no @c currentAuthorizationFlow.
+   */
+  NSData *_missingCurrentAuthorizationFlowResponse;
+
+  /*! @brief The sessions registered with @c addAuthorizationFlow:forState:, keyed by state.
+   */
+  NSMutableDictionary<NSString *, id<EkoOIDExternalUserAgentSession>> *_authorizationFlows;
 }
 
 - (instancetype)init {
@@ -64,26 +116,94 @@ static NSString *const kHTMLErrorRedirectNotValid =
   self = [super init];
   if (self) {
     _successURL = [successURL copy];
+    _authorizationFlows = [NSMutableDictionary dictionary];
+    // The responses never change, so they are serialized once rather than on every request.
+    _successResponse = EkoOIDSerializedHTMLResponse(_successURL ? 302 : 200,
+                                                    _successURL,
+                                                    kHTMLAuthorizationComplete);
+    _redirectNotValidResponse =
+        EkoOIDSerializedHTMLResponse(404, nil, kHTMLErrorRedirectNotValid);
+    _missingCurrentAuthorizationFlowResponse =
+        EkoOIDSerializedHTMLResponse(400, nil, kHTMLErrorMissingCurrentAuthorizationFlow);
   }
   return self;
 }
 
+- (void)addAuthorizationFlow:(id<EkoOIDExternalUserAgentSession>)session
+                    forState:(NSString *)state {
+  _authorizationFlows[state] = session;
+}
+
+- (void)removeAuthorizationFlowForState:(NSString *)state {
+  [_authorizationFlows removeObjectForKey:state];
+}
+
 - (NSURL *)startHTTPListener:(NSError **)returnError withPort:(uint16_t)port {
-  // Cancels any pending requests.
-  [self cancelHTTPListener];
+  // A listener already running on the port, or on any port if none is specified, is kept.
+  if (_httpServ && (port == 0 || port == [_httpServ port])) {
+    [self cancelCurrentAuthorizationFlow];
+    return [self listenerURL];
+  }
 
   // Starts a HTTP server on the loopback interface.
   // By not specifying a port, a random available one will be assigned.
+  return [self startHTTPListener:returnError withStartBlock:^BOOL(HTTPServer *server,
+                                                                  NSError **error) {
+    [server setPort:port];
+    return [server start:error];
+  }];
+}
+
+- (NSURL *)startHTTPListener:(NSError **)returnError withPortRange:(NSRange)portRange {
+  if (_httpServ && NSLocationInRange([_httpServ port], portRange)) {
+    [self cancelCurrentAuthorizationFlow];
+    return [self listenerURL];
+  }
+
+  return [self startHTTPListener:returnError withStartBlock:^BOOL(HTTPServer *server,
+                                                                  NSError **error) {
+    [server setPortRange:portRange];
+    return [server start:error];
+  }];
+}
+
+- (NSURL *)startHTTPListener:(NSError **)returnError withListeningSocket:(int)socket {
+  return [self startHTTPListener:returnError withStartBlock:^BOOL(HTTPServer *server,
+                                                                  NSError **error) {
+    return [server startWithListeningSocket:socket error:error];
+  }];
+}
+
+- (NSURL *)startHTTPListener:(NSError **)returnError {
+  // A port of 0 requests a random available port
+  return [self startHTTPListener:returnError withPort:0];
+}
+
+/*! @brief Replaces the listener with a new HTTP server, started by @c startBlock.
+    @param returnError The error if the server could not be started.
+    @param startBlock Configures and starts the server.
+    @return The URL of the new listener, or nil if there was an error.
+ */
+- (nullable NSURL *)startHTTPListener:(NSError **)returnError
+                       withStartBlock:(BOOL (^)(HTTPServer *server, NSError **error))startBlock {
+  // Cancels any pending requests.
+  [self cancelHTTPListener];
+
   _httpServ = [[HTTPServer alloc] init];
-  [_httpServ setPort:port];
   [_httpServ setDelegate:self];
   NSError *error = nil;
-  if (![_httpServ start:&error]) {
+  if (!startBlock(_httpServ, &error)) {
+    [self stopHTTPListener];
     if (returnError) {
       *returnError = error;
     }
     return nil;
-  } else if ([_httpServ hasIPv4Socket]) {
+  }
+  return [self listenerURL];
+}
+
+- (nullable NSURL *)listenerURL {
+  if ([_httpServ hasIPv4Socket]) {
     // Prefer the IPv4 loopback address
     NSString *serverURL = [NSString stringWithFormat:@"http://127.0.0.1:%d/", [_httpServ port]];
     return [NSURL URLWithString:serverURL];
@@ -96,23 +216,41 @@ static NSString *const kHTMLErrorRedirectNotValid =
   return nil;
 }
 
-- (NSURL *)startHTTPListener:(NSError **)returnError {
-  // A port of 0 requests a random available port
-  return [self startHTTPListener:returnError withPort:0];
-}
-
 - (void)cancelHTTPListener {
   [self stopHTTPListener];
+  [self cancelAuthorizationFlows];
+}
 
-  // Cancels the pending authorization flow (if any) with error.
-  NSError *cancelledError =
-      [EkoOIDErrorUtilities errorWithCode:EkoOIDErrorCodeProgramCanceledAuthorizationFlow
-                       underlyingError:nil
-                           description:@"The HTTP listener was cancelled programmatically."];
-  [_currentAuthorizationFlow failExternalUserAgentFlowWithError:cancelledError];
+/*! @brief The error the sessions cancelled by the listener fail with.
+ */
+static NSError *EkoOIDListenerCancelledError(void) {
+  return [EkoOIDErrorUtilities errorWithCode:EkoOIDErrorCodeProgramCanceledAuthorizationFlow
+                             underlyingError:nil
+                                 description:@"The HTTP listener was cancelled programmatically."];
+}
+
+/*! @brief Cancels the @c currentAuthorizationFlow with an error, leaving the registered sessions
+        and the listener running.
+ */
+- (void)cancelCurrentAuthorizationFlow {
+  [_currentAuthorizationFlow failExternalUserAgentFlowWithError:EkoOIDListenerCancelledError()];
   _currentAuthorizationFlow = nil;
 }
 
+/*! @brief Cancels the @c currentAuthorizationFlow and all registered sessions with an error,
+        without stopping the listener.
+ */
+- (void)cancelAuthorizationFlows {
+  // Cancels the pending authorization flow (if any) with error.
+  [self cancelCurrentAuthorizationFlow];
+  NSError *cancelledError = EkoOIDListenerCancelledError();
+  NSArray<id<EkoOIDExternalUserAgentSession>> *authorizationFlows = _authorizationFlows.allValues;
+  [_authorizationFlows removeAllObjects];
+  for (id<EkoOIDExternalUserAgentSession> authorizationFlow in authorizationFlows) {
+    [authorizationFlow failExternalUserAgentFlowWithError:cancelledError];
+  }
+}
+
 /*! @brief Stops listening on the loopback interface without modifying the state of the
         @c currentAuthorizationFlow. Should be called when the authorization flow completes or is
         cancelled.
@@ -124,48 +262,42 @@ static NSString *const kHTMLErrorRedirectNotValid =
 }
 
 - (void)HTTPConnection:(HTTPConnection *)conn didReceiveRequest:(HTTPServerRequest *)mess {
-  // Sends URL to AppAuth.
-  CFURLRef url = CFHTTPMessageCopyRequestURL(mess.request);
-  BOOL handled = [_currentAuthorizationFlow resumeExternalUserAgentFlowWithURL:(__bridge NSURL *)url];
+  NSURL *URL = (__bridge_transfer NSURL *)CFHTTPMessageCopyRequestURL(mess.request);
 
-  // Stops listening to further requests after the first valid authorization response.
-  if (handled) {
-    _currentAuthorizationFlow = nil;
-    [self stopHTTPListener];
-  }
+  // Routes the redirect to the session registered for its state, if any.
+  NSString *state =
+      [[[EkoOIDURLQueryComponent alloc] initWithURL:URL] valuesForParameter:kStateParameter]
+          .firstObject;
+  id<EkoOIDExternalUserAgentSession> registeredFlow = state ? _authorizationFlows[state] : nil;
 
-  // Responds to browser request.
-  NSString *bodyText = kHTMLAuthorizationComplete;
-  NSInteger httpResponseCode = (_successURL) ? 302 : 200;
-  // Returns an error page if a URL other than the expected redirect is requested.
-  if (!handled) {
-    if (_currentAuthorizationFlow) {
-      bodyText = kHTMLErrorRedirectNotValid;
-      httpResponseCode = 404;
-    } else {
-      bodyText = kHTMLErrorMissingCurrentAuthorizationFlow;
-      httpResponseCode = 400;
+  // Sends URL to AppAuth.
+  BOOL handled = NO;
+  if (registeredFlow) {
+    handled = [registeredFlow resumeExternalUserAgentFlowWithURL:URL];
+    if (handled) {
+      [_authorizationFlows removeObjectForKey:state];
+    }
+  } else {
+    handled = [_currentAuthorizationFlow resumeExternalUserAgentFlowWithURL:URL];
+    // Stops listening to further requests after the first valid authorization response, unless
+    // registered sessions are still waiting for theirs.
+    if (handled) {
+      _currentAuthorizationFlow = nil;
+      if (!_authorizationFlows.count) {
+        [self stopHTTPListener];
+      }
     }
   }
-  NSData *data = [bodyText dataUsingEncoding:NSUTF8StringEncoding];
 
-  CFHTTPMessageRef response = CFHTTPMessageCreateResponse(kCFAllocatorDefault,
-                                                          httpResponseCode,
-                                                          NULL,
-                                                          kCFHTTPVersion1_1);
-  if (httpResponseCode == 302) {
-    CFHTTPMessageSetHeaderFieldValue(response,
-                                     (__bridge CFStringRef)@"Location",
-                                     (__bridge CFStringRef)_successURL.absoluteString);
+  // Responds to browser request, with an error page if a URL other than the expected redirect
+  // is requested.
+  NSData *response = _successResponse;
+  if (!handled) {
+    BOOL hasAuthorizationFlow = _currentAuthorizationFlow || _authorizationFlows.count;
+    response = hasAuthorizationFlow ? _redirectNotValidResponse
+                                    : _missingCurrentAuthorizationFlowResponse;
   }
-  CFHTTPMessageSetHeaderFieldValue(response,
-                                   (__bridge CFStringRef)@"Content-Length",
-                                   (__bridge CFStringRef)[NSString stringWithFormat:@"%lu",
-                                       (unsigned long)data.length]);
-  CFHTTPMessageSetBody(response, (__bridge CFDataRef)data);
-
-  [mess setResponse:response];
-  CFRelease(response);
+  [mess setResponseData:response];
 }
 
 - (void)dealloc {
@@ -21,6 +21,7 @@
 @class EkoOIDAuthorizationResponse;
 @class EkoOIDAuthState;
 @class EkoOIDRegistrationResponse;
+@class EkoOIDScopeSet;
 @class EkoOIDTokenResponse;
 @class EkoOIDTokenRequest;
 @protocol EkoOIDAuthStateChangeDelegate;
@@ -68,6 +69,11 @@ typedef void (^EkoOIDAuthStateAuthorizationCallback)(EkoOIDAuthState *_Nullable
  */
 @property(nonatomic, readonly, nullable) NSString *scope;
 
+/*! @brief The scope of the current authorization grant as a scope set, which is empty if there is
+        no scope.
+ */
+@property(nonatomic, readonly) EkoOIDScopeSet *scopeSet;
+
 /*! @brief The most recent authorization response used to update the authorization state. For the
         implicit flow, this will contain the latest access token.
  */
@@ -116,6 +122,13 @@ typedef void (^EkoOIDAuthStateAuthorizationCallback)(EkoOIDAuthState *_Nullable
  */
 @property(nonatomic, weak, nullable) id<EkoOIDAuthStateErrorDelegate> errorDelegate;
 
+/*! @brief If YES, the state calls @c EkoOIDAuthState.compactHistory after every token response,
+        keeping only what it needs to refresh tokens. Setting it to YES compacts the state
+        immediately. Changing it calls @c EkoOIDAuthStateChangeDelegate.didChangeState:, as it is
+        archived with the state. Defaults to NO.
+ */
+@property(nonatomic) BOOL compactsHistory;
+
 /*! @brief Convenience method to create a @c EkoOIDAuthState by presenting an authorization request
         and performing the authorization code exchange in the case of code flow requests. For
         the hybrid flow, the caller should validate the id_token and c_hash, then perform the token
@@ -242,11 +255,53 @@ typedef void (^EkoOIDAuthStateAuthorizationCallback)(EkoOIDAuthState *_Nullable
     (nullable NSDictionary<NSString *, NSString *> *)additionalParameters
                        dispatchQueue:(dispatch_queue_t)dispatchQueue;
 
+/*! @brief Calls the block with a valid access token for a resource and scope (refreshing it
+        first, if needed), or if a refresh was needed and failed, with the error that caused it to
+        fail.
+    @param action The block to execute with a fresh token.
+    @param resource The resource indicator of the API the token is for, or nil.
+    @param scopeSet The scopes the token should be limited to, or nil for the granted scope.
+    @param dispatchQueue The dispatchQueue on which to dispatch the action block.
+    @discussion Access tokens are cached per resource and scope set, each with its own expiry, and
+        concurrent calls for the same resource and scope set share one refresh. The refresh uses
+        the state's refresh token, which is replaced if the server rotates it, but the tokens don't
+        replace the state's own access token. Cached tokens aren't archived, and are discarded
+        when the authorization changes or @c EkoOIDAuthState.setNeedsTokenRefresh is called. With
+        no resource or scope set, this is the same as
+        @c EkoOIDAuthState.performActionWithFreshTokens:additionalRefreshParameters:dispatchQueue:.
+    @see https://tools.ietf.org/html/rfc8707
+ */
+- (void)performActionWithFreshTokens:(EkoOIDAuthStateAction)action
+                         forResource:(nullable NSString *)resource
+                            scopeSet:(nullable EkoOIDScopeSet *)scopeSet
+                       dispatchQueue:(dispatch_queue_t)dispatchQueue;
+
 /*! @brief Forces a token refresh the next time @c EkoOIDAuthState.performActionWithFreshTokens: is
         called, even if the current tokens are considered valid.
  */
 - (void)setNeedsTokenRefresh;
 
+/*! @brief Returns YES if the current authorization grant includes every scope in @c scopeSet.
+    @param scopeSet The scopes required by the caller.
+    @discussion This is a bitset comparison, so it is cheap enough to call before every request.
+ */
+- (BOOL)isAuthorizedForScopeSet:(EkoOIDScopeSet *)scopeSet;
+
+/*! @brief Reduces the state to what it needs to keep refreshing tokens.
+    @discussion Replaces @c EkoOIDAuthState.lastAuthorizationResponse with a response to an
+        authorization request which only has the configuration, client credentials, scope,
+        redirect URL and response type of the original. Replaces
+        @c EkoOIDAuthState.lastTokenResponse with a response which only has the typed token
+        properties, and discards @c EkoOIDAuthState.lastRegistrationResponse. The authorization
+        code, PKCE verifier, state, nonce and additional parameters of the original requests and
+        responses are dropped.
+
+        Does nothing until the state has a token response, since the code exchange still needs the
+        full authorization response. Calls @c EkoOIDAuthStateChangeDelegate.didChangeState: if
+        anything was compacted, so that the compacted state can be saved.
+ */
+- (void)compactHistory;
+
 /*! @brief Creates a token request suitable for refreshing an access token.
     @return A @c EkoOIDTokenRequest suitable for using a refresh token to obtain a new access token.
     @discussion After performing the refresh, call @c EkoOIDAuthState.updateWithTokenResponse:error:
@@ -27,9 +27,12 @@
 #import "OIDError.h"
 #import "OIDErrorUtilities.h"
 #import "OIDRegistrationResponse.h"
+#import "OIDScopeSet.h"
+#import "OIDServiceConfiguration.h"
 #import "OIDTokenRequest.h"
 #import "OIDTokenResponse.h"
 #import "OIDTokenUtilities.h"
+#import "OIDURLQueryComponent.h"
 
 /*! @brief Key used to encode the @c refreshToken property for @c NSSecureCoding.
  */
@@ -55,6 +58,10 @@ static NSString *const kLastTokenResponseKey = @"lastTokenResponse";
  */
 static NSString *const kAuthorizationErrorKey = @"authorizationError";
 
+/*! @brief Key used to encode the @c compactsHistory property for @c NSSecureCoding.
+ */
+static NSString *const kCompactsHistoryKey = @"compactsHistory";
+
 /*! @brief The exception thrown when a developer tries to create a refresh request from an
         authorization request with no authorization code.
  */
@@ -65,6 +72,153 @@ static NSString *const kRefreshTokenRequestException =
  */
 static const NSUInteger kExpiryTimeTolerance = 60;
 
+/*! @brief Token request parameter names used when building refresh requests.
+    @see https://tools.ietf.org/html/rfc6749#section-6
+ */
+static NSString *const kGrantTypeParameter = @"grant_type";
+static NSString *const kRefreshTokenParameter = @"refresh_token";
+static NSString *const kClientIDParameter = @"client_id";
+static NSString *const kScopeParameter = @"scope";
+
+/*! @brief Token request parameter naming the resource a refreshed access token is for.
+    @see https://tools.ietf.org/html/rfc8707#section-2
+ */
+static NSString *const kResourceParameter = @"resource";
+
+/*! @brief Token response parameter names used when compacting token responses. The refresh token
+        and scope are returned under the same names as they are requested with.
+    @see https://tools.ietf.org/html/rfc6749#section-5.1
+    @see http://openid.net/specs/openid-connect-core-1_0.html#TokenResponse
+ */
+static NSString *const kAccessTokenParameter = @"access_token";
+static NSString *const kTokenTypeParameter = @"token_type";
+static NSString *const kExpiresInParameter = @"expires_in";
+static NSString *const kIDTokenParameter = @"id_token";
+
+/*! @brief The parts of a token refresh request which are the same for every refresh of an
+        authorization, prepared once so that a refresh only needs to encode the refresh token.
+ */
+@interface EkoOIDTokenRefreshTemplate : NSObject
+@property(nonatomic, readonly) EkoOIDAuthorizationRequest *authorizationRequest;
+- (instancetype)initWithAuthorizationRequest:(EkoOIDAuthorizationRequest *)authorizationRequest;
+- (NSURLRequest *)URLRequestWithRefreshToken:(NSString *)refreshToken
+                        additionalParameters:
+    (nullable NSDictionary<NSString *, NSString *> *)additionalParameters;
+@end
+@implementation EkoOIDTokenRefreshTemplate {
+  /*! @brief The token endpoint of the authorization's configuration.
+   */
+  NSURL *_tokenEndpoint;
+
+  /*! @brief The request headers, including the Basic Authorization header if the client has a
+        secret.
+   */
+  NSDictionary<NSString *, NSString *> *_headers;
+
+  /*! @brief The encoded grant type, which starts every refresh request body.
+   */
+  NSData *_bodyPrefix;
+
+  /*! @brief The encoded client identifier for clients without a secret, which ends every refresh
+        request body.
+   */
+  NSData *_bodySuffix;
+}
+- (instancetype)initWithAuthorizationRequest:(EkoOIDAuthorizationRequest *)authorizationRequest {
+  self = [super init];
+  if (self) {
+    _authorizationRequest = authorizationRequest;
+    _tokenEndpoint = authorizationRequest.configuration.tokenEndpoint;
+
+    NSMutableDictionary<NSString *, NSString *> *headers = [NSMutableDictionary dictionary];
+    headers[@"Content-Type"] = @"application/x-www-form-urlencoded; charset=UTF-8";
+    NSMutableData *bodyPrefix = [NSMutableData data];
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kGrantTypeParameter
+                                                 value:EkoOIDGrantTypeRefreshToken
+                                                toData:bodyPrefix];
+    NSMutableData *bodySuffix = [NSMutableData data];
+    if (authorizationRequest.clientSecret) {
+      headers[@"Authorization"] = [EkoOIDTokenUtilities
+          basicAuthorizationHeaderValueWithClientID:authorizationRequest.clientID
+                                       clientSecret:authorizationRequest.clientSecret];
+    } else {
+      // The suffix always follows the body prefix, so it carries its own separator.
+      NSMutableData *clientIDParameter = [NSMutableData data];
+      [EkoOIDURLQueryComponent appendURLEncodedParameter:kClientIDParameter
+                                                   value:authorizationRequest.clientID
+                                                  toData:clientIDParameter];
+      [bodySuffix appendBytes:"&" length:1];
+      [bodySuffix appendData:clientIDParameter];
+    }
+    _headers = [headers copy];
+    _bodyPrefix = [bodyPrefix copy];
+    _bodySuffix = [bodySuffix copy];
+  }
+  return self;
+}
+- (NSURLRequest *)URLRequestWithRefreshToken:(NSString *)refreshToken
+                        additionalParameters:
+    (nullable NSDictionary<NSString *, NSString *> *)additionalParameters {
+  NSMutableURLRequest *URLRequest = [NSMutableURLRequest requestWithURL:_tokenEndpoint];
+  URLRequest.HTTPMethod = @"POST";
+  URLRequest.allHTTPHeaderFields = _headers;
+
+  // Matches the parameter order of -[EkoOIDTokenRequest URLRequest].
+  NSMutableData *body = [NSMutableData dataWithCapacity:_bodyPrefix.length + _bodySuffix.length
+                                                        + refreshToken.length * 3 + 32];
+  [body appendData:_bodyPrefix];
+  [EkoOIDURLQueryComponent appendURLEncodedParameter:kRefreshTokenParameter
+                                               value:refreshToken
+                                              toData:body];
+  [EkoOIDURLQueryComponent appendURLEncodedParameters:additionalParameters toData:body];
+  [body appendData:_bodySuffix];
+  URLRequest.HTTPBody = body;
+  return URLRequest;
+}
+@end
+
+/*! @brief A token refresh request whose URL request is built from an
+        @c EkoOIDTokenRefreshTemplate.
+    @discussion Archives as a plain @c EkoOIDTokenRequest.
+ */
+@interface EkoOIDTokenRefreshRequest : EkoOIDTokenRequest
+- (instancetype)initWithTemplate:(EkoOIDTokenRefreshTemplate *)refreshTemplate
+                    refreshToken:(NSString *)refreshToken
+            additionalParameters:
+    (nullable NSDictionary<NSString *, NSString *> *)additionalParameters;
+@end
+@implementation EkoOIDTokenRefreshRequest {
+  EkoOIDTokenRefreshTemplate *_template;
+}
+- (instancetype)initWithTemplate:(EkoOIDTokenRefreshTemplate *)refreshTemplate
+                    refreshToken:(NSString *)refreshToken
+            additionalParameters:
+    (nullable NSDictionary<NSString *, NSString *> *)additionalParameters {
+  EkoOIDAuthorizationRequest *authorizationRequest = refreshTemplate.authorizationRequest;
+  self = [super initWithConfiguration:authorizationRequest.configuration
+                            grantType:EkoOIDGrantTypeRefreshToken
+                    authorizationCode:nil
+                          redirectURL:nil
+                             clientID:authorizationRequest.clientID
+                         clientSecret:authorizationRequest.clientSecret
+                                scope:nil
+                         refreshToken:refreshToken
+                         codeVerifier:nil
+                 additionalParameters:additionalParameters];
+  if (self) {
+    _template = refreshTemplate;
+  }
+  return self;
+}
+- (NSURLRequest *)URLRequest {
+  return [_template URLRequestWithRefreshToken:self.refreshToken
+                          additionalParameters:self.additionalParameters];
+}
+- (Class)classForCoder {
+  return [EkoOIDTokenRequest class];
+}
+@end
+
 /*! @brief Object to hold EkoOIDAuthState pending actions.
  */
 @interface EkoOIDAuthStatePendingAction : NSObject
@@ -82,6 +236,27 @@ static const NSUInteger kExpiryTimeTolerance = 60;
 }
 @end
 
+/*! @brief An access token cached by @c EkoOIDAuthState for a resource and scope set, with the
+        actions waiting for it to be refreshed.
+    @discussion All properties are guarded by the auth state's @c _pendingActionsSyncObject.
+ */
+@interface EkoOIDCachedAccessToken : NSObject
+@property(nonatomic, copy, nullable) NSString *accessToken;
+@property(nonatomic, nullable) NSDate *accessTokenExpirationDate;
+@property(nonatomic, nullable) NSMutableArray<EkoOIDAuthStatePendingAction *> *pendingActions;
+- (BOOL)isFresh;
+@end
+@implementation EkoOIDCachedAccessToken
+- (BOOL)isFresh {
+  if (!_accessToken) {
+    return NO;
+  }
+  // as with the state's own token, a token without an expiration time is assumed to never expire
+  return !_accessTokenExpirationDate
+      || [_accessTokenExpirationDate timeIntervalSinceNow] > kExpiryTimeTolerance;
+}
+@end
+
 @interface EkoOIDAuthState ()
 
 /*! @brief The access token generated by the authorization server.
@@ -121,6 +296,26 @@ static const NSUInteger kExpiryTimeTolerance = 60;
   /*! @brief If YES, tokens will be refreshed on the next API call regardless of expiry.
    */
   BOOL _needsTokenRefresh;
+
+  /*! @brief The refresh request template for the current authorization, built on first refresh
+        (use @c _pendingActionsSyncObject to synchronize access).
+   */
+  EkoOIDTokenRefreshTemplate *_refreshRequestTemplate;
+
+  /*! @brief The authorization response created by the last compaction, so that compacting again
+        doesn't rebuild it.
+   */
+  __weak EkoOIDAuthorizationResponse *_compactAuthorizationResponse;
+
+  /*! @brief The token response created by the last compaction.
+   */
+  __weak EkoOIDTokenResponse *_compactTokenResponse;
+
+  /*! @brief Access tokens for specific resources and scopes, keyed by an array of the resource (or
+        @c NSNull) and the scope set (or @c NSNull) (use @c _pendingActionsSyncObject to
+        synchronize access).
+   */
+  NSMutableDictionary<NSArray *, EkoOIDCachedAccessToken *> *_accessTokenCache;
 }
 
 #pragma mark - Convenience initializers
@@ -274,6 +469,7 @@ static const NSUInteger kExpiryTimeTolerance = 60;
     _scope = [aDecoder decodeObjectOfClass:[NSString class] forKey:kScopeKey];
     _refreshToken = [aDecoder decodeObjectOfClass:[NSString class] forKey:kRefreshTokenKey];
     _needsTokenRefresh = [aDecoder decodeBoolForKey:kNeedsTokenRefreshKey];
+    _compactsHistory = [aDecoder decodeBoolForKey:kCompactsHistoryKey];
   }
   return self;
 }
@@ -290,6 +486,7 @@ static const NSUInteger kExpiryTimeTolerance = 60;
   [aCoder encodeObject:_scope forKey:kScopeKey];
   [aCoder encodeObject:_refreshToken forKey:kRefreshTokenKey];
   [aCoder encodeBool:_needsTokenRefresh forKey:kNeedsTokenRefreshKey];
+  [aCoder encodeBool:_compactsHistory forKey:kCompactsHistoryKey];
 }
 
 #pragma mark - Private convenience getters
@@ -332,9 +529,19 @@ static const NSUInteger kExpiryTimeTolerance = 60;
   return !self.authorizationError && (self.accessToken || self.idToken || self.refreshToken);
 }
 
+- (EkoOIDScopeSet *)scopeSet {
+  // Scope sets are cached by scope string, so this doesn't split the string again.
+  return [EkoOIDScopeSet scopeSetWithString:_scope];
+}
+
+- (BOOL)isAuthorizedForScopeSet:(EkoOIDScopeSet *)scopeSet {
+  return self.isAuthorized && [scopeSet isSubsetOfScopeSet:self.scopeSet];
+}
+
 #pragma mark - Updating the state
 
 - (void)updateWithRegistrationResponse:(EkoOIDRegistrationResponse *)registrationResponse {
+  [self discardCachedAccessTokens];
   _lastRegistrationResponse = registrationResponse;
   _refreshToken = nil;
   _scope = nil;
@@ -356,6 +563,7 @@ static const NSUInteger kExpiryTimeTolerance = 60;
   }
 
   _lastAuthorizationResponse = authorizationResponse;
+  [self discardCachedAccessTokens];
 
   // clears the last token response and refresh token as these now relate to an old authorization
   // that is no longer relevant
@@ -407,17 +615,112 @@ static const NSUInteger kExpiryTimeTolerance = 60;
     _refreshToken = tokenResponse.refreshToken;
   }
 
+  if (_compactsHistory) {
+    [self compactHistoryWithoutNotifying];
+  }
+
   [self didChangeState];
 }
 
 - (void)updateWithAuthorizationError:(NSError *)oauthError {
   _authorizationError = oauthError;
+  [self discardCachedAccessTokens];
 
   [self didChangeState];
 
   [_errorDelegate authState:self didEncounterAuthorizationError:oauthError];
 }
 
+#pragma mark - Compaction
+
+- (void)setCompactsHistory:(BOOL)compactsHistory {
+  // The flag is archived with the state, so changing it is a state change too.
+  BOOL changed = _compactsHistory != compactsHistory;
+  _compactsHistory = compactsHistory;
+  if (compactsHistory && [self compactHistoryWithoutNotifying]) {
+    changed = YES;
+  }
+  if (changed) {
+    [self didChangeState];
+  }
+}
+
+- (void)compactHistory {
+  if ([self compactHistoryWithoutNotifying]) {
+    [self didChangeState];
+  }
+}
+
+/*! @brief Compacts the history as described by @c compactHistory, leaving it to the caller to
+        notify the @c stateChangeDelegate.
+    @return Whether any of the archived responses changed.
+ */
+- (BOOL)compactHistoryWithoutNotifying {
+  EkoOIDTokenResponse *tokenResponse = _lastTokenResponse;
+  EkoOIDAuthorizationResponse *authorizationResponse = _lastAuthorizationResponse;
+  if (!tokenResponse || !authorizationResponse) {
+    return NO;
+  }
+  BOOL changed = _lastRegistrationResponse != nil;
+  _lastRegistrationResponse = nil;
+
+  EkoOIDAuthorizationRequest *request = authorizationResponse.request;
+  if (authorizationResponse != _compactAuthorizationResponse) {
+    EkoOIDAuthorizationRequest *compactRequest =
+        [[EkoOIDAuthorizationRequest alloc] initWithConfiguration:request.configuration
+                                                         clientId:request.clientID
+                                                     clientSecret:request.clientSecret
+                                                            scope:request.scope
+                                                      redirectURL:request.redirectURL
+                                                     responseType:request.responseType
+                                                            state:nil
+                                                            nonce:nil
+                                                     codeVerifier:nil
+                                                    codeChallenge:nil
+                                              codeChallengeMethod:nil
+                                             additionalParameters:nil];
+    EkoOIDAuthorizationResponse *compactResponse =
+        [[EkoOIDAuthorizationResponse alloc] initWithRequest:compactRequest parameters:@{ }];
+    _lastAuthorizationResponse = compactResponse;
+    _compactAuthorizationResponse = compactResponse;
+    changed = YES;
+  }
+
+  if (tokenResponse != _compactTokenResponse) {
+    // A request which identifies the client, in place of the code exchange request with its
+    // authorization code and PKCE verifier.
+    EkoOIDTokenRequest *compactRequest =
+        [[EkoOIDTokenRequest alloc] initWithConfiguration:request.configuration
+                                                grantType:EkoOIDGrantTypeRefreshToken
+                                        authorizationCode:nil
+                                              redirectURL:nil
+                                                 clientID:request.clientID
+                                             clientSecret:request.clientSecret
+                                                    scope:nil
+                                             refreshToken:nil
+                                             codeVerifier:nil
+                                     additionalParameters:nil];
+    NSMutableDictionary<NSString *, NSObject<NSCopying> *> *parameters =
+        [NSMutableDictionary dictionary];
+    parameters[kAccessTokenParameter] = tokenResponse.accessToken;
+    parameters[kTokenTypeParameter] = tokenResponse.tokenType;
+    parameters[kIDTokenParameter] = tokenResponse.idToken;
+    parameters[kRefreshTokenParameter] = tokenResponse.refreshToken;
+    parameters[kScopeParameter] = tokenResponse.scope;
+    NSDate *expirationDate = tokenResponse.accessTokenExpirationDate;
+    if (expirationDate) {
+      // Rounded down, so the compacted token never appears fresh for longer than the original.
+      parameters[kExpiresInParameter] = @(floor([expirationDate timeIntervalSinceNow]));
+    }
+    EkoOIDTokenResponse *compactResponse =
+        [[EkoOIDTokenResponse alloc] initWithRequest:compactRequest parameters:parameters];
+    _lastTokenResponse = compactResponse;
+    _compactTokenResponse = compactResponse;
+    changed = YES;
+  }
+  return changed;
+}
+
 #pragma mark - OAuth Requests
 
 - (EkoOIDTokenRequest *)tokenRefreshRequest {
@@ -432,6 +735,12 @@ static const NSUInteger kExpiryTimeTolerance = 60;
   if (!_refreshToken) {
     [EkoOIDErrorUtilities raiseException:kRefreshTokenRequestException];
   }
+  EkoOIDTokenRefreshTemplate *refreshTemplate = [self refreshRequestTemplate];
+  if (refreshTemplate) {
+    return [[EkoOIDTokenRefreshRequest alloc] initWithTemplate:refreshTemplate
+                                                  refreshToken:_refreshToken
+                                          additionalParameters:additionalParameters];
+  }
   return [[EkoOIDTokenRequest alloc]
       initWithConfiguration:_lastAuthorizationResponse.request.configuration
                   grantType:EkoOIDGrantTypeRefreshToken
@@ -445,6 +754,23 @@ static const NSUInteger kExpiryTimeTolerance = 60;
        additionalParameters:additionalParameters];
 }
 
+/*! @brief Returns the refresh request template for the current authorization request, creating
+        it if the authorization request has changed since it was last built.
+ */
+- (nullable EkoOIDTokenRefreshTemplate *)refreshRequestTemplate {
+  EkoOIDAuthorizationRequest *authorizationRequest = _lastAuthorizationResponse.request;
+  if (!authorizationRequest) {
+    return nil;
+  }
+  @synchronized(_pendingActionsSyncObject) {
+    if (_refreshRequestTemplate.authorizationRequest != authorizationRequest) {
+      _refreshRequestTemplate =
+          [[EkoOIDTokenRefreshTemplate alloc] initWithAuthorizationRequest:authorizationRequest];
+    }
+    return _refreshRequestTemplate;
+  }
+}
+
 #pragma mark - Stateful Actions
 
 - (void)didChangeState {
@@ -453,6 +779,16 @@ static const NSUInteger kExpiryTimeTolerance = 60;
 
 - (void)setNeedsTokenRefresh {
   _needsTokenRefresh = YES;
+  [self discardCachedAccessTokens];
+}
+
+/*! @brief Drops the access tokens cached for specific resources and scopes. Refreshes which are
+        already in progress still call their pending actions.
+ */
+- (void)discardCachedAccessTokens {
+  @synchronized(_pendingActionsSyncObject) {
+    [_accessTokenCache removeAllObjects];
+  }
 }
 
 - (void)performActionWithFreshTokens:(EkoOIDAuthStateAction)action {
@@ -544,6 +880,110 @@ static const NSUInteger kExpiryTimeTolerance = 60;
   }];
 }
 
+- (void)performActionWithFreshTokens:(EkoOIDAuthStateAction)action
+                         forResource:(nullable NSString *)resource
+                            scopeSet:(nullable EkoOIDScopeSet *)scopeSet
+                       dispatchQueue:(dispatch_queue_t)dispatchQueue {
+  if (!resource && !scopeSet) {
+    [self performActionWithFreshTokens:action
+           additionalRefreshParameters:nil
+                         dispatchQueue:dispatchQueue];
+    return;
+  }
+
+  NSArray *cacheKey = @[ resource ?: [NSNull null], scopeSet ?: [NSNull null] ];
+  NSString *refreshToken = _refreshToken;
+  NSString *cachedAccessToken;
+  EkoOIDCachedAccessToken *cachedToken;
+  EkoOIDAuthStatePendingAction* pendingAction =
+      [[EkoOIDAuthStatePendingAction alloc] initWithAction:action andDispatchQueue:dispatchQueue];
+  NSAssert(_pendingActionsSyncObject, @"_pendingActionsSyncObject cannot be nil", @"");
+  @synchronized(_pendingActionsSyncObject) {
+    cachedToken = _accessTokenCache[cacheKey];
+    if ([cachedToken isFresh]) {
+      cachedAccessToken = cachedToken.accessToken;
+    } else if (cachedToken.pendingActions) {
+      // a token for this resource and scope is already being refreshed
+      [cachedToken.pendingActions addObject:pendingAction];
+      return;
+    } else if (refreshToken) {
+      if (!cachedToken) {
+        if (!_accessTokenCache) {
+          _accessTokenCache = [NSMutableDictionary dictionary];
+        }
+        cachedToken = [[EkoOIDCachedAccessToken alloc] init];
+        _accessTokenCache[cacheKey] = cachedToken;
+      }
+      cachedToken.pendingActions = [NSMutableArray arrayWithObject:pendingAction];
+    }
+  }
+
+  if (cachedAccessToken) {
+    dispatch_async(dispatchQueue, ^{
+      action(cachedAccessToken, self.idToken, nil);
+    });
+    return;
+  }
+
+  if (!refreshToken) {
+    NSError *tokenRefreshError = [
+      EkoOIDErrorUtilities errorWithCode:EkoOIDErrorCodeTokenRefreshError
+                      underlyingError:nil
+                          description:@"Unable to refresh expired token without a refresh token."];
+    dispatch_async(dispatchQueue, ^{
+      action(nil, nil, tokenRefreshError);
+    });
+    return;
+  }
+
+  NSMutableDictionary<NSString *, NSString *> *additionalParameters =
+      [NSMutableDictionary dictionary];
+  additionalParameters[kResourceParameter] = resource;
+  additionalParameters[kScopeParameter] = scopeSet.scopeString;
+  EkoOIDTokenRequest *tokenRefreshRequest =
+      [self tokenRefreshRequestWithAdditionalParameters:additionalParameters];
+  [EkoOIDAuthorizationService performTokenRequest:tokenRefreshRequest
+                 originalAuthorizationResponse:_lastAuthorizationResponse
+                                      callback:^(EkoOIDTokenResponse *_Nullable response,
+                                                 NSError *_Nullable error) {
+    // the response doesn't replace the state's own access token, but a rotated refresh token
+    // replaces the one it was issued for
+    if (response.refreshToken && [self->_refreshToken isEqualToString:refreshToken]
+        && ![response.refreshToken isEqualToString:refreshToken]) {
+      self->_refreshToken = response.refreshToken;
+      [self didChangeState];
+    }
+    if (!response) {
+      if (error.domain == EkoOIDOAuthTokenErrorDomain) {
+        // other token errors, such as invalid_target, only concern this resource and scope
+        if (error.code == EkoOIDErrorCodeOAuthTokenInvalidGrant) {
+          [self updateWithAuthorizationError:error];
+        }
+      } else if ([self->_errorDelegate respondsToSelector:
+                     @selector(authState:didEncounterTransientError:)]) {
+        [self->_errorDelegate authState:self didEncounterTransientError:error];
+      }
+    }
+
+    NSString *accessToken = response.accessToken;
+    NSArray *actionsToProcess;
+    @synchronized(self->_pendingActionsSyncObject) {
+      actionsToProcess = cachedToken.pendingActions;
+      cachedToken.pendingActions = nil;
+      cachedToken.accessToken = accessToken;
+      cachedToken.accessTokenExpirationDate = response.accessTokenExpirationDate;
+      if (!accessToken && self->_accessTokenCache[cacheKey] == cachedToken) {
+        [self->_accessTokenCache removeObjectForKey:cacheKey];
+      }
+    }
+    for (EkoOIDAuthStatePendingAction* actionToProcess in actionsToProcess) {
+      dispatch_async(actionToProcess.dispatchQueue, ^{
+        actionToProcess.action(accessToken, self.idToken, error);
+      });
+    }
+  }];
+}
+
 #pragma mark -
 
 /*! @fn isTokenFresh
@@ -138,11 +138,11 @@ NSString *const EkoOIDOAuthorizationRequestCodeChallengeMethodS256 = @"S256";
   self = [super init];
   if (self) {
     _configuration = [configuration copy];
-    _clientID = [clientID copy];
+    _clientID = [EkoOIDTokenUtilities internedString:clientID];
     _clientSecret = [clientSecret copy];
-    _scope = [scope copy];
-    _redirectURL = [redirectURL copy];
-    _responseType = [responseType copy];
+    _scope = [EkoOIDTokenUtilities internedString:scope];
+    _redirectURL = [EkoOIDTokenUtilities internedURL:redirectURL];
+    _responseType = [EkoOIDTokenUtilities internedString:responseType];
     if (![[self class] isSupportedResponseType:_responseType]) {
       NSAssert(NO, EkoOIDOAuthUnsupportedResponseTypeMessage, _responseType);
       return nil;
@@ -25,38 +25,6 @@
 #import "OIDTokenRequest.h"
 #import "OIDTokenUtilities.h"
 
-/*! @brief The key for the @c authorizationCode property in the incoming parameters and for
-        @c NSSecureCoding.
- */
-static NSString *const kAuthorizationCodeKey = @"code";
-
-/*! @brief The key for the @c state property in the incoming parameters and for @c NSSecureCoding.
- */
-static NSString *const kStateKey = @"state";
-
-/*! @brief The key for the @c accessToken property in the incoming parameters and for
-        @c NSSecureCoding.
- */
-static NSString *const kAccessTokenKey = @"access_token";
-
-/*! @brief The key for the @c accessTokenExpirationDate property in the incoming parameters and for
-        @c NSSecureCoding.
- */
-static NSString *const kExpiresInKey = @"expires_in";
-
-/*! @brief The key for the @c tokenType property in the incoming parameters and for
-        @c NSSecureCoding.
- */
-static NSString *const kTokenTypeKey = @"token_type";
-
-/*! @brief The key for the @c idToken property in the incoming parameters and for @c NSSecureCoding.
- */
-static NSString *const kIDTokenKey = @"id_token";
-
-/*! @brief The key for the @c scope property in the incoming parameters and for @c NSSecureCoding.
- */
-static NSString *const kScopeKey = @"scope";
-
 /*! @brief Key used to encode the @c additionalParameters property for @c NSSecureCoding
  */
 static NSString *const kAdditionalParametersKey = @"additionalParameters";
@@ -74,40 +42,71 @@ static NSString *const kTokenExchangeRequestException =
 
 @implementation EkoOIDAuthorizationResponse
 
-/*! @brief Returns a mapping of incoming parameters to instance variables.
-    @return A mapping of incoming parameters to instance variables.
+/*! @brief The fields of @c EkoOIDAuthorizationResponse, as indexes into @c kFieldDescriptors.
+ */
+enum {
+  kStateField,
+  kAuthorizationCodeField,
+  kAccessTokenField,
+  kExpiresInField,
+  kTokenTypeField,
+  kIDTokenField,
+  kScopeField,
+};
+
+/*! @brief The incoming parameters mapped to instance variables, which are also the
+        @c NSSecureCoding keys of those variables.
+ */
+static const EkoOIDFieldDescriptor kFieldDescriptors[] = {
+  [kStateField] = { @"state", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kAuthorizationCodeField] = { @"code", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kAccessTokenField] = { @"access_token", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kExpiresInField] = { @"expires_in", EkoOIDFieldTypeDate, EkoOIDFieldConversionDateSinceNow },
+  [kTokenTypeField] = { @"token_type", EkoOIDFieldTypeString, EkoOIDFieldConversionNone, YES },
+  [kIDTokenField] = { @"id_token", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kScopeField] = { @"scope", EkoOIDFieldTypeString, EkoOIDFieldConversionNone, YES },
+};
+
+/*! @brief The perfect hash buckets of @c kFieldDescriptors.
+ */
+static const uint8_t kFieldBuckets[] = { 0, 0, 0, 7, 0, 6, 2, 5, 0, 4, 0, 0, 0, 3, 0, 1 };
+
+/*! @brief Returns the instance variable storage of @c field.
  */
-+ (NSDictionary<NSString *, EkoOIDFieldMapping *> *)fieldMap {
-  static NSMutableDictionary<NSString *, EkoOIDFieldMapping *> *fieldMap;
-  static dispatch_once_t onceToken;
-  dispatch_once(&onceToken, ^{
-    fieldMap = [NSMutableDictionary dictionary];
-    fieldMap[kStateKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_state" type:[NSString class]];
-    fieldMap[kAuthorizationCodeKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_authorizationCode" type:[NSString class]];
-    fieldMap[kAccessTokenKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_accessToken" type:[NSString class]];
-    fieldMap[kExpiresInKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_accessTokenExpirationDate"
-                                         type:[NSDate class]
-                                   conversion:^id _Nullable(NSObject *_Nullable value) {
-          if (![value isKindOfClass:[NSNumber class]]) {
-            return value;
-          }
-          NSNumber *valueAsNumber = (NSNumber *)value;
-          return [NSDate dateWithTimeIntervalSinceNow:[valueAsNumber longLongValue]];
-        }];
-    fieldMap[kTokenTypeKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_tokenType" type:[NSString class]];
-    fieldMap[kIDTokenKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_idToken" type:[NSString class]];
-    fieldMap[kScopeKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_scope" type:[NSString class]];
-  });
-  return fieldMap;
+static __strong id _Nullable *_Nonnull EkoOIDAuthorizationResponseFieldSlot(id instance,
+                                                                            NSUInteger field) {
+  EkoOIDAuthorizationResponse *response = instance;
+  switch (field) {
+    case kStateField:
+      return (__strong id *)&response->_state;
+    case kAuthorizationCodeField:
+      return (__strong id *)&response->_authorizationCode;
+    case kAccessTokenField:
+      return (__strong id *)&response->_accessToken;
+    case kExpiresInField:
+      return (__strong id *)&response->_accessTokenExpirationDate;
+    case kTokenTypeField:
+      return (__strong id *)&response->_tokenType;
+    case kIDTokenField:
+      return (__strong id *)&response->_idToken;
+    case kScopeField:
+      return (__strong id *)&response->_scope;
+  }
+  NSCAssert(NO, @"Unknown field %lu", (unsigned long)field);
+  return NULL;
 }
 
+/*! @brief Maps incoming parameters to instance variables.
+ */
+static const EkoOIDFieldTable kFieldTable = {
+  kFieldDescriptors,
+  sizeof(kFieldDescriptors) / sizeof(kFieldDescriptors[0]),
+  0x538453D7,
+  28,
+  kFieldBuckets,
+  EkoOIDAuthorizationResponseFieldSlot,
+};
+
 #pragma mark - Initializers
 
 - (instancetype)init
@@ -119,9 +118,9 @@ static NSString *const kTokenExchangeRequestException =
   if (self) {
     _request = [request copy];
     NSDictionary<NSString *, NSObject<NSCopying> *> *additionalParameters =
-        [EkoOIDFieldMapping remainingParametersWithMap:[[self class] fieldMap]
-                                         parameters:parameters
-                                           instance:self];
+        [EkoOIDFieldMapping remainingParametersWithTable:&kFieldTable
+                                              parameters:parameters
+                                                instance:self];
     _additionalParameters = additionalParameters;
   }
   return self;
@@ -148,7 +147,7 @@ static NSString *const kTokenExchangeRequestException =
       [aDecoder decodeObjectOfClass:[EkoOIDAuthorizationRequest class] forKey:kRequestKey];
   self = [self initWithRequest:request parameters:@{ }];
   if (self) {
-    [EkoOIDFieldMapping decodeWithCoder:aDecoder map:[[self class] fieldMap] instance:self];
+    [EkoOIDFieldMapping decodeWithCoder:aDecoder table:&kFieldTable instance:self];
     _additionalParameters = [aDecoder decodeObjectOfClasses:[EkoOIDFieldMapping JSONTypes]
                                                      forKey:kAdditionalParametersKey];
   }
@@ -157,7 +156,7 @@ static NSString *const kTokenExchangeRequestException =
 
 - (void)encodeWithCoder:(NSCoder *)aCoder {
   [aCoder encodeObject:_request forKey:kRequestKey];
-  [EkoOIDFieldMapping encodeWithCoder:aCoder map:[[self class] fieldMap] instance:self];
+  [EkoOIDFieldMapping encodeWithCoder:aCoder table:&kFieldTable instance:self];
   [aCoder encodeObject:_additionalParameters forKey:kAdditionalParametersKey];
 }
 
@@ -23,8 +23,11 @@
 @class EkoOIDAuthorizationResponse;
 @class EkoOIDEndSessionRequest;
 @class EkoOIDEndSessionResponse;
+@class EkoOIDIntrospectionRequest;
+@class EkoOIDIntrospectionResponse;
 @class EkoOIDRegistrationRequest;
 @class EkoOIDRegistrationResponse;
+@class EkoOIDRevocationRequest;
 @class EkoOIDServiceConfiguration;
 @class EkoOIDTokenRequest;
 @class EkoOIDTokenResponse;
@@ -69,6 +72,26 @@ typedef void (^EkoOIDTokenCallback)(EkoOIDTokenResponse *_Nullable tokenResponse
  */
 typedef NSDictionary<NSString *, NSString *> *_Nullable EkoOIDTokenEndpointParameters;
 
+/*! @brief Represents the type of block used as a callback for revoking a token.
+    @param error The error if an error occurred, or nil if the token was revoked or was already
+        invalid.
+ */
+typedef void (^EkoOIDRevocationCallback)(NSError *_Nullable error);
+
+/*! @brief Represents the type of block used as a callback for revoking a batch of tokens.
+    @param errors The errors of the requests which failed, keyed by the index of the request. Empty
+        if every token was revoked.
+ */
+typedef void (^EkoOIDBatchRevocationCallback)(NSDictionary<NSNumber *, NSError *> *errors);
+
+/*! @brief Represents the type of block used as a callback for introspecting a token.
+    @param introspectionResponse The introspection response, if available.
+    @param error The error if an error occurred.
+ */
+typedef void (^EkoOIDIntrospectionCallback)(
+    EkoOIDIntrospectionResponse *_Nullable introspectionResponse,
+    NSError *_Nullable error);
+
 /*! @brief Represents the type of block used as a callback for various methods of
         @c EkoOIDAuthorizationService.
     @param registrationResponse The registration response, if available.
@@ -158,6 +181,49 @@ typedef void (^EkoOIDRegistrationCompletion)(EkoOIDRegistrationResponse *_Nullab
     originalAuthorizationResponse:(EkoOIDAuthorizationResponse *_Nullable)authorizationResponse
                          callback:(EkoOIDTokenCallback)callback;
 
+/*! @brief Performs a token exchange request, sharing results between callers.
+    @param request The token exchange request.
+    @param callback The method called when the request has completed or failed.
+    @discussion Successful responses which say when the issued token expires are cached until
+        shortly before it does, keyed by the token endpoint, client, subject token, audience, scope
+        and other additional parameters of the request. Concurrent exchanges with the same key
+        share a single request.
+    @see https://tools.ietf.org/html/rfc8693
+ */
++ (void)performTokenExchangeRequest:(EkoOIDTokenRequest *)request
+                           callback:(EkoOIDTokenCallback)callback;
+
+/*! @brief Performs a token revocation request.
+    @param request The revocation request.
+    @param callback The method called on the main thread when the request has completed or failed.
+    @see https://tools.ietf.org/html/rfc7009
+ */
++ (void)performRevocationRequest:(EkoOIDRevocationRequest *)request
+                        callback:(EkoOIDRevocationCallback)callback;
+
+/*! @brief Performs a batch of token revocation requests, such as when signing out of every
+        account.
+    @param requests The revocation requests.
+    @param maxConcurrentRequests The number of requests which may be in flight at once.
+    @param callback The method called on the main thread when every request has completed or
+        failed.
+    @discussion Requests go through the shared @c EkoOIDURLSessionProvider session, which reuses
+        (and with HTTP/2, multiplexes) its connection to the revocation endpoint, so a batch costs
+        about one round trip per @c maxConcurrentRequests tokens rather than a connection per
+        token.
+ */
++ (void)performRevocationRequests:(NSArray<EkoOIDRevocationRequest *> *)requests
+            maxConcurrentRequests:(NSUInteger)maxConcurrentRequests
+                         callback:(EkoOIDBatchRevocationCallback)callback;
+
+/*! @brief Performs a token introspection request.
+    @param request The introspection request.
+    @param callback The method called on the main thread when the request has completed or failed.
+    @see https://tools.ietf.org/html/rfc7662
+ */
++ (void)performIntrospectionRequest:(EkoOIDIntrospectionRequest *)request
+                           callback:(EkoOIDIntrospectionCallback)callback;
+
 /*! @brief Performs a registration request.
     @param request The registration request.
     @param completion The method called when the request has completed or failed.
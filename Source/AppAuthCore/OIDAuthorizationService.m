@@ -27,8 +27,11 @@
 #import "OIDExternalUserAgent.h"
 #import "OIDExternalUserAgentSession.h"
 #import "OIDIDToken.h"
+#import "OIDIntrospectionRequest.h"
+#import "OIDIntrospectionResponse.h"
 #import "OIDRegistrationRequest.h"
 #import "OIDRegistrationResponse.h"
+#import "OIDRevocationRequest.h"
 #import "OIDServiceConfiguration.h"
 #import "OIDServiceDiscovery.h"
 #import "OIDTokenRequest.h"
@@ -46,8 +49,52 @@ static NSString *const kOpenIDConfigurationWellKnownPath = @".well-known/openid-
  */
 static int const kEkoOIDAuthorizationSessionIATMaxSkew = 600;
 
+/*! @brief Number of seconds before a cached token exchange result expires that it is no longer
+        used.
+ */
+static const NSTimeInterval kTokenExchangeExpiryTolerance = 60;
+
+/*! @brief The number of token exchange results kept by
+        @c EkoOIDAuthorizationService.performTokenExchangeRequest:callback:.
+ */
+static const NSUInteger kTokenExchangeCacheCountLimit = 128;
+
+/*! @brief The token exchange parameters a cached result is keyed by.
+    @see https://tools.ietf.org/html/rfc8693#section-2.1
+ */
+static NSString *const kSubjectTokenParameter = @"subject_token";
+static NSString *const kAudienceParameter = @"audience";
+
+/*! @brief The parameter which selects how the authorization server returns its response.
+    @see https://openid.net/specs/oauth-v2-multiple-response-types-1_0.html#ResponseModes
+ */
+static NSString *const kResponseModeParameter = @"response_mode";
+
+/*! @brief The response mode in which the response is returned in the fragment.
+ */
+static NSString *const kResponseModeFragment = @"fragment";
+
 NS_ASSUME_NONNULL_BEGIN
 
+/*! @brief Returns whether the response to @c request is returned in the fragment of the redirect
+        URI rather than in its query.
+    @discussion An explicit @c response_mode decides. Otherwise responses that include a token are
+        returned in the fragment, as that is the default response mode of those response types.
+ */
+static BOOL EkoOIDResponseIsInFragment(EkoOIDAuthorizationRequest *request) {
+  NSString *responseMode = request.additionalParameters[kResponseModeParameter];
+  if (responseMode) {
+    return [responseMode isEqualToString:kResponseModeFragment];
+  }
+  for (NSString *responseType in [request.responseType componentsSeparatedByString:@" "]) {
+    if ([responseType isEqualToString:EkoOIDResponseTypeToken] ||
+        [responseType isEqualToString:EkoOIDResponseTypeIDToken]) {
+      return YES;
+    }
+  }
+  return NO;
+}
+
 @interface EkoOIDAuthorizationSession : NSObject<EkoOIDExternalUserAgentSession>
 
 - (instancetype)init NS_UNAVAILABLE;
@@ -134,26 +181,29 @@ NS_ASSUME_NONNULL_BEGIN
                 format:@"%@", EkoOIDOAuthExceptionInvalidAuthorizationFlow, nil];
   }
 
-  EkoOIDURLQueryComponent *query = [[EkoOIDURLQueryComponent alloc] initWithURL:URL];
+  EkoOIDURLQueryComponent *query =
+      [[EkoOIDURLQueryComponent alloc] initWithRedirectURL:URL
+                                        responseInFragment:EkoOIDResponseIsInFragment(_request)];
+  NSDictionary<NSString *, NSObject<NSCopying> *> *parameters = query.dictionaryValue;
 
   NSError *error;
   EkoOIDAuthorizationResponse *response = nil;
 
   // checks for an OAuth error response as per RFC6749 Section 4.1.2.1
-  if (query.dictionaryValue[EkoOIDOAuthErrorFieldError]) {
+  if (parameters[EkoOIDOAuthErrorFieldError]) {
     error = [EkoOIDErrorUtilities OAuthErrorWithDomain:EkoOIDOAuthAuthorizationErrorDomain
-                                      OAuthResponse:query.dictionaryValue
+                                      OAuthResponse:parameters
                                     underlyingError:nil];
   }
 
   // no error, should be a valid OAuth 2.0 response
   if (!error) {
     response = [[EkoOIDAuthorizationResponse alloc] initWithRequest:_request
-                                                      parameters:query.dictionaryValue];
+                                                      parameters:parameters];
       
     // verifies that the state in the response matches the state in the request, or both are nil
     if (!EkoOIDIsEqualIncludingNil(_request.state, response.state)) {
-      NSMutableDictionary *userInfo = [query.dictionaryValue mutableCopy];
+      NSMutableDictionary *userInfo = [parameters mutableCopy];
       userInfo[NSLocalizedDescriptionKey] =
         [NSString stringWithFormat:@"State mismatch, expecting %@ but got %@ in authorization "
                                    "response %@",
@@ -268,13 +318,16 @@ NS_ASSUME_NONNULL_BEGIN
   NSError *error;
   EkoOIDEndSessionResponse *response = nil;
 
-  EkoOIDURLQueryComponent *query = [[EkoOIDURLQueryComponent alloc] initWithURL:URL];
+  // End-session responses are always returned in the query.
+  EkoOIDURLQueryComponent *query =
+      [[EkoOIDURLQueryComponent alloc] initWithRedirectURL:URL responseInFragment:NO];
+  NSDictionary<NSString *, NSObject<NSCopying> *> *parameters = query.dictionaryValue;
   response = [[EkoOIDEndSessionResponse alloc] initWithRequest:_request
-                                                 parameters:query.dictionaryValue];
+                                                 parameters:parameters];
   
   // verifies that the state in the response matches the state in the request, or both are nil
   if (!EkoOIDIsEqualIncludingNil(_request.state, response.state)) {
-    NSMutableDictionary *userInfo = [query.dictionaryValue mutableCopy];
+    NSMutableDictionary *userInfo = [parameters mutableCopy];
     userInfo[NSLocalizedDescriptionKey] =
     [NSString stringWithFormat:@"State mismatch, expecting %@ but got %@ in authorization "
      "response %@",
@@ -314,6 +367,70 @@ NS_ASSUME_NONNULL_BEGIN
 
 @end
 
+/*! @brief The key of a token exchange result: the token endpoint, client, scope and every
+        additional parameter of the request, including the subject token and audience.
+    @discussion Hashes the subject token, audience and scope, which are what usually differ between
+        exchanges.
+ */
+@interface EkoOIDTokenExchangeKey : NSObject <NSCopying>
+- (instancetype)initWithRequest:(EkoOIDTokenRequest *)request;
+@end
+@implementation EkoOIDTokenExchangeKey {
+  NSURL *_tokenEndpoint;
+  NSString *_clientID;
+  NSString *_scope;
+  NSDictionary<NSString *, NSString *> *_parameters;
+  NSUInteger _hash;
+}
+- (instancetype)initWithRequest:(EkoOIDTokenRequest *)request {
+  self = [super init];
+  if (self) {
+    _tokenEndpoint = request.configuration.tokenEndpoint;
+    _clientID = request.clientID;
+    _scope = request.scope;
+    _parameters = request.additionalParameters;
+    _hash = _parameters[kSubjectTokenParameter].hash * 31 + _parameters[kAudienceParameter].hash;
+    _hash = _hash * 31 + _scope.hash;
+  }
+  return self;
+}
+- (id)copyWithZone:(nullable NSZone *)zone {
+  return self;
+}
+- (NSUInteger)hash {
+  return _hash;
+}
+- (BOOL)isEqual:(id)object {
+  if (object == self) {
+    return YES;
+  }
+  if (![object isKindOfClass:[EkoOIDTokenExchangeKey class]]) {
+    return NO;
+  }
+  EkoOIDTokenExchangeKey *other = object;
+  return _hash == other->_hash
+      && EkoOIDIsEqualIncludingNil(_parameters, other->_parameters)
+      && EkoOIDIsEqualIncludingNil(_scope, other->_scope)
+      && EkoOIDIsEqualIncludingNil(_clientID, other->_clientID)
+      && EkoOIDIsEqualIncludingNil(_tokenEndpoint, other->_tokenEndpoint);
+}
+@end
+
+/*! @brief A batch of revocation requests in progress.
+    @discussion All properties are guarded by the batch.
+ */
+@interface EkoOIDRevocationBatch : NSObject
+@property(nonatomic, copy) NSArray<EkoOIDRevocationRequest *> *requests;
+@property(nonatomic) NSMutableDictionary<NSNumber *, NSError *> *errors;
+/*! @brief The index of the next request to start.
+ */
+@property(nonatomic) NSUInteger nextIndex;
+@property(nonatomic) NSUInteger completedCount;
+@property(nonatomic, copy) EkoOIDBatchRevocationCallback callback;
+@end
+@implementation EkoOIDRevocationBatch
+@end
+
 @implementation EkoOIDAuthorizationService
 
 + (void)discoverServiceConfigurationForIssuer:(NSURL *)issuerURL
@@ -665,6 +782,237 @@ NS_ASSUME_NONNULL_BEGIN
   }] resume];
 }
 
++ (void)performTokenExchangeRequest:(EkoOIDTokenRequest *)request
+                           callback:(EkoOIDTokenCallback)callback {
+  static NSCache<EkoOIDTokenExchangeKey *, EkoOIDTokenResponse *> *results;
+  static NSMutableDictionary<EkoOIDTokenExchangeKey *, NSMutableArray<EkoOIDTokenCallback> *>
+      *pendingCallbacks;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    results = [[NSCache alloc] init];
+    results.countLimit = kTokenExchangeCacheCountLimit;
+    pendingCallbacks = [NSMutableDictionary dictionary];
+  });
+
+  EkoOIDTokenExchangeKey *key = [[EkoOIDTokenExchangeKey alloc] initWithRequest:request];
+  EkoOIDTokenResponse *cachedResponse = [results objectForKey:key];
+  if ([cachedResponse.accessTokenExpirationDate timeIntervalSinceNow]
+      > kTokenExchangeExpiryTolerance) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+      callback(cachedResponse, nil);
+    });
+    return;
+  }
+
+  @synchronized(pendingCallbacks) {
+    // if the same exchange is already in progress, waits for its result
+    NSMutableArray<EkoOIDTokenCallback> *callbacks = pendingCallbacks[key];
+    if (callbacks) {
+      [callbacks addObject:[callback copy]];
+      return;
+    }
+    pendingCallbacks[key] = [NSMutableArray arrayWithObject:[callback copy]];
+  }
+
+  [self performTokenRequest:request
+                   callback:^(EkoOIDTokenResponse *_Nullable tokenResponse,
+                              NSError *_Nullable error) {
+    // only results which say when they expire are cached
+    if (tokenResponse.accessTokenExpirationDate) {
+      [results setObject:tokenResponse forKey:key];
+    } else {
+      [results removeObjectForKey:key];
+    }
+
+    NSArray<EkoOIDTokenCallback> *callbacks;
+    @synchronized(pendingCallbacks) {
+      callbacks = pendingCallbacks[key];
+      [pendingCallbacks removeObjectForKey:key];
+    }
+    for (EkoOIDTokenCallback pendingCallback in callbacks) {
+      pendingCallback(tokenResponse, error);
+    }
+  }];
+}
+
+#pragma mark - Revocation Endpoint
+
++ (void)performRevocationRequest:(EkoOIDRevocationRequest *)request
+                        callback:(EkoOIDRevocationCallback)callback {
+  [self performRevocationURLRequest:[request URLRequest] completion:^(NSError *_Nullable error) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+      callback(error);
+    });
+  }];
+}
+
++ (void)performRevocationRequests:(NSArray<EkoOIDRevocationRequest *> *)requests
+            maxConcurrentRequests:(NSUInteger)maxConcurrentRequests
+                         callback:(EkoOIDBatchRevocationCallback)callback {
+  EkoOIDRevocationBatch *batch = [[EkoOIDRevocationBatch alloc] init];
+  batch.requests = requests;
+  batch.errors = [NSMutableDictionary dictionary];
+  batch.callback = callback;
+  if (!batch.requests.count) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+      callback(@{ });
+    });
+    return;
+  }
+
+  // each completed request starts the next pending one, so no thread waits for a free slot
+  NSUInteger concurrentRequests = MIN(MAX(maxConcurrentRequests, 1u), batch.requests.count);
+  for (NSUInteger i = 0; i < concurrentRequests; i++) {
+    [self performNextRevocationRequestInBatch:batch];
+  }
+}
+
+/*! @brief Starts the next pending request of a batch, if any, and calls the batch's callback once
+        its last request has completed.
+    @param batch The batch of revocation requests.
+ */
++ (void)performNextRevocationRequestInBatch:(EkoOIDRevocationBatch *)batch {
+  NSUInteger index;
+  @synchronized(batch) {
+    if (batch.nextIndex == batch.requests.count) {
+      return;
+    }
+    index = batch.nextIndex++;
+  }
+  [self performRevocationURLRequest:[batch.requests[index] URLRequest]
+                         completion:^(NSError *_Nullable error) {
+    NSDictionary<NSNumber *, NSError *> *errors;
+    @synchronized(batch) {
+      if (error) {
+        batch.errors[@(index)] = error;
+      }
+      if (++batch.completedCount == batch.requests.count) {
+        errors = [batch.errors copy];
+      }
+    }
+    if (errors) {
+      dispatch_async(dispatch_get_main_queue(), ^{
+        batch.callback(errors);
+      });
+      return;
+    }
+    [self performNextRevocationRequestInBatch:batch];
+  }];
+}
+
+/*! @brief Sends a revocation request and interprets the response.
+    @param URLRequest The revocation request.
+    @param completion Called on the session's delegate queue with the error, or nil if the token
+        was revoked.
+    @see https://tools.ietf.org/html/rfc7009#section-2.2
+ */
++ (void)performRevocationURLRequest:(NSURLRequest *)URLRequest
+                         completion:(void (^)(NSError *_Nullable error))completion {
+  NSURLSession *session = [EkoOIDURLSessionProvider session];
+  [[session dataTaskWithRequest:URLRequest
+              completionHandler:^(NSData *_Nullable data,
+                                  NSURLResponse *_Nullable response,
+                                  NSError *_Nullable error) {
+    if (error) {
+      NSString *errorDescription =
+          [NSString stringWithFormat:@"Connection error making revocation request to '%@': %@.",
+                                     URLRequest.URL,
+                                     error.localizedDescription];
+      completion([EkoOIDErrorUtilities errorWithCode:EkoOIDErrorCodeNetworkError
+                                     underlyingError:error
+                                         description:errorDescription]);
+      return;
+    }
+
+    NSHTTPURLResponse *HTTPURLResponse = (NSHTTPURLResponse *)response;
+    if (HTTPURLResponse.statusCode == 200) {
+      // the server also responds 200 for tokens which were already invalid
+      completion(nil);
+      return;
+    }
+    completion([self errorWithHTTPResponse:HTTPURLResponse
+                                      data:data
+                               requestName:@"revocation"]);
+  }] resume];
+}
+
+/*! @brief Returns the error for a non-200 response from an endpoint which reports errors in the
+        token endpoint's format, such as the revocation and introspection endpoints.
+    @param HTTPURLResponse The response.
+    @param data The response body.
+    @param requestName The kind of request, for the error description.
+    @see https://tools.ietf.org/html/rfc6749#section-5.2
+ */
++ (NSError *)errorWithHTTPResponse:(NSHTTPURLResponse *)HTTPURLResponse
+                              data:(nullable NSData *)data
+                       requestName:(NSString *)requestName {
+  NSInteger statusCode = HTTPURLResponse.statusCode;
+  NSError *serverError =
+      [EkoOIDErrorUtilities HTTPErrorWithHTTPResponse:HTTPURLResponse data:data];
+  if (statusCode >= 400 && statusCode < 500 && data) {
+    NSDictionary<NSString *, NSObject<NSCopying> *> *json =
+        [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL];
+    if ([json isKindOfClass:[NSDictionary class]] && json[EkoOIDOAuthErrorFieldError]) {
+      return [EkoOIDErrorUtilities OAuthErrorWithDomain:EkoOIDOAuthTokenErrorDomain
+                                          OAuthResponse:json
+                                        underlyingError:serverError];
+    }
+  }
+
+  NSString *errorDescription =
+      [NSString stringWithFormat:@"Non-200 HTTP response (%d) making %@ request to '%@'.",
+                                 (int)statusCode,
+                                 requestName,
+                                 HTTPURLResponse.URL];
+  return [EkoOIDErrorUtilities errorWithCode:EkoOIDErrorCodeServerError
+                             underlyingError:serverError
+                                 description:errorDescription];
+}
+
+#pragma mark - Introspection Endpoint
+
++ (void)performIntrospectionRequest:(EkoOIDIntrospectionRequest *)request
+                           callback:(EkoOIDIntrospectionCallback)callback {
+  NSURLRequest *URLRequest = [request URLRequest];
+  NSURLSession *session = [EkoOIDURLSessionProvider session];
+  [[session dataTaskWithRequest:URLRequest
+              completionHandler:^(NSData *_Nullable data,
+                                  NSURLResponse *_Nullable response,
+                                  NSError *_Nullable error) {
+    EkoOIDIntrospectionResponse *introspectionResponse;
+    NSError *returnedError;
+    NSHTTPURLResponse *HTTPURLResponse = (NSHTTPURLResponse *)response;
+    if (error) {
+      NSString *errorDescription =
+          [NSString stringWithFormat:@"Connection error making introspection request to '%@': %@.",
+                                     URLRequest.URL,
+                                     error.localizedDescription];
+      returnedError = [EkoOIDErrorUtilities errorWithCode:EkoOIDErrorCodeNetworkError
+                                          underlyingError:error
+                                              description:errorDescription];
+    } else if (HTTPURLResponse.statusCode != 200) {
+      returnedError = [self errorWithHTTPResponse:HTTPURLResponse
+                                             data:data
+                                      requestName:@"introspection"];
+    } else {
+      NSError *jsonDeserializationError;
+      NSDictionary<NSString *, NSObject<NSCopying> *> *json =
+          [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonDeserializationError];
+      if ([json isKindOfClass:[NSDictionary class]]) {
+        introspectionResponse = [[EkoOIDIntrospectionResponse alloc] initWithRequest:request
+                                                                          parameters:json];
+      } else {
+        returnedError =
+            [EkoOIDErrorUtilities errorWithCode:EkoOIDErrorCodeJSONDeserializationError
+                                underlyingError:jsonDeserializationError
+                                    description:@"Introspection response isn't a JSON object."];
+      }
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+      callback(introspectionResponse, returnedError);
+    });
+  }] resume];
+}
 
 #pragma mark - Registration Endpoint
 
@@ -0,0 +1,110 @@
+/*! @file EkoOIDClientCredentialsTokenManager.h
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "OIDAuthState.h"
+
+@class EkoOIDScopeSet;
+@class EkoOIDServiceConfiguration;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! @brief Obtains and caches access tokens with the client credentials grant, for clients acting on
+        their own behalf rather than a user's.
+    @discussion Tokens are cached per scope set. A token which is close to expiring is still used,
+        but a new one is requested in the background so that callers don't wait for it, and
+        concurrent calls which need a new token share a single request.
+    @see https://tools.ietf.org/html/rfc6749#section-4.4
+ */
+@interface EkoOIDClientCredentialsTokenManager : NSObject
+
+/*! @brief The service's configuration.
+ */
+@property(nonatomic, readonly) EkoOIDServiceConfiguration *configuration;
+
+/*! @brief The client identifier.
+ */
+@property(nonatomic, readonly) NSString *clientID;
+
+/*! @brief The client secret.
+ */
+@property(nonatomic, readonly, nullable) NSString *clientSecret;
+
+/*! @brief The client's additional token request parameters.
+ */
+@property(nonatomic, readonly, nullable) NSDictionary<NSString *, NSString *> *additionalParameters;
+
+/*! @internal
+    @brief Unavailable. Please use
+        @c initWithConfiguration:clientID:clientSecret:additionalParameters: or
+        @c managerWithConfiguration:clientID:clientSecret:.
+ */
+- (instancetype)init NS_UNAVAILABLE;
+
+/*! @brief Returns the shared manager for a client, creating it if there is none.
+    @param configuration The service's configuration.
+    @param clientID The client identifier.
+    @param clientSecret The client secret.
+    @discussion Managers are shared by token endpoint and client identifier, so separate jobs
+        acting as the same client reuse each other's tokens. A manager is only shared while
+        something else holds it, so callers must keep the returned manager for as long as they use
+        it. A different client secret (e.g. after it was rotated) replaces the shared manager.
+ */
++ (instancetype)managerWithConfiguration:(EkoOIDServiceConfiguration *)configuration
+                                clientID:(NSString *)clientID
+                            clientSecret:(nullable NSString *)clientSecret;
+
+/*! @brief Designated initializer.
+    @param configuration The service's configuration.
+    @param clientID The client identifier.
+    @param clientSecret The client secret.
+    @param additionalParameters The client's additional token request parameters.
+ */
+- (instancetype)initWithConfiguration:(EkoOIDServiceConfiguration *)configuration
+                clientID:(NSString *)clientID
+            clientSecret:(nullable NSString *)clientSecret
+    additionalParameters:(nullable NSDictionary<NSString *, NSString *> *)additionalParameters
+    NS_DESIGNATED_INITIALIZER;
+
+/*! @brief Calls the block with a valid access token for the client's default scope (requesting it
+        first, if needed), or if a request was needed and failed, with the error that caused it to
+        fail.
+    @param action The block to execute with a fresh token. This block will be executed on the main
+        thread. Its ID token is always nil.
+ */
+- (void)performActionWithFreshTokens:(EkoOIDAuthStateAction)action;
+
+/*! @brief Calls the block with a valid access token for a scope set (requesting it first, if
+        needed), or if a request was needed and failed, with the error that caused it to fail.
+    @param action The block to execute with a fresh token. Its ID token is always nil.
+    @param scopeSet The scopes to request, or nil for the client's default scope.
+    @param dispatchQueue The dispatchQueue on which to dispatch the action block.
+ */
+- (void)performActionWithFreshTokens:(EkoOIDAuthStateAction)action
+                            scopeSet:(nullable EkoOIDScopeSet *)scopeSet
+                       dispatchQueue:(dispatch_queue_t)dispatchQueue;
+
+/*! @brief Forces new tokens to be requested the next time a fresh token is needed, even if the
+        cached tokens are considered valid.
+ */
+- (void)setNeedsTokenRefresh;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,225 @@
+/*! @file EkoOIDClientCredentialsTokenManager.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import "OIDClientCredentialsTokenManager.h"
+
+#import "OIDAuthorizationService.h"
+#import "OIDDefines.h"
+#import "OIDScopeSet.h"
+#import "OIDServiceConfiguration.h"
+#import "OIDTokenRequest.h"
+#import "OIDTokenResponse.h"
+
+/*! @brief Number of seconds before it expires that a token is no longer used.
+ */
+static const NSTimeInterval kExpiryTimeTolerance = 60;
+
+/*! @brief Number of seconds before it expires that a new token is requested in the background,
+        while the current one is still used.
+ */
+static const NSTimeInterval kRefreshAheadInterval = 300;
+
+/*! @brief The number of entries the shared managers can reach before their first purge.
+ */
+static const NSUInteger kManagersMinimumPurgeCount = 64;
+
+/*! @brief A cached client credentials token for a scope set, with the actions waiting for a new
+        one.
+    @discussion All properties are guarded by the manager.
+ */
+@interface EkoOIDClientCredentialsToken : NSObject
+@property(nonatomic, copy, nullable) NSString *accessToken;
+@property(nonatomic, nullable) NSDate *accessTokenExpirationDate;
+/*! @brief Non-nil while a new token is being requested.
+ */
+@property(nonatomic, nullable) NSMutableArray<EkoOIDAuthStateAction> *pendingActions;
+@end
+@implementation EkoOIDClientCredentialsToken
+@end
+
+@implementation EkoOIDClientCredentialsTokenManager {
+  /*! @brief The cached tokens, keyed by scope set, or @c NSNull for the default scope (use
+        @c self to synchronize access).
+   */
+  NSMutableDictionary<id, EkoOIDClientCredentialsToken *> *_tokens;
+}
+
+- (instancetype)init
+    EkoOID_UNAVAILABLE_USE_INITIALIZER(
+        @selector(initWithConfiguration:clientID:clientSecret:additionalParameters:)
+    )
+
++ (instancetype)managerWithConfiguration:(EkoOIDServiceConfiguration *)configuration
+                                clientID:(NSString *)clientID
+                            clientSecret:(nullable NSString *)clientSecret {
+  static NSMapTable<NSArray *, EkoOIDClientCredentialsTokenManager *> *managers;
+  static NSUInteger purgeCount;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    managers = [NSMapTable strongToWeakObjectsMapTable];
+    purgeCount = kManagersMinimumPurgeCount;
+  });
+
+  // the secret is compared rather than kept in the key, so it isn't retained once the manager
+  // holding it is deallocated
+  NSArray *key = @[ configuration.tokenEndpoint, clientID ];
+  @synchronized(managers) {
+    EkoOIDClientCredentialsTokenManager *manager = [managers objectForKey:key];
+    if (manager && EkoOIDIsEqualIncludingNil(manager.clientSecret, clientSecret)) {
+      return manager;
+    }
+    if (!manager && managers.count >= purgeCount) {
+      // entries keep their keys after their manager has been deallocated
+      NSMutableArray<NSArray *> *deallocatedKeys = [NSMutableArray array];
+      for (NSArray *managerKey in managers) {
+        if (![managers objectForKey:managerKey]) {
+          [deallocatedKeys addObject:managerKey];
+        }
+      }
+      for (NSArray *deallocatedKey in deallocatedKeys) {
+        [managers removeObjectForKey:deallocatedKey];
+      }
+      purgeCount = MAX(kManagersMinimumPurgeCount, managers.count * 2);
+    }
+    manager = [[self alloc] initWithConfiguration:configuration
+                                         clientID:clientID
+                                     clientSecret:clientSecret
+                             additionalParameters:nil];
+    [managers setObject:manager forKey:key];
+    return manager;
+  }
+}
+
+- (instancetype)initWithConfiguration:(EkoOIDServiceConfiguration *)configuration
+                clientID:(NSString *)clientID
+            clientSecret:(nullable NSString *)clientSecret
+    additionalParameters:(nullable NSDictionary<NSString *, NSString *> *)additionalParameters {
+  self = [super init];
+  if (self) {
+    _configuration = [configuration copy];
+    _clientID = [clientID copy];
+    _clientSecret = [clientSecret copy];
+    _additionalParameters =
+        [[NSDictionary alloc] initWithDictionary:additionalParameters copyItems:YES];
+    _tokens = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+#pragma mark -
+
+- (void)performActionWithFreshTokens:(EkoOIDAuthStateAction)action {
+  [self performActionWithFreshTokens:action
+                            scopeSet:nil
+                       dispatchQueue:dispatch_get_main_queue()];
+}
+
+- (void)performActionWithFreshTokens:(EkoOIDAuthStateAction)action
+                            scopeSet:(nullable EkoOIDScopeSet *)scopeSet
+                       dispatchQueue:(dispatch_queue_t)dispatchQueue {
+  EkoOIDAuthStateAction pendingAction =
+      ^(NSString *_Nullable accessToken, NSString *_Nullable idToken, NSError *_Nullable error) {
+    dispatch_async(dispatchQueue, ^{
+      action(accessToken, nil, error);
+    });
+  };
+
+  // scope sets are interned, so equal scope sets find the same token
+  id key = scopeSet ?: [NSNull null];
+  EkoOIDClientCredentialsToken *token;
+  NSString *accessToken;
+  BOOL requestsToken = NO;
+  @synchronized(self) {
+    token = _tokens[key];
+    if (!token) {
+      token = [[EkoOIDClientCredentialsToken alloc] init];
+      _tokens[key] = token;
+    }
+
+    // a token without an expiration time is assumed to never expire
+    NSTimeInterval lifetime = token.accessTokenExpirationDate
+        ? [token.accessTokenExpirationDate timeIntervalSinceNow]
+        : DBL_MAX;
+    if (token.accessToken && lifetime > kExpiryTimeTolerance) {
+      accessToken = token.accessToken;
+      if (lifetime <= kRefreshAheadInterval && !token.pendingActions) {
+        // requests the next token before this one expires, without waiting for it
+        token.pendingActions = [NSMutableArray array];
+        requestsToken = YES;
+      }
+    } else if (token.pendingActions) {
+      [token.pendingActions addObject:pendingAction];
+    } else {
+      token.pendingActions = [NSMutableArray arrayWithObject:pendingAction];
+      requestsToken = YES;
+    }
+  }
+
+  if (accessToken) {
+    pendingAction(accessToken, nil, nil);
+  }
+  if (requestsToken) {
+    [self requestToken:token scopeSet:scopeSet];
+  }
+}
+
+- (void)setNeedsTokenRefresh {
+  @synchronized(self) {
+    for (EkoOIDClientCredentialsToken *token in _tokens.allValues) {
+      token.accessToken = nil;
+      token.accessTokenExpirationDate = nil;
+    }
+  }
+}
+
+/*! @brief Requests a new token for a scope set and calls the actions waiting for it.
+    @param token The cached token to update.
+    @param scopeSet The scopes to request, or nil for the client's default scope.
+ */
+- (void)requestToken:(EkoOIDClientCredentialsToken *)token
+            scopeSet:(nullable EkoOIDScopeSet *)scopeSet {
+  EkoOIDTokenRequest *request =
+      [[EkoOIDTokenRequest alloc] initWithConfiguration:_configuration
+                                              grantType:EkoOIDGrantTypeClientCredentials
+                                      authorizationCode:nil
+                                            redirectURL:nil
+                                               clientID:_clientID
+                                           clientSecret:_clientSecret
+                                                  scope:scopeSet.scopeString
+                                           refreshToken:nil
+                                           codeVerifier:nil
+                                   additionalParameters:_additionalParameters];
+  [EkoOIDAuthorizationService performTokenRequest:request
+                                         callback:^(EkoOIDTokenResponse *_Nullable tokenResponse,
+                                                    NSError *_Nullable error) {
+    NSArray<EkoOIDAuthStateAction> *actionsToProcess;
+    @synchronized(self) {
+      actionsToProcess = token.pendingActions;
+      token.pendingActions = nil;
+      if (tokenResponse.accessToken) {
+        token.accessToken = tokenResponse.accessToken;
+        token.accessTokenExpirationDate = tokenResponse.accessTokenExpirationDate;
+      }
+    }
+    for (EkoOIDAuthStateAction actionToProcess in actionsToProcess) {
+      actionToProcess(tokenResponse.accessToken, nil, error);
+    }
+  }];
+}
+
+@end
@@ -22,10 +22,6 @@
 #import "OIDEndSessionRequest.h"
 #import "OIDFieldMapping.h"
 
-/*! @brief The key for the @c state property in the incoming parameters and for @c NSSecureCoding.
- */
-static NSString *const kStateKey = @"state";
-
 /*! @brief Key used to encode the @c request property for @c NSSecureCoding
  */
 static NSString *const kRequestKey = @"request";
@@ -37,6 +33,47 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
 
 @implementation EkoOIDEndSessionResponse
 
+/*! @brief The fields of @c EkoOIDEndSessionResponse, as indexes into @c kFieldDescriptors.
+ */
+enum {
+  kStateField,
+};
+
+/*! @brief The incoming parameters mapped to instance variables, which are also the
+        @c NSSecureCoding keys of those variables.
+ */
+static const EkoOIDFieldDescriptor kFieldDescriptors[] = {
+  [kStateField] = { @"state", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+};
+
+/*! @brief The perfect hash buckets of @c kFieldDescriptors.
+ */
+static const uint8_t kFieldBuckets[] = { 0, 0, 1, 0 };
+
+/*! @brief Returns the instance variable storage of @c field.
+ */
+static __strong id _Nullable *_Nonnull EkoOIDEndSessionResponseFieldSlot(id instance,
+                                                                         NSUInteger field) {
+  EkoOIDEndSessionResponse *response = instance;
+  switch (field) {
+    case kStateField:
+      return (__strong id *)&response->_state;
+  }
+  NSCAssert(NO, @"Unknown field %lu", (unsigned long)field);
+  return NULL;
+}
+
+/*! @brief Maps incoming parameters to instance variables.
+ */
+static const EkoOIDFieldTable kFieldTable = {
+  kFieldDescriptors,
+  sizeof(kFieldDescriptors) / sizeof(kFieldDescriptors[0]),
+  0x9E3779B1,
+  30,
+  kFieldBuckets,
+  EkoOIDEndSessionResponseFieldSlot,
+};
+
 #pragma mark - Initializers
 
 - (instancetype)init
@@ -48,28 +85,14 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
   if (self) {
     _request = [request copy];
     NSDictionary<NSString *, NSObject<NSCopying> *> *additionalParameters =
-    [EkoOIDFieldMapping remainingParametersWithMap:[[self class] fieldMap]
-                                     parameters:parameters
-                                       instance:self];
+    [EkoOIDFieldMapping remainingParametersWithTable:&kFieldTable
+                                          parameters:parameters
+                                            instance:self];
     _additionalParameters = additionalParameters;
   }
   return self;
 }
 
-/*! @brief Returns a mapping of incoming parameters to instance variables.
-    @return A mapping of incoming parameters to instance variables.
- */
-+ (NSDictionary<NSString *, EkoOIDFieldMapping *> *)fieldMap {
-  static NSMutableDictionary<NSString *, EkoOIDFieldMapping *> *fieldMap;
-  static dispatch_once_t onceToken;
-  dispatch_once(&onceToken, ^{
-    fieldMap = [NSMutableDictionary dictionary];
-    fieldMap[kStateKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_state" type:[NSString class]];
-  });
-  return fieldMap;
-}
-
 #pragma mark - NSCopying
 
 - (instancetype)copyWithZone:(nullable NSZone *)zone {
@@ -91,7 +114,7 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
       [aDecoder decodeObjectOfClass:[EkoOIDEndSessionRequest class] forKey:kRequestKey];
   self = [self initWithRequest:request parameters:@{ }];
   if (self) {
-    [EkoOIDFieldMapping decodeWithCoder:aDecoder map:[[self class] fieldMap] instance:self];
+    [EkoOIDFieldMapping decodeWithCoder:aDecoder table:&kFieldTable instance:self];
     _additionalParameters = [aDecoder decodeObjectOfClasses:[EkoOIDFieldMapping JSONTypes]
                                                      forKey:kAdditionalParametersKey];
   }
@@ -100,7 +123,7 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
 
 - (void)encodeWithCoder:(NSCoder *)aCoder {
   [aCoder encodeObject:_request forKey:kRequestKey];
-  [EkoOIDFieldMapping encodeWithCoder:aCoder map:[[self class] fieldMap] instance:self];
+  [EkoOIDFieldMapping encodeWithCoder:aCoder table:&kFieldTable instance:self];
   [aCoder encodeObject:_additionalParameters forKey:kAdditionalParametersKey];
 }
 
@@ -25,6 +25,96 @@ NS_ASSUME_NONNULL_BEGIN
  */
 typedef _Nullable id(^EkoOIDFieldMappingConversionFunction)(NSObject *_Nullable value);
 
+/*! @brief The types of instance variable a static field table can assign.
+ */
+typedef NS_ENUM(uint8_t, EkoOIDFieldType) {
+  EkoOIDFieldTypeString,
+  EkoOIDFieldTypeURL,
+  EkoOIDFieldTypeDate,
+  EkoOIDFieldTypeArray,
+};
+
+/*! @brief The conversions a static field table can apply to incoming values.
+ */
+typedef NS_ENUM(uint8_t, EkoOIDFieldConversion) {
+  /*! @brief The value is assigned as-is. */
+  EkoOIDFieldConversionNone,
+  /*! @brief An @c NSString is converted to an @c NSURL, as by @c EkoOIDFieldMapping.URLConversion.
+   */
+  EkoOIDFieldConversionURL,
+  /*! @brief An @c NSNumber of seconds from now is converted to an @c NSDate, as by
+          @c EkoOIDFieldMapping.dateSinceNowConversion.
+   */
+  EkoOIDFieldConversionDateSinceNow,
+  /*! @brief An @c NSNumber unix time stamp is converted to an @c NSDate, as by
+          @c EkoOIDFieldMapping.dateEpochConversion.
+   */
+  EkoOIDFieldConversionDateEpoch,
+  /*! @brief An @c NSString is wrapped in an @c NSArray, and anything other than a string or an array
+          is discarded.
+   */
+  EkoOIDFieldConversionArray,
+};
+
+/*! @brief Describes the mapping of a key to one field of a static field table.
+ */
+typedef struct {
+  /*! @brief The incoming parameter key, which is also the @c NSSecureCoding key.
+   */
+  __unsafe_unretained NSString *key;
+
+  /*! @brief The type of the instance variable.
+   */
+  EkoOIDFieldType type;
+
+  /*! @brief The conversion applied to incoming values before their type is checked.
+   */
+  EkoOIDFieldConversion conversion;
+
+  /*! @brief Whether string and URL values are shared between instances, for metadata which
+          repeats across many responses.
+      @see EkoOIDTokenUtilities.internedString:
+   */
+  BOOL interned;
+} EkoOIDFieldDescriptor;
+
+/*! @brief Returns the storage of the instance variable for field @c field of @c instance.
+ */
+typedef __strong id _Nullable *_Nonnull (*EkoOIDFieldSlotFunction)(id instance, NSUInteger field);
+
+/*! @brief A field mapping compiled into constant data, with a perfect hash of its keys.
+    @discussion A key is hashed by packing the low bytes of its length and of its first, middle
+        (at index length / 2) and last characters, most significant first, into 32 bits. Its bucket
+        is that value multiplied by @c hashMultiplier (modulo 2^32) and shifted right by
+        @c hashShift. @c hashMultiplier is chosen so that every key of the table has a distinct
+        bucket; lookups still compare the full key.
+ */
+typedef struct {
+  /*! @brief The fields of the table, indexed by the field numbers given to @c slot.
+   */
+  const EkoOIDFieldDescriptor *fields;
+
+  /*! @brief The number of fields.
+   */
+  NSUInteger count;
+
+  /*! @brief The multiplier of the perfect hash.
+   */
+  uint32_t hashMultiplier;
+
+  /*! @brief The shift of the perfect hash, which is 32 minus log2 of the number of buckets.
+   */
+  uint8_t hashShift;
+
+  /*! @brief For each bucket, one more than the index of the field it holds, or zero if empty.
+   */
+  const uint8_t *buckets;
+
+  /*! @brief Returns the instance variable storage of each field.
+   */
+  EkoOIDFieldSlotFunction slot;
+} EkoOIDFieldTable;
+
 /*! @brief Describes the mapping of a key/value pair to an iVar with an optional conversion
         function.
  */
@@ -102,6 +192,57 @@ typedef _Nullable id(^EkoOIDFieldMappingConversionFunction)(NSObject *_Nullable
                     map:(NSDictionary<NSString *, EkoOIDFieldMapping *> *)map
                instance:(id)instance;
 
+/*! @brief Maps incoming key/value pairs to the instance variables described by a static field table,
+        returning a dictionary of parameter key/values which didn't map to instance variables.
+    @param table A static table of incoming keys and the instance variables they map to.
+    @param parameters Incoming key value pairs to map to an instance's variables.
+    @param instance The instance whose variables should be set based on the table.
+    @return A dictionary of parameter key/values which didn't map to instance variables.
+ */
++ (NSDictionary<NSString *, NSObject<NSCopying> *> *)remainingParametersWithTable:
+    (const EkoOIDFieldTable *)table
+    parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters
+      instance:(id)instance;
+
+/*! @brief Returns the value of one field of a static field table in incoming key/value pairs,
+        converted and type checked as by @c remainingParametersWithTable:parameters:instance:.
+    @param field The index of the field in the table.
+    @param table A static table of incoming keys and the instance variables they map to.
+    @param parameters Incoming key value pairs.
+    @return The value of the field, or nil if it is missing or of the wrong type.
+ */
++ (nullable id)valueForField:(NSUInteger)field
+                       table:(const EkoOIDFieldTable *)table
+                  parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters;
+
+/*! @brief Returns the incoming key/value pairs which don't map to the instance variables described
+        by a static field table, without assigning any instance variable.
+    @param table A static table of incoming keys and the instance variables they map to.
+    @param parameters Incoming key value pairs.
+    @return The same dictionary as @c remainingParametersWithTable:parameters:instance:.
+ */
++ (NSDictionary<NSString *, NSObject<NSCopying> *> *)remainingParametersWithTable:
+    (const EkoOIDFieldTable *)table
+    parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters;
+
+/*! @brief Serializes the instance variables described by a static field table.
+    @param aCoder An @c NSCoder instance to serialize instance variable values to.
+    @param table A static table of keys and the instance variables they map to.
+    @param instance The instance whose variables should be serialized based on the table.
+ */
++ (void)encodeWithCoder:(NSCoder *)aCoder
+                  table:(const EkoOIDFieldTable *)table
+               instance:(id)instance;
+
+/*! @brief Deserializes the instance variables described by a static field table.
+    @param aCoder An @c NSCoder instance from which to deserialize instance variable values from.
+    @param table A static table of keys and the instance variables they map to.
+    @param instance The instance whose variables should be deserialized based on the table.
+ */
++ (void)decodeWithCoder:(NSCoder *)aCoder
+                  table:(const EkoOIDFieldTable *)table
+               instance:(id)instance;
+
 /*! @brief Returns an @c NSSet of classes suitable for deserializing JSON content in an
         @c NSSecureCoding context.
  */
@@ -18,7 +18,298 @@
 
 #import "OIDFieldMapping.h"
 
+#import <objc/runtime.h>
+
 #import "OIDDefines.h"
+#import "OIDTokenUtilities.h"
+
+/*! @brief Marks a compiled field which has no directly assignable strong object instance variable,
+        and so falls back to key-value coding.
+ */
+static const ptrdiff_t kNoIvarOffset = -1;
+
+/*! @brief A field mapping resolved against a specific class.
+ */
+@interface EkoOIDCompiledFieldMapping : NSObject {
+ @public
+  /*! @brief The field mapping this entry was compiled from.
+   */
+  EkoOIDFieldMapping *_mapping;
+
+  /*! @brief The expected type of the value, cached from @c _mapping.
+   */
+  Class _expectedType;
+
+  /*! @brief The conversion function, cached from @c _mapping.
+   */
+  EkoOIDFieldMappingConversionFunction _conversion;
+
+  /*! @brief The byte offset of the strong object instance variable, or @c kNoIvarOffset.
+   */
+  ptrdiff_t _ivarOffset;
+}
+@end
+@implementation EkoOIDCompiledFieldMapping
+@end
+
+/*! @brief Returns the storage of the object instance variable at @c offset in @c instance.
+ */
+static inline __strong id *EkoOIDIvarSlot(id instance, ptrdiff_t offset) {
+  return (__strong id *)(void *)((uint8_t *)(__bridge void *)instance + offset);
+}
+
+/*! @brief Returns whether the word at @c offset is one of those marked by an ivar layout.
+    @discussion A layout is a sequence of bytes, ending with zero, each of which skips the number
+        of words in its high nibble, then marks the number of words in its low nibble.
+ */
+static BOOL EkoOIDIvarLayoutContainsOffset(const uint8_t *layout, ptrdiff_t offset) {
+  if (!layout || offset < 0) {
+    return NO;
+  }
+  ptrdiff_t index = 0;
+  ptrdiff_t ivarIndex = offset / (ptrdiff_t)sizeof(void *);
+  for (uint8_t byte = *layout; byte; byte = *++layout) {
+    index += byte >> 4;
+    if (index > ivarIndex) {
+      return NO;
+    }
+    index += byte & 0x0F;
+    if (index > ivarIndex) {
+      return YES;
+    }
+  }
+  return NO;
+}
+
+/*! @brief Returns whether @c ivar, an object instance variable of @c cls, is strong.
+    @discussion Strong, weak and unretained object instance variables share the type encoding
+        @c _C_ID, and property attributes don't tell them apart either, as an implicitly strong
+        @c readonly property has no ownership attribute, just like an @c unsafe_unretained one.
+        Instead, the ownership is taken from the ivar layouts the compiler emits for the class
+        declaring @c ivar, as the runtime does: its strong layout marks its strong instance
+        variables, and its weak layout its weak ones. Classes compiled without ARC have no strong
+        layout, so their instance variables are never known to be strong.
+ */
+static BOOL EkoOIDIsStrongIvar(Class cls, Ivar ivar) {
+  for (Class currentClass = cls; currentClass; currentClass = class_getSuperclass(currentClass)) {
+    unsigned int count = 0;
+    Ivar *ivars = class_copyIvarList(currentClass, &count);
+    BOOL isDeclaringClass = NO;
+    ptrdiff_t instanceStart = PTRDIFF_MAX;
+    for (unsigned int i = 0; i < count; i++) {
+      isDeclaringClass = isDeclaringClass || ivars[i] == ivar;
+      instanceStart = MIN(instanceStart, ivar_getOffset(ivars[i]));
+    }
+    free(ivars);
+    if (!isDeclaringClass) {
+      continue;
+    }
+    // the layouts describe the class's own instance variables, from the first word boundary at or
+    // after the first of them
+    ptrdiff_t wordSize = (ptrdiff_t)sizeof(void *);
+    ptrdiff_t offset = ivar_getOffset(ivar) - (instanceStart + wordSize - 1) / wordSize * wordSize;
+    if (EkoOIDIvarLayoutContainsOffset(class_getWeakIvarLayout(currentClass), offset)) {
+      return NO;
+    }
+    return EkoOIDIvarLayoutContainsOffset(class_getIvarLayout(currentClass), offset);
+  }
+  return NO;
+}
+
+/*! @brief Returns @c map compiled against @c cls, compiling and caching it on first use.
+    @discussion Compiled maps are cached for as long as @c map is alive, so maps must not be
+        mutated after they have been used.
+ */
+static NSDictionary<NSString *, EkoOIDCompiledFieldMapping *> *EkoOIDCompiledFieldMap(
+    NSDictionary<NSString *, EkoOIDFieldMapping *> *map, Class cls) {
+  static NSMapTable<NSDictionary *, NSMapTable *> *compiledMaps;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    NSPointerFunctionsOptions mapKeyOptions =
+        NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality;
+    compiledMaps = [NSMapTable mapTableWithKeyOptions:mapKeyOptions
+                                         valueOptions:NSPointerFunctionsStrongMemory];
+  });
+
+  @synchronized(compiledMaps) {
+    NSMapTable *compiledMapsByClass = [compiledMaps objectForKey:map];
+    if (!compiledMapsByClass) {
+      NSPointerFunctionsOptions classKeyOptions =
+          NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality;
+      compiledMapsByClass = [NSMapTable mapTableWithKeyOptions:classKeyOptions
+                                                  valueOptions:NSPointerFunctionsStrongMemory];
+      [compiledMaps setObject:compiledMapsByClass forKey:map];
+    }
+    NSDictionary<NSString *, EkoOIDCompiledFieldMapping *> *compiledMap =
+        [compiledMapsByClass objectForKey:cls];
+    if (compiledMap) {
+      return compiledMap;
+    }
+
+    NSMutableDictionary<NSString *, EkoOIDCompiledFieldMapping *> *fields =
+        [NSMutableDictionary dictionaryWithCapacity:map.count];
+    for (NSString *key in map) {
+      EkoOIDFieldMapping *mapping = map[key];
+      EkoOIDCompiledFieldMapping *field = [[EkoOIDCompiledFieldMapping alloc] init];
+      field->_mapping = mapping;
+      field->_expectedType = mapping.expectedType;
+      field->_conversion = mapping.conversion;
+      field->_ivarOffset = kNoIvarOffset;
+      // Only strong object instance variables can be assigned directly; anything else (including
+      // weak or unretained ones, and names which only resolve through accessors) keeps using
+      // key-value coding, which honours their ownership.
+      Ivar ivar = class_getInstanceVariable(cls, mapping.name.UTF8String);
+      const char *ivarType = ivar ? ivar_getTypeEncoding(ivar) : NULL;
+      if (ivarType && ivarType[0] == _C_ID && EkoOIDIsStrongIvar(cls, ivar)) {
+        field->_ivarOffset = ivar_getOffset(ivar);
+      }
+      fields[key] = field;
+    }
+    compiledMap = [fields copy];
+    [compiledMapsByClass setObject:compiledMap forKey:cls];
+    return compiledMap;
+  }
+}
+
+/*! @brief Assigns @c value to the field of @c instance described by @c field.
+ */
+static inline void EkoOIDSetField(EkoOIDCompiledFieldMapping *field, id instance, id value) {
+  if (field->_ivarOffset != kNoIvarOffset) {
+    *EkoOIDIvarSlot(instance, field->_ivarOffset) = value;
+  } else {
+    [instance setValue:value forKey:field->_mapping.name];
+  }
+}
+
+/*! @brief Returns the value hashed for @c key by the perfect hash of @c EkoOIDFieldTable.
+ */
+static inline uint32_t EkoOIDFieldKeySignature(NSString *key) {
+  NSUInteger length = key.length;
+  if (!length) {
+    return 0;
+  }
+  return (uint32_t)(length & 0xFF) << 24
+      | (uint32_t)([key characterAtIndex:0] & 0xFF) << 16
+      | (uint32_t)([key characterAtIndex:length / 2] & 0xFF) << 8
+      | (uint32_t)([key characterAtIndex:length - 1] & 0xFF);
+}
+
+/*! @brief Returns the index of the field of @c table for @c key, or @c NSNotFound.
+ */
+static inline NSUInteger EkoOIDFieldTableIndex(const EkoOIDFieldTable *table, NSString *key) {
+  uint32_t bucket = (uint32_t)(EkoOIDFieldKeySignature(key) * table->hashMultiplier)
+      >> table->hashShift;
+  uint8_t entry = table->buckets[bucket];
+  if (!entry || ![table->fields[entry - 1].key isEqualToString:key]) {
+    return NSNotFound;
+  }
+  return entry - 1;
+}
+
+/*! @brief Returns the class of instance variables of type @c type.
+ */
+static Class EkoOIDFieldTypeClass(EkoOIDFieldType type) {
+  switch (type) {
+    case EkoOIDFieldTypeString:
+      return [NSString class];
+    case EkoOIDFieldTypeURL:
+      return [NSURL class];
+    case EkoOIDFieldTypeDate:
+      return [NSDate class];
+    case EkoOIDFieldTypeArray:
+      return [NSArray class];
+  }
+  return [NSObject class];
+}
+
+/*! @brief Applies @c conversion to an incoming value.
+ */
+static id _Nullable EkoOIDConvertFieldValue(EkoOIDFieldConversion conversion,
+                                            id _Nullable value) {
+  switch (conversion) {
+    case EkoOIDFieldConversionNone:
+      return value;
+    case EkoOIDFieldConversionURL:
+      return [value isKindOfClass:[NSString class]] ? [NSURL URLWithString:value] : value;
+    case EkoOIDFieldConversionDateSinceNow:
+      return [value isKindOfClass:[NSNumber class]]
+          ? [NSDate dateWithTimeIntervalSinceNow:[value longLongValue]]
+          : value;
+    case EkoOIDFieldConversionDateEpoch:
+      return [value isKindOfClass:[NSNumber class]]
+          ? [NSDate dateWithTimeIntervalSince1970:[value longLongValue]]
+          : value;
+    case EkoOIDFieldConversionArray:
+      if ([value isKindOfClass:[NSArray class]]) {
+        return value;
+      }
+      return [value isKindOfClass:[NSString class]] ? @[ value ] : nil;
+  }
+  return value;
+}
+
+/*! @brief Returns the shared instance of @c value if @c field is interned.
+ */
+static id _Nullable EkoOIDInternFieldValue(const EkoOIDFieldDescriptor *field, id _Nullable value) {
+  if (!field->interned) {
+    return value;
+  }
+  switch (field->type) {
+    case EkoOIDFieldTypeString:
+      return [EkoOIDTokenUtilities internedString:value];
+    case EkoOIDFieldTypeURL:
+      return [EkoOIDTokenUtilities internedURL:value];
+    case EkoOIDFieldTypeDate:
+    case EkoOIDFieldTypeArray:
+      return value;
+  }
+  return value;
+}
+
+/*! @brief Returns @c value converted for @c field, or nil if the converted value is of the wrong
+        type. The converted value is returned in @c convertedValue either way.
+ */
+static id _Nullable EkoOIDTableFieldValue(const EkoOIDFieldDescriptor *field,
+                                          id _Nullable value,
+                                          id _Nullable *_Nonnull convertedValue) {
+  *convertedValue = EkoOIDConvertFieldValue(field->conversion, value);
+  if (![*convertedValue isKindOfClass:EkoOIDFieldTypeClass(field->type)]) {
+    return nil;
+  }
+  return EkoOIDInternFieldValue(field, *convertedValue);
+}
+
+/*! @brief Returns the parameters which don't map to a field of @c table, assigning the fields of
+        @c instance from the others unless @c instance is nil.
+ */
+static NSDictionary<NSString *, NSObject<NSCopying> *> *EkoOIDRemainingTableParameters(
+    const EkoOIDFieldTable *table,
+    NSDictionary<NSString *, NSObject<NSCopying> *> *parameters,
+    id _Nullable instance) {
+  NSMutableDictionary *additionalParameters = [NSMutableDictionary dictionary];
+  [parameters enumerateKeysAndObjectsUsingBlock:^(NSString *key,
+                                                  NSObject<NSCopying> *parameter,
+                                                  BOOL *stop) {
+    NSObject<NSCopying> *value = [parameter copy];
+    NSUInteger index = EkoOIDFieldTableIndex(table, key);
+    // If the field doesn't appear in the table, we add it to the additional parameters dictionary.
+    if (index == NSNotFound) {
+      additionalParameters[key] = value;
+      return;
+    }
+    id convertedValue;
+    id fieldValue = EkoOIDTableFieldValue(&table->fields[index], value, &convertedValue);
+    // Values of the wrong type are added to the additional parameters dictionary instead.
+    if (!fieldValue) {
+      additionalParameters[key] = convertedValue;
+      return;
+    }
+    if (instance) {
+      *table->slot(instance, index) = fieldValue;
+    }
+  }];
+  return additionalParameters;
+}
 
 @implementation EkoOIDFieldMapping
 
@@ -46,49 +337,107 @@
     (NSDictionary<NSString *, EkoOIDFieldMapping *> *)map
     parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters
       instance:(id)instance {
+  NSDictionary<NSString *, EkoOIDCompiledFieldMapping *> *fields =
+      EkoOIDCompiledFieldMap(map, [instance class]);
   NSMutableDictionary *additionalParameters = [NSMutableDictionary dictionary];
-  for (NSString *key in parameters) {
-    NSObject<NSCopying> *value = [parameters[key] copy];
-    EkoOIDFieldMapping *mapping = map[key];
+  [parameters enumerateKeysAndObjectsUsingBlock:^(NSString *key,
+                                                  NSObject<NSCopying> *parameter,
+                                                  BOOL *stop) {
+    // Copying is free for the immutable values produced by JSON and URL parsing, and protects
+    // against callers which pass mutable values.
+    NSObject<NSCopying> *value = [parameter copy];
+    EkoOIDCompiledFieldMapping *field = fields[key];
     // If the field doesn't appear in the mapping, we add it to the additional parameters
     // dictionary.
-    if (!mapping) {
+    if (!field) {
       additionalParameters[key] = value;
-      continue;
+      return;
     }
     // If the field mapping specifies a conversion function, apply the conversion to the value.
-    if (mapping.conversion) {
-      value = mapping.conversion(value);
+    if (field->_conversion) {
+      value = field->_conversion(value);
     }
     // Check the type of the value and make sure it matches the type we expected. If it doesn't we
     // add the value to the additional parameters dictionary but don't assign the instance variable.
-    if (![value isKindOfClass:mapping.expectedType]) {
+    if (![value isKindOfClass:field->_expectedType]) {
       additionalParameters[key] = value;
-      continue;
+      return;
     }
     // Assign the instance variable.
-    [instance setValue:value forKey:mapping.name];
-  }
+    EkoOIDSetField(field, instance, value);
+  }];
   return additionalParameters;
 }
 
++ (NSDictionary<NSString *, NSObject<NSCopying> *> *)remainingParametersWithTable:
+    (const EkoOIDFieldTable *)table
+    parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters
+      instance:(id)instance {
+  return EkoOIDRemainingTableParameters(table, parameters, instance);
+}
+
++ (NSDictionary<NSString *, NSObject<NSCopying> *> *)remainingParametersWithTable:
+    (const EkoOIDFieldTable *)table
+    parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters {
+  return EkoOIDRemainingTableParameters(table, parameters, nil);
+}
+
++ (nullable id)valueForField:(NSUInteger)field
+                       table:(const EkoOIDFieldTable *)table
+                  parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters {
+  const EkoOIDFieldDescriptor *descriptor = &table->fields[field];
+  NSObject<NSCopying> *value = parameters[descriptor->key];
+  if (!value) {
+    return nil;
+  }
+  id convertedValue;
+  return EkoOIDTableFieldValue(descriptor, [value copy], &convertedValue);
+}
+
++ (void)encodeWithCoder:(NSCoder *)aCoder
+                  table:(const EkoOIDFieldTable *)table
+               instance:(id)instance {
+  for (NSUInteger i = 0; i < table->count; i++) {
+    [aCoder encodeObject:*table->slot(instance, i) forKey:table->fields[i].key];
+  }
+}
+
++ (void)decodeWithCoder:(NSCoder *)aCoder
+                  table:(const EkoOIDFieldTable *)table
+               instance:(id)instance {
+  for (NSUInteger i = 0; i < table->count; i++) {
+    const EkoOIDFieldDescriptor *field = &table->fields[i];
+    id value = [aCoder decodeObjectOfClass:EkoOIDFieldTypeClass(field->type) forKey:field->key];
+    *table->slot(instance, i) = EkoOIDInternFieldValue(field, value);
+  }
+}
+
 + (void)encodeWithCoder:(NSCoder *)aCoder
                     map:(NSDictionary<NSString *, EkoOIDFieldMapping *> *)map
                instance:(id)instance {
-  for (NSString *key in map) {
-    id value = [instance valueForKey:map[key].name];
+  NSDictionary<NSString *, EkoOIDCompiledFieldMapping *> *fields =
+      EkoOIDCompiledFieldMap(map, [instance class]);
+  [fields enumerateKeysAndObjectsUsingBlock:^(NSString *key,
+                                              EkoOIDCompiledFieldMapping *field,
+                                              BOOL *stop) {
+    id value = field->_ivarOffset != kNoIvarOffset
+        ? *EkoOIDIvarSlot(instance, field->_ivarOffset)
+        : [instance valueForKey:field->_mapping.name];
     [aCoder encodeObject:value forKey:key];
-  }
+  }];
 }
 
 + (void)decodeWithCoder:(NSCoder *)aCoder
                     map:(NSDictionary<NSString *, EkoOIDFieldMapping *> *)map
                instance:(id)instance {
-  for (NSString *key in map) {
-    EkoOIDFieldMapping *mapping = map[key];
-    id value = [aCoder decodeObjectOfClass:mapping.expectedType forKey:key];
-    [instance setValue:value forKey:mapping.name];
-  }
+  NSDictionary<NSString *, EkoOIDCompiledFieldMapping *> *fields =
+      EkoOIDCompiledFieldMap(map, [instance class]);
+  [fields enumerateKeysAndObjectsUsingBlock:^(NSString *key,
+                                              EkoOIDCompiledFieldMapping *field,
+                                              BOOL *stop) {
+    id value = [aCoder decodeObjectOfClass:field->_expectedType forKey:key];
+    EkoOIDSetField(field, instance, value);
+  }];
 }
 
 + (NSSet *)JSONTypes {
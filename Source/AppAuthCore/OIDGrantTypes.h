@@ -38,3 +38,29 @@ extern NSString *const EkoOIDGrantTypePassword;
     @see https://tools.ietf.org/html/rfc6749#section-4.4.2
  */
 extern NSString *const EkoOIDGrantTypeClientCredentials;
+
+/*! @brief For exchanging a security token for another, such as a downscoped access token.
+    @see https://tools.ietf.org/html/rfc8693#section-2.1
+ */
+extern NSString *const EkoOIDGrantTypeTokenExchange;
+
+/*! @brief Token type identifier for an OAuth 2.0 access token, for the token types of a token
+        exchange.
+    @see https://tools.ietf.org/html/rfc8693#section-3
+ */
+extern NSString *const EkoOIDTokenTypeAccessToken;
+
+/*! @brief Token type identifier for an OAuth 2.0 refresh token.
+    @see https://tools.ietf.org/html/rfc8693#section-3
+ */
+extern NSString *const EkoOIDTokenTypeRefreshToken;
+
+/*! @brief Token type identifier for an OpenID Connect ID Token.
+    @see https://tools.ietf.org/html/rfc8693#section-3
+ */
+extern NSString *const EkoOIDTokenTypeIDToken;
+
+/*! @brief Token type identifier for a JWT.
+    @see https://tools.ietf.org/html/rfc8693#section-3
+ */
+extern NSString *const EkoOIDTokenTypeJWT;
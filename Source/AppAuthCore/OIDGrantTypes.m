@@ -25,3 +25,13 @@ NSString *const EkoOIDGrantTypeRefreshToken = @"refresh_token";
 NSString *const EkoOIDGrantTypePassword = @"password";
 
 NSString *const EkoOIDGrantTypeClientCredentials = @"client_credentials";
+
+NSString *const EkoOIDGrantTypeTokenExchange = @"urn:ietf:params:oauth:grant-type:token-exchange";
+
+NSString *const EkoOIDTokenTypeAccessToken = @"urn:ietf:params:oauth:token-type:access_token";
+
+NSString *const EkoOIDTokenTypeRefreshToken = @"urn:ietf:params:oauth:token-type:refresh_token";
+
+NSString *const EkoOIDTokenTypeIDToken = @"urn:ietf:params:oauth:token-type:id_token";
+
+NSString *const EkoOIDTokenTypeJWT = @"urn:ietf:params:oauth:token-type:jwt";
@@ -18,18 +18,70 @@
 
 #import "OIDIDToken.h"
 
-/*! Field keys associated with an ID Token. */
-static NSString *const kIssKey = @"iss";
-static NSString *const kSubKey = @"sub";
-static NSString *const kAudKey = @"aud";
-static NSString *const kExpKey = @"exp";
-static NSString *const kIatKey = @"iat";
-static NSString *const kNonceKey = @"nonce";
-
 #import "OIDFieldMapping.h"
 
 @implementation EkoOIDIDToken
 
+/*! @brief The fields of @c EkoOIDIDToken, as indexes into @c kFieldDescriptors.
+ */
+enum {
+  kIssuerField,
+  kSubjectField,
+  kAudienceField,
+  kExpiresAtField,
+  kIssuedAtField,
+  kNonceField,
+};
+
+/*! @brief The incoming parameters mapped to instance variables, which are also the
+        @c NSSecureCoding keys of those variables.
+ */
+static const EkoOIDFieldDescriptor kFieldDescriptors[] = {
+  [kIssuerField] = { @"iss", EkoOIDFieldTypeURL, EkoOIDFieldConversionURL, YES },
+  [kSubjectField] = { @"sub", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kAudienceField] = { @"aud", EkoOIDFieldTypeArray, EkoOIDFieldConversionArray },
+  [kExpiresAtField] = { @"exp", EkoOIDFieldTypeDate, EkoOIDFieldConversionDateEpoch },
+  [kIssuedAtField] = { @"iat", EkoOIDFieldTypeDate, EkoOIDFieldConversionDateEpoch },
+  [kNonceField] = { @"nonce", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+};
+
+/*! @brief The perfect hash buckets of @c kFieldDescriptors.
+ */
+static const uint8_t kFieldBuckets[] = { 6, 0, 0, 0, 4, 3, 0, 0, 0, 0, 2, 5, 0, 0, 0, 1 };
+
+/*! @brief Returns the instance variable storage of @c field.
+ */
+static __strong id _Nullable *_Nonnull EkoOIDIDTokenFieldSlot(id instance, NSUInteger field) {
+  EkoOIDIDToken *IDToken = instance;
+  switch (field) {
+    case kIssuerField:
+      return (__strong id *)&IDToken->_issuer;
+    case kSubjectField:
+      return (__strong id *)&IDToken->_subject;
+    case kAudienceField:
+      return (__strong id *)&IDToken->_audience;
+    case kExpiresAtField:
+      return (__strong id *)&IDToken->_expiresAt;
+    case kIssuedAtField:
+      return (__strong id *)&IDToken->_issuedAt;
+    case kNonceField:
+      return (__strong id *)&IDToken->_nonce;
+  }
+  NSCAssert(NO, @"Unknown field %lu", (unsigned long)field);
+  return NULL;
+}
+
+/*! @brief Maps incoming parameters to instance variables.
+ */
+static const EkoOIDFieldTable kFieldTable = {
+  kFieldDescriptors,
+  sizeof(kFieldDescriptors) / sizeof(kFieldDescriptors[0]),
+  0x9E3779B1,
+  28,
+  kFieldBuckets,
+  EkoOIDIDTokenFieldSlot,
+};
+
 - (instancetype)initWithIDTokenString:(NSString *)idToken {
   self = [super init];
   NSArray *sections = [idToken componentsSeparatedByString:@"."];
@@ -45,9 +97,9 @@ static NSString *const kNonceKey = @"nonce";
     return nil;
   }
 
-  [EkoOIDFieldMapping remainingParametersWithMap:[[self class] fieldMap]
-                                   parameters:_claims
-                                     instance:self];
+  [EkoOIDFieldMapping remainingParametersWithTable:&kFieldTable
+                                        parameters:_claims
+                                          instance:self];
 
   // Required fields.
   if (!_issuer || !_audience || !_subject || !_expiresAt || !_issuedAt) {
@@ -57,59 +109,6 @@ static NSString *const kNonceKey = @"nonce";
   return self;
 }
 
-/*! @brief Returns a mapping of incoming parameters to instance variables.
-    @return A mapping of incoming parameters to instance variables.
- */
-+ (NSDictionary<NSString *, EkoOIDFieldMapping *> *)fieldMap {
-  static NSMutableDictionary<NSString *, EkoOIDFieldMapping *> *fieldMap;
-  static dispatch_once_t onceToken;
-  dispatch_once(&onceToken, ^{
-    fieldMap = [NSMutableDictionary dictionary];
-
-    fieldMap[kIssKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_issuer"
-                                         type:[NSURL class]
-                                   conversion:[EkoOIDFieldMapping URLConversion]];
-    fieldMap[kSubKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_subject" type:[NSString class]];
-    fieldMap[kAudKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_audience"
-                                         type:[NSArray class]
-                                   conversion:^id _Nullable(NSObject *_Nullable value) {
-          if ([value isKindOfClass:[NSArray class]]) {
-            return value;
-          }
-          if ([value isKindOfClass:[NSString class]]) {
-            return @[value];
-          }
-          return nil;
-        }];
-    fieldMap[kExpKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_expiresAt"
-                                         type:[NSDate class]
-                                   conversion:^id _Nullable(NSObject *_Nullable value) {
-          if (![value isKindOfClass:[NSNumber class]]) {
-            return value;
-          }
-          NSNumber *valueAsNumber = (NSNumber *)value;
-          return [NSDate dateWithTimeIntervalSince1970:valueAsNumber.longLongValue];
-        }];
-    fieldMap[kIatKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_issuedAt"
-                                         type:[NSDate class]
-                                   conversion:^id _Nullable(NSObject *_Nullable value) {
-          if (![value isKindOfClass:[NSNumber class]]) {
-            return value;
-          }
-          NSNumber *valueAsNumber = (NSNumber *)value;
-          return [NSDate dateWithTimeIntervalSince1970:valueAsNumber.longLongValue];
-        }];
-    fieldMap[kNonceKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_nonce" type:[NSString class]];
-  });
-  return fieldMap;
-}
-
 + (NSDictionary *)parseJWTSection:(NSString *)sectionString {
   NSData *decodedData = [[self class] base64urlNoPaddingDecode:sectionString];
 
@@ -0,0 +1,115 @@
+/*! @file EkoOIDIntrospectionRequest.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import "OIDIntrospectionRequest.h"
+
+#import "OIDDefines.h"
+#import "OIDTokenUtilities.h"
+#import "OIDURLQueryComponent.h"
+
+/*! @brief Introspection request parameter names.
+    @see https://tools.ietf.org/html/rfc7662#section-2.1
+ */
+static NSString *const kTokenKey = @"token";
+static NSString *const kTokenTypeHintKey = @"token_type_hint";
+static NSString *const kClientIDKey = @"client_id";
+
+@implementation EkoOIDIntrospectionRequest
+
+- (instancetype)init
+    EkoOID_UNAVAILABLE_USE_INITIALIZER(
+        @selector(initWithIntrospectionEndpoint:
+                                          token:
+                                  tokenTypeHint:
+                                       clientID:
+                                   clientSecret:
+                           additionalParameters:)
+    )
+
+- (instancetype)initWithIntrospectionEndpoint:(NSURL *)introspectionEndpoint
+                        token:(NSString *)token
+                tokenTypeHint:(nullable NSString *)tokenTypeHint
+                     clientID:(NSString *)clientID
+                 clientSecret:(nullable NSString *)clientSecret
+    additionalParameters:(nullable NSDictionary<NSString *, NSString *> *)additionalParameters {
+  self = [super init];
+  if (self) {
+    _introspectionEndpoint = [EkoOIDTokenUtilities internedURL:introspectionEndpoint];
+    _token = [token copy];
+    _tokenTypeHint = [tokenTypeHint copy];
+    _clientID = [EkoOIDTokenUtilities internedString:clientID];
+    _clientSecret = [clientSecret copy];
+    _additionalParameters =
+        [[NSDictionary alloc] initWithDictionary:additionalParameters copyItems:YES];
+  }
+  return self;
+}
+
+#pragma mark - NSCopying
+
+- (instancetype)copyWithZone:(nullable NSZone *)zone {
+  // The request is immutable.
+  return self;
+}
+
+#pragma mark - NSObject overrides
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"<%@: %p, introspectionEndpoint: %@, tokenTypeHint: %@>",
+                                    NSStringFromClass([self class]),
+                                    (void *)self,
+                                    _introspectionEndpoint,
+                                    _tokenTypeHint];
+}
+
+#pragma mark -
+
+- (NSURLRequest *)URLRequest {
+  static NSString *const kHTTPPost = @"POST";
+  static NSString *const kHTTPContentTypeHeaderKey = @"Content-Type";
+  static NSString *const kHTTPContentTypeHeaderValue =
+      @"application/x-www-form-urlencoded; charset=UTF-8";
+  static NSString *const kHTTPAuthorizationHeaderKey = @"Authorization";
+
+  NSMutableURLRequest *URLRequest = [NSMutableURLRequest requestWithURL:_introspectionEndpoint];
+  URLRequest.HTTPMethod = kHTTPPost;
+  [URLRequest setValue:kHTTPContentTypeHeaderValue forHTTPHeaderField:kHTTPContentTypeHeaderKey];
+
+  NSMutableData *body = [NSMutableData dataWithCapacity:_token.length * 3 + 64];
+  [EkoOIDURLQueryComponent appendURLEncodedParameter:kTokenKey value:_token toData:body];
+  if (_tokenTypeHint) {
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kTokenTypeHintKey
+                                                 value:_tokenTypeHint
+                                                toData:body];
+  }
+  [EkoOIDURLQueryComponent appendURLEncodedParameters:_additionalParameters toData:body];
+
+  if (_clientSecret) {
+    NSString *authValue =
+        [EkoOIDTokenUtilities basicAuthorizationHeaderValueWithClientID:_clientID
+                                                           clientSecret:_clientSecret];
+    [URLRequest setValue:authValue forHTTPHeaderField:kHTTPAuthorizationHeaderKey];
+  } else {
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kClientIDKey value:_clientID toData:body];
+  }
+
+  URLRequest.HTTPBody = body;
+  return URLRequest;
+}
+
+@end
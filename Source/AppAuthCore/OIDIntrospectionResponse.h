@@ -0,0 +1,100 @@
+/*! @file EkoOIDIntrospectionResponse.h
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class EkoOIDIntrospectionRequest;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! @brief Represents the response to a token introspection request.
+    @see https://tools.ietf.org/html/rfc7662#section-2.2
+ */
+@interface EkoOIDIntrospectionResponse : NSObject <NSCopying>
+
+/*! @brief The request which was serviced.
+ */
+@property(nonatomic, readonly) EkoOIDIntrospectionRequest *request;
+
+/*! @brief The decoded introspection response as a dictionary, including any extension members.
+ */
+@property(nonatomic, readonly) NSDictionary<NSString *, NSObject<NSCopying> *> *parameters;
+
+/*! @brief REQUIRED. Whether the token is currently active. Every other member is only present for
+        active tokens.
+    @remarks active
+ */
+@property(nonatomic, readonly, getter=isActive) BOOL active;
+
+/*! @brief OPTIONAL. The space-delimited scopes associated with the token.
+    @remarks scope
+ */
+@property(nonatomic, readonly, nullable) NSString *scope;
+
+/*! @brief OPTIONAL. The client identifier of the client which requested the token.
+    @remarks client_id
+ */
+@property(nonatomic, readonly, nullable) NSString *clientID;
+
+/*! @brief OPTIONAL. A human-readable identifier of the resource owner who authorized the token.
+    @remarks username
+ */
+@property(nonatomic, readonly, nullable) NSString *username;
+
+/*! @brief OPTIONAL. The type of the token.
+    @remarks token_type
+ */
+@property(nonatomic, readonly, nullable) NSString *tokenType;
+
+/*! @brief OPTIONAL. When the token expires.
+    @remarks exp
+ */
+@property(nonatomic, readonly, nullable) NSDate *expiresAt;
+
+/*! @brief OPTIONAL. When the token was issued.
+    @remarks iat
+ */
+@property(nonatomic, readonly, nullable) NSDate *issuedAt;
+
+/*! @brief OPTIONAL. The subject of the token, usually a machine-readable identifier of the resource
+        owner.
+    @remarks sub
+ */
+@property(nonatomic, readonly, nullable) NSString *subject;
+
+/*! @brief OPTIONAL. The issuer of the token.
+    @remarks iss
+ */
+@property(nonatomic, readonly, nullable) NSString *issuer;
+
+/*! @internal
+    @brief Unavailable. Please use @c initWithRequest:parameters:.
+ */
+- (instancetype)init NS_UNAVAILABLE;
+
+/*! @brief Designated initializer.
+    @param request The serviced request.
+    @param parameters The decoded parameters returned from the introspection endpoint.
+ */
+- (instancetype)initWithRequest:(EkoOIDIntrospectionRequest *)request
+                     parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters
+    NS_DESIGNATED_INITIALIZER;
+
+@end
+
+NS_ASSUME_NONNULL_END
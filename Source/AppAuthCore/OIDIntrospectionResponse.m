@@ -0,0 +1,121 @@
+/*! @file EkoOIDIntrospectionResponse.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import "OIDIntrospectionResponse.h"
+
+#import "OIDDefines.h"
+#import "OIDIntrospectionRequest.h"
+
+/*! Field keys associated with an introspection response. */
+static NSString *const kActiveKey = @"active";
+static NSString *const kScopeKey = @"scope";
+static NSString *const kClientIDKey = @"client_id";
+static NSString *const kUsernameKey = @"username";
+static NSString *const kTokenTypeKey = @"token_type";
+static NSString *const kExpiresAtKey = @"exp";
+static NSString *const kIssuedAtKey = @"iat";
+static NSString *const kSubjectKey = @"sub";
+static NSString *const kIssuerKey = @"iss";
+
+/*! @brief Returns @c value if it is a string, or nil.
+ */
+static NSString *_Nullable EkoOIDStringValue(id _Nullable value) {
+  return [value isKindOfClass:[NSString class]] ? value : nil;
+}
+
+/*! @brief Returns the date @c value seconds after the epoch if it is a number, or nil.
+ */
+static NSDate *_Nullable EkoOIDEpochDateValue(id _Nullable value) {
+  if (![value isKindOfClass:[NSNumber class]]) {
+    return nil;
+  }
+  return [NSDate dateWithTimeIntervalSince1970:[value doubleValue]];
+}
+
+@implementation EkoOIDIntrospectionResponse
+
+- (instancetype)init
+    EkoOID_UNAVAILABLE_USE_INITIALIZER(@selector(initWithRequest:parameters:))
+
+- (instancetype)initWithRequest:(EkoOIDIntrospectionRequest *)request
+                     parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters {
+  self = [super init];
+  if (self) {
+    _request = [request copy];
+    _parameters = [parameters copy];
+    // the member must be the JSON boolean true; anything else means the token is inactive
+    id active = _parameters[kActiveKey];
+    _active = [active isKindOfClass:[NSNumber class]] && [active boolValue];
+  }
+  return self;
+}
+
+- (nullable NSString *)scope {
+  return EkoOIDStringValue(_parameters[kScopeKey]);
+}
+
+- (nullable NSString *)clientID {
+  return EkoOIDStringValue(_parameters[kClientIDKey]);
+}
+
+- (nullable NSString *)username {
+  return EkoOIDStringValue(_parameters[kUsernameKey]);
+}
+
+- (nullable NSString *)tokenType {
+  return EkoOIDStringValue(_parameters[kTokenTypeKey]);
+}
+
+- (nullable NSDate *)expiresAt {
+  return EkoOIDEpochDateValue(_parameters[kExpiresAtKey]);
+}
+
+- (nullable NSDate *)issuedAt {
+  return EkoOIDEpochDateValue(_parameters[kIssuedAtKey]);
+}
+
+- (nullable NSString *)subject {
+  return EkoOIDStringValue(_parameters[kSubjectKey]);
+}
+
+- (nullable NSString *)issuer {
+  return EkoOIDStringValue(_parameters[kIssuerKey]);
+}
+
+#pragma mark - NSCopying
+
+- (instancetype)copyWithZone:(nullable NSZone *)zone {
+  // The response is immutable.
+  return self;
+}
+
+#pragma mark - NSObject overrides
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"<%@: %p, active: %@, scope: \"%@\", clientID: %@, "
+                                     "expiresAt: %@, request: %@>",
+                                    NSStringFromClass([self class]),
+                                    (void *)self,
+                                    _active ? @"YES" : @"NO",
+                                    self.scope,
+                                    self.clientID,
+                                    self.expiresAt,
+                                    _request];
+}
+
+@end
@@ -41,41 +41,76 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
 
 @implementation EkoOIDRegistrationResponse
 
-/*! @brief Returns a mapping of incoming parameters to instance variables.
-    @return A mapping of incoming parameters to instance variables.
+/*! @brief The fields of @c EkoOIDRegistrationResponse, as indexes into @c kFieldDescriptors.
  */
-+ (NSDictionary<NSString *, EkoOIDFieldMapping *> *)fieldMap {
-  static NSMutableDictionary<NSString *, EkoOIDFieldMapping *> *fieldMap;
-  static dispatch_once_t onceToken;
-  dispatch_once(&onceToken, ^{
-    fieldMap = [NSMutableDictionary dictionary];
-    fieldMap[EkoOIDClientIDParam] = [[EkoOIDFieldMapping alloc] initWithName:@"_clientID"
-                                                                  type:[NSString class]];
-    fieldMap[EkoOIDClientIDIssuedAtParam] =
-    [[EkoOIDFieldMapping alloc] initWithName:@"_clientIDIssuedAt"
-                                     type:[NSDate class]
-                               conversion:[EkoOIDFieldMapping dateEpochConversion]];
-    fieldMap[EkoOIDClientSecretParam] =
-    [[EkoOIDFieldMapping alloc] initWithName:@"_clientSecret"
-                                     type:[NSString class]];
-    fieldMap[EkoOIDClientSecretExpirestAtParam] =
-    [[EkoOIDFieldMapping alloc] initWithName:@"_clientSecretExpiresAt"
-                                     type:[NSDate class]
-                               conversion:[EkoOIDFieldMapping dateEpochConversion]];
-    fieldMap[EkoOIDRegistrationAccessTokenParam] =
-    [[EkoOIDFieldMapping alloc] initWithName:@"_registrationAccessToken"
-                                     type:[NSString class]];
-    fieldMap[EkoOIDRegistrationClientURIParam] =
-    [[EkoOIDFieldMapping alloc] initWithName:@"_registrationClientURI"
-                                     type:[NSURL class]
-                               conversion:[EkoOIDFieldMapping URLConversion]];
-    fieldMap[EkoOIDTokenEndpointAuthenticationMethodParam] =
-    [[EkoOIDFieldMapping alloc] initWithName:@"_tokenEndpointAuthenticationMethod"
-                                     type:[NSString class]];
-  });
-  return fieldMap;
+enum {
+  kClientIDField,
+  kClientIDIssuedAtField,
+  kClientSecretField,
+  kClientSecretExpiresAtField,
+  kRegistrationAccessTokenField,
+  kRegistrationClientURIField,
+  kTokenEndpointAuthenticationMethodField,
+};
+
+/*! @brief The incoming parameters mapped to instance variables, which are also the
+        @c NSSecureCoding keys of those variables.
+ */
+static const EkoOIDFieldDescriptor kFieldDescriptors[] = {
+  [kClientIDField] = { @"client_id", EkoOIDFieldTypeString, EkoOIDFieldConversionNone, YES },
+  [kClientIDIssuedAtField] =
+      { @"client_id_issued_at", EkoOIDFieldTypeDate, EkoOIDFieldConversionDateEpoch },
+  [kClientSecretField] = { @"client_secret", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kClientSecretExpiresAtField] =
+      { @"client_secret_expires_at", EkoOIDFieldTypeDate, EkoOIDFieldConversionDateEpoch },
+  [kRegistrationAccessTokenField] =
+      { @"registration_access_token", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kRegistrationClientURIField] =
+      { @"registration_client_uri", EkoOIDFieldTypeURL, EkoOIDFieldConversionURL },
+  [kTokenEndpointAuthenticationMethodField] =
+      { @"token_endpoint_auth_method", EkoOIDFieldTypeString, EkoOIDFieldConversionNone, YES },
+};
+
+/*! @brief The perfect hash buckets of @c kFieldDescriptors.
+ */
+static const uint8_t kFieldBuckets[] = { 6, 0, 1, 2, 0, 4, 0, 0, 5, 3, 7, 0, 0, 0, 0, 0 };
+
+/*! @brief Returns the instance variable storage of @c field.
+ */
+static __strong id _Nullable *_Nonnull EkoOIDRegistrationResponseFieldSlot(id instance,
+                                                                           NSUInteger field) {
+  EkoOIDRegistrationResponse *response = instance;
+  switch (field) {
+    case kClientIDField:
+      return (__strong id *)&response->_clientID;
+    case kClientIDIssuedAtField:
+      return (__strong id *)&response->_clientIDIssuedAt;
+    case kClientSecretField:
+      return (__strong id *)&response->_clientSecret;
+    case kClientSecretExpiresAtField:
+      return (__strong id *)&response->_clientSecretExpiresAt;
+    case kRegistrationAccessTokenField:
+      return (__strong id *)&response->_registrationAccessToken;
+    case kRegistrationClientURIField:
+      return (__strong id *)&response->_registrationClientURI;
+    case kTokenEndpointAuthenticationMethodField:
+      return (__strong id *)&response->_tokenEndpointAuthenticationMethod;
+  }
+  NSCAssert(NO, @"Unknown field %lu", (unsigned long)field);
+  return NULL;
 }
 
+/*! @brief Maps incoming parameters to instance variables.
+ */
+static const EkoOIDFieldTable kFieldTable = {
+  kFieldDescriptors,
+  sizeof(kFieldDescriptors) / sizeof(kFieldDescriptors[0]),
+  0xCC623A9B,
+  28,
+  kFieldBuckets,
+  EkoOIDRegistrationResponseFieldSlot,
+};
+
 
 #pragma mark - Initializers
 
@@ -88,9 +123,9 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
   if (self) {
     _request = [request copy];
     NSDictionary<NSString *, NSObject <NSCopying> *> *additionalParameters =
-    [EkoOIDFieldMapping remainingParametersWithMap:[[self class] fieldMap]
-                                     parameters:parameters
-                                       instance:self];
+    [EkoOIDFieldMapping remainingParametersWithTable:&kFieldTable
+                                          parameters:parameters
+                                            instance:self];
     _additionalParameters = additionalParameters;
 
     if ((_clientSecret && !_clientSecretExpiresAt)
@@ -127,7 +162,7 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
                     parameters:@{}];
   if (self) {
     [EkoOIDFieldMapping decodeWithCoder:aDecoder
-                                 map:[[self class] fieldMap]
+                                 table:&kFieldTable
                             instance:self];
     _additionalParameters = [aDecoder decodeObjectOfClasses:[EkoOIDFieldMapping JSONTypes]
                                                      forKey:kAdditionalParametersKey];
@@ -136,7 +171,7 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
 }
 
 - (void)encodeWithCoder:(NSCoder *)aCoder {
-  [EkoOIDFieldMapping encodeWithCoder:aCoder map:[[self class] fieldMap] instance:self];
+  [EkoOIDFieldMapping encodeWithCoder:aCoder table:&kFieldTable instance:self];
   [aCoder encodeObject:_request forKey:kRequestKey];
   [aCoder encodeObject:_additionalParameters forKey:kAdditionalParametersKey];
 }
@@ -0,0 +1,100 @@
+/*! @file EkoOIDRevocationRequest.h
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! @brief Token type hint for revoking an access token.
+    @see https://tools.ietf.org/html/rfc7009#section-2.1
+ */
+extern NSString *const EkoOIDTokenTypeHintAccessToken;
+
+/*! @brief Token type hint for revoking a refresh token.
+    @see https://tools.ietf.org/html/rfc7009#section-2.1
+ */
+extern NSString *const EkoOIDTokenTypeHintRefreshToken;
+
+/*! @brief Represents a token revocation request.
+    @see https://tools.ietf.org/html/rfc7009#section-2.1
+ */
+@interface EkoOIDRevocationRequest : NSObject <NSCopying>
+
+/*! @brief The authorization server's revocation endpoint.
+    @remarks When the configuration came from discovery, this is usually
+        @c EkoOIDServiceDiscovery.revocationEndpoint.
+ */
+@property(nonatomic, readonly) NSURL *revocationEndpoint;
+
+/*! @brief The token to revoke.
+    @remarks token
+ */
+@property(nonatomic, readonly) NSString *token;
+
+/*! @brief A hint about the type of @c token, such as @c ::EkoOIDTokenTypeHintRefreshToken.
+    @remarks token_type_hint
+ */
+@property(nonatomic, readonly, nullable) NSString *tokenTypeHint;
+
+/*! @brief The client identifier.
+    @remarks client_id
+ */
+@property(nonatomic, readonly) NSString *clientID;
+
+/*! @brief The client secret.
+    @remarks client_secret
+ */
+@property(nonatomic, readonly, nullable) NSString *clientSecret;
+
+/*! @brief The client's additional revocation request parameters.
+ */
+@property(nonatomic, readonly, nullable) NSDictionary<NSString *, NSString *> *additionalParameters;
+
+/*! @internal
+    @brief Unavailable. Please use the designated initializer,
+        @c initWithRevocationEndpoint:token:tokenTypeHint:clientID:clientSecret:
+        additionalParameters:.
+ */
+- (instancetype)init NS_UNAVAILABLE;
+
+/*! @brief Designated initializer.
+    @param revocationEndpoint The authorization server's revocation endpoint.
+    @param token The token to revoke.
+    @param tokenTypeHint A hint about the type of @c token, or nil.
+    @param clientID The client identifier.
+    @param clientSecret The client secret, or nil for public clients.
+    @param additionalParameters The client's additional revocation request parameters.
+ */
+- (instancetype)initWithRevocationEndpoint:(NSURL *)revocationEndpoint
+                     token:(NSString *)token
+             tokenTypeHint:(nullable NSString *)tokenTypeHint
+                  clientID:(NSString *)clientID
+              clientSecret:(nullable NSString *)clientSecret
+      additionalParameters:(nullable NSDictionary<NSString *, NSString *> *)additionalParameters
+    NS_DESIGNATED_INITIALIZER;
+
+/*! @brief Constructs an @c NSURLRequest representing the revocation request.
+    @discussion Clients with a secret authenticate with HTTP Basic authentication, as for token
+        requests; public clients send their identifier in the body.
+    @return An @c NSURLRequest representing the revocation request.
+ */
+- (NSURLRequest *)URLRequest;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,89 @@
+/*! @file EkoOIDScopeSet.h
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! @brief An immutable, interned set of OAuth 2 scopes.
+    @discussion Every scope name is registered once per process and given a bit index, and each
+        set is stored as a bitset over those indexes. Equal sets are the same instance, so
+        equality and hashing are pointer comparisons, and subset checks and unions are word-wise
+        bit operations which don't touch the scope strings.
+
+        Registered scope names are kept for the lifetime of the process, so the registry is
+        capped at 1024 names. Scopes first seen after it is full, such as ones a server makes up,
+        are never registered: the sets containing them keep them as strings, and compare them as
+        strings, for as long as the sets are alive. Sets are interned only while they are in use.
+    @see https://tools.ietf.org/html/rfc6749#section-3.3
+ */
+@interface EkoOIDScopeSet : NSObject <NSCopying>
+
+/*! @brief The scopes of the set, in the order they were first registered in the process, followed
+        by any scopes which aren't registered, in lexical order.
+ */
+@property(nonatomic, readonly) NSArray<NSString *> *scopes;
+
+/*! @brief The scopes of the set as a space-delimited scope string, in the order of
+        @c EkoOIDScopeSet.scopes.
+ */
+@property(nonatomic, readonly) NSString *scopeString;
+
+/*! @brief The number of scopes in the set.
+ */
+@property(nonatomic, readonly) NSUInteger count;
+
+/*! @internal
+    @brief Unavailable. Please use @c scopeSetWithString: or @c scopeSetWithArray:.
+ */
+- (instancetype)init NS_UNAVAILABLE;
+
+/*! @brief Returns the set with no scopes.
+ */
++ (instancetype)emptyScopeSet;
+
+/*! @brief Returns the set of scopes in an OAuth 2 spec-compliant scope string.
+    @param scopes A space-delimited scope string, or nil for the empty set.
+    @discussion Recently used scope strings are cached, so repeated calls with the same string
+        don't split it again.
+ */
++ (instancetype)scopeSetWithString:(nullable NSString *)scopes;
+
+/*! @brief Returns the set of scopes in an array of scope strings.
+    @param scopes An array of scope strings.
+ */
++ (instancetype)scopeSetWithArray:(NSArray<NSString *> *)scopes;
+
+/*! @brief Returns whether the set contains a scope.
+    @param scope The scope.
+ */
+- (BOOL)containsScope:(NSString *)scope;
+
+/*! @brief Returns whether every scope of the receiver is also in @c scopeSet.
+    @param scopeSet The set to compare with.
+ */
+- (BOOL)isSubsetOfScopeSet:(EkoOIDScopeSet *)scopeSet;
+
+/*! @brief Returns the set of scopes in either the receiver or @c scopeSet.
+    @param scopeSet The set to add.
+ */
+- (EkoOIDScopeSet *)scopeSetByAddingScopeSet:(EkoOIDScopeSet *)scopeSet;
+
+@end
+
+NS_ASSUME_NONNULL_END
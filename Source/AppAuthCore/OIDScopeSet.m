@@ -0,0 +1,361 @@
+/*! @file EkoOIDScopeSet.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import "OIDScopeSet.h"
+
+#import "OIDDefines.h"
+
+/*! @brief The number of scopes tracked by each word of a scope set's bitset.
+ */
+static const NSUInteger kBitsPerWord = 64;
+
+/*! @brief The number of scope strings whose parsed sets are kept by
+        @c EkoOIDScopeSet.scopeSetWithString:.
+ */
+static const NSUInteger kScopeStringCacheCountLimit = 256;
+
+/*! @brief The number of scope names the registry gives bit indexes to. Registered names are never
+        released, so scopes first seen once it is full, such as ones made up by a server, are kept
+        as strings by the sets which contain them instead.
+ */
+static const NSUInteger kScopeRegistryCapacity = 1024;
+
+/*! @brief The names of all scopes registered in the process, indexed by their bit index.
+    @discussion Guarded by @c EkoOIDScopeIndexes.
+ */
+static NSMutableArray<NSString *> *EkoOIDScopeNames(void) {
+  static NSMutableArray<NSString *> *names;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    names = [NSMutableArray array];
+  });
+  return names;
+}
+
+/*! @brief The bit indexes of all scopes registered in the process, keyed by scope name.
+    @discussion Also used as the lock for the scope registry.
+ */
+static NSMutableDictionary<NSString *, NSNumber *> *EkoOIDScopeIndexes(void) {
+  static NSMutableDictionary<NSString *, NSNumber *> *indexes;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    indexes = [NSMutableDictionary dictionary];
+  });
+  return indexes;
+}
+
+/*! @brief Returns the bit index of @c scope, registering the scope if it is new, or @c NSNotFound
+        if it is new and the registry is full.
+    @discussion The registry only grows, so a scope which isn't registered when the registry is
+        full never will be.
+    @remarks Must be called with the scope registry locked.
+ */
+static NSUInteger EkoOIDRegisteredScopeIndex(NSString *scope) {
+  NSMutableDictionary<NSString *, NSNumber *> *indexes = EkoOIDScopeIndexes();
+  NSNumber *index = indexes[scope];
+  if (index) {
+    return index.unsignedIntegerValue;
+  }
+  NSMutableArray<NSString *> *names = EkoOIDScopeNames();
+  if (names.count >= kScopeRegistryCapacity) {
+    return NSNotFound;
+  }
+  NSUInteger newIndex = names.count;
+  NSString *name = [scope copy];
+  [names addObject:name];
+  indexes[name] = @(newIndex);
+  return newIndex;
+}
+
+@interface EkoOIDScopeSet ()
+
+/*! @brief Creates a set from its bitset and the scopes it contains.
+    @param bits The bitset, without trailing zero words.
+    @param unregisteredScopes The scopes which have no bit index, or nil if there are none.
+    @param scopes The scopes whose bits are set, in bit index order, followed by the unregistered
+        scopes in lexical order.
+ */
+- (instancetype)initWithBits:(NSData *)bits
+          unregisteredScopes:(nullable NSSet<NSString *> *)unregisteredScopes
+                      scopes:(NSArray<NSString *> *)scopes NS_DESIGNATED_INITIALIZER;
+
+@end
+
+/*! @brief Returns the key which identifies a set with scopes beyond the registry's capacity
+        among the interned sets.
+    @param bits The bitset of the set, without trailing zero words.
+    @param unregisteredScopes The scopes of the set which have no bit index, in lexical order.
+    @discussion Each scope is encoded with its length, and the scopes end with a length no scope
+        has, so that no two sets share a key. The scopes come ahead of the bitset as they tell such
+        sets apart more often, and @c NSData only hashes the first bytes.
+ */
+static NSData *EkoOIDUnregisteredScopeSetKey(NSData *bits,
+                                             NSArray<NSString *> *unregisteredScopes) {
+  NSMutableData *key = [NSMutableData data];
+  for (NSString *scope in unregisteredScopes) {
+    NSData *scopeBytes = [scope dataUsingEncoding:NSUTF8StringEncoding];
+    uint64_t length = scopeBytes.length;
+    [key appendBytes:&length length:sizeof(length)];
+    [key appendData:scopeBytes];
+  }
+  uint64_t terminator = UINT64_MAX;
+  [key appendBytes:&terminator length:sizeof(terminator)];
+  [key appendData:bits];
+  return key;
+}
+
+/*! @brief Returns the interned set with the given scopes, creating it if there is none.
+    @param words The words of the bitset of the registered scopes. Trailing zero words are ignored.
+    @param wordCount The number of words in @c words.
+    @param unregisteredScopes The scopes which have no bit index, or nil if there are none.
+    @discussion Sets are held weakly, so a set is only shared while it is still in use. Sets with
+        unregistered scopes are interned separately, by @c EkoOIDUnregisteredScopeSetKey.
+ */
+static EkoOIDScopeSet *EkoOIDInternedScopeSet(const uint64_t *words,
+                                              NSUInteger wordCount,
+                                              NSSet<NSString *> *_Nullable unregisteredScopes) {
+  static NSMapTable<NSData *, EkoOIDScopeSet *> *scopeSets;
+  static NSMapTable<NSData *, EkoOIDScopeSet *> *unregisteredScopeSets;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    scopeSets = [NSMapTable strongToWeakObjectsMapTable];
+    unregisteredScopeSets = [NSMapTable strongToWeakObjectsMapTable];
+  });
+
+  while (wordCount > 0 && words[wordCount - 1] == 0) {
+    wordCount--;
+  }
+  NSData *bits = [NSData dataWithBytes:words length:wordCount * sizeof(uint64_t)];
+  if (!unregisteredScopes.count) {
+    unregisteredScopes = nil;
+  }
+  NSArray<NSString *> *sortedUnregisteredScopes =
+      [unregisteredScopes.allObjects sortedArrayUsingSelector:@selector(compare:)];
+  NSMapTable<NSData *, EkoOIDScopeSet *> *internedSets =
+      unregisteredScopes ? unregisteredScopeSets : scopeSets;
+  NSData *key =
+      unregisteredScopes ? EkoOIDUnregisteredScopeSetKey(bits, sortedUnregisteredScopes) : bits;
+
+  @synchronized(scopeSets) {
+    EkoOIDScopeSet *scopeSet = [internedSets objectForKey:key];
+    if (scopeSet) {
+      return scopeSet;
+    }
+
+    NSMutableArray<NSString *> *scopes = [NSMutableArray array];
+    @synchronized(EkoOIDScopeIndexes()) {
+      NSArray<NSString *> *names = EkoOIDScopeNames();
+      for (NSUInteger wordIndex = 0; wordIndex < wordCount; wordIndex++) {
+        uint64_t word = words[wordIndex];
+        while (word) {
+          NSUInteger bit = (NSUInteger)__builtin_ctzll(word);
+          [scopes addObject:names[wordIndex * kBitsPerWord + bit]];
+          word &= word - 1;
+        }
+      }
+    }
+    if (sortedUnregisteredScopes) {
+      [scopes addObjectsFromArray:sortedUnregisteredScopes];
+    }
+
+    scopeSet = [[EkoOIDScopeSet alloc] initWithBits:bits
+                                 unregisteredScopes:unregisteredScopes
+                                             scopes:scopes];
+    [internedSets setObject:scopeSet forKey:key];
+    return scopeSet;
+  }
+}
+
+@implementation EkoOIDScopeSet {
+  /*! @brief The bitset, without trailing zero words. Owns the memory of @c _words.
+   */
+  NSData *_bits;
+
+  /*! @brief The words of @c _bits.
+   */
+  const uint64_t *_words;
+
+  /*! @brief The number of words in @c _words.
+   */
+  NSUInteger _wordCount;
+
+  /*! @brief The scopes of the set which have no bit index, or nil if there are none.
+   */
+  NSSet<NSString *> *_unregisteredScopes;
+}
+
+@synthesize scopes = _scopes;
+@synthesize scopeString = _scopeString;
+
+- (instancetype)init
+    EkoOID_UNAVAILABLE_USE_INITIALIZER(@selector(scopeSetWithString:))
+
+- (instancetype)initWithBits:(NSData *)bits
+          unregisteredScopes:(nullable NSSet<NSString *> *)unregisteredScopes
+                      scopes:(NSArray<NSString *> *)scopes {
+  self = [super init];
+  if (self) {
+    _bits = bits;
+    _words = bits.bytes;
+    _wordCount = bits.length / sizeof(uint64_t);
+    _unregisteredScopes = [unregisteredScopes copy];
+    _scopes = [scopes copy];
+    _scopeString = [_scopes componentsJoinedByString:@" "];
+  }
+  return self;
+}
+
++ (instancetype)emptyScopeSet {
+  return EkoOIDInternedScopeSet(NULL, 0, nil);
+}
+
++ (instancetype)scopeSetWithString:(nullable NSString *)scopes {
+  if (!scopes.length) {
+    return [self emptyScopeSet];
+  }
+
+  static NSCache<NSString *, EkoOIDScopeSet *> *scopeStringCache;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    scopeStringCache = [[NSCache alloc] init];
+    scopeStringCache.countLimit = kScopeStringCacheCountLimit;
+  });
+
+  EkoOIDScopeSet *scopeSet = [scopeStringCache objectForKey:scopes];
+  if (scopeSet) {
+    return scopeSet;
+  }
+
+  NSString *immutableScopes = [scopes copy];
+  NSMutableArray<NSString *> *scopeArray = [NSMutableArray array];
+  for (NSString *scope in [immutableScopes componentsSeparatedByString:@" "]) {
+    if (scope.length) {
+      [scopeArray addObject:scope];
+    }
+  }
+  scopeSet = [self scopeSetWithArray:scopeArray];
+  [scopeStringCache setObject:scopeSet forKey:immutableScopes];
+  return scopeSet;
+}
+
++ (instancetype)scopeSetWithArray:(NSArray<NSString *> *)scopes {
+  if (!scopes.count) {
+    return [self emptyScopeSet];
+  }
+
+  NSMutableData *words = [NSMutableData data];
+  NSMutableSet<NSString *> *unregisteredScopes;
+  @synchronized(EkoOIDScopeIndexes()) {
+    for (NSString *scope in scopes) {
+      NSUInteger index = EkoOIDRegisteredScopeIndex(scope);
+      if (index == NSNotFound) {
+        if (!unregisteredScopes) {
+          unregisteredScopes = [NSMutableSet set];
+        }
+        [unregisteredScopes addObject:[scope copy]];
+        continue;
+      }
+      NSUInteger wordIndex = index / kBitsPerWord;
+      if (words.length < (wordIndex + 1) * sizeof(uint64_t)) {
+        words.length = (wordIndex + 1) * sizeof(uint64_t);
+      }
+      ((uint64_t *)words.mutableBytes)[wordIndex] |= (uint64_t)1 << (index % kBitsPerWord);
+    }
+  }
+  return EkoOIDInternedScopeSet(words.bytes, words.length / sizeof(uint64_t), unregisteredScopes);
+}
+
+- (NSUInteger)count {
+  return _scopes.count;
+}
+
+- (BOOL)containsScope:(NSString *)scope {
+  NSNumber *index;
+  @synchronized(EkoOIDScopeIndexes()) {
+    index = EkoOIDScopeIndexes()[scope];
+  }
+  if (!index) {
+    return [_unregisteredScopes containsObject:scope];
+  }
+  NSUInteger wordIndex = index.unsignedIntegerValue / kBitsPerWord;
+  if (wordIndex >= _wordCount) {
+    return NO;
+  }
+  return (_words[wordIndex] >> (index.unsignedIntegerValue % kBitsPerWord)) & 1;
+}
+
+- (BOOL)isSubsetOfScopeSet:(EkoOIDScopeSet *)scopeSet {
+  if (self == scopeSet) {
+    return YES;
+  }
+  // Neither bitset has trailing zero words, so a longer one has a scope beyond the shorter one.
+  if (_wordCount > scopeSet->_wordCount) {
+    return NO;
+  }
+  for (NSUInteger i = 0; i < _wordCount; i++) {
+    if (_words[i] & ~scopeSet->_words[i]) {
+      return NO;
+    }
+  }
+  if (_unregisteredScopes) {
+    return scopeSet->_unregisteredScopes &&
+        [_unregisteredScopes isSubsetOfSet:scopeSet->_unregisteredScopes];
+  }
+  return YES;
+}
+
+- (EkoOIDScopeSet *)scopeSetByAddingScopeSet:(EkoOIDScopeSet *)scopeSet {
+  if ([scopeSet isSubsetOfScopeSet:self]) {
+    return self;
+  }
+  if ([self isSubsetOfScopeSet:scopeSet]) {
+    return scopeSet;
+  }
+
+  EkoOIDScopeSet *longer = _wordCount >= scopeSet->_wordCount ? self : scopeSet;
+  EkoOIDScopeSet *shorter = longer == self ? scopeSet : self;
+  NSMutableData *words = [longer->_bits mutableCopy];
+  uint64_t *unionWords = words.mutableBytes;
+  for (NSUInteger i = 0; i < shorter->_wordCount; i++) {
+    unionWords[i] |= shorter->_words[i];
+  }
+  NSSet<NSString *> *unregisteredScopes = _unregisteredScopes ?: scopeSet->_unregisteredScopes;
+  if (_unregisteredScopes && scopeSet->_unregisteredScopes) {
+    unregisteredScopes =
+        [_unregisteredScopes setByAddingObjectsFromSet:scopeSet->_unregisteredScopes];
+  }
+  return EkoOIDInternedScopeSet(unionWords, longer->_wordCount, unregisteredScopes);
+}
+
+#pragma mark - NSCopying
+
+- (instancetype)copyWithZone:(nullable NSZone *)zone {
+  // The set is immutable.
+  return self;
+}
+
+#pragma mark - NSObject overrides
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"<%@: %p, scopes: \"%@\">",
+                                    NSStringFromClass([self class]),
+                                    (void *)self,
+                                    _scopeString];
+}
+
+@end
@@ -31,6 +31,8 @@ typedef void (^EkoOIDServiceConfigurationCreated)
      NSError *_Nullable error);
 
 /*! @brief Represents the information needed to construct a @c EkoOIDAuthorizationService.
+    @discussion Configurations are immutable and shared: initializing or decoding a configuration
+        equal to one which is still in use returns that instance.
  */
 @interface EkoOIDServiceConfiguration : NSObject <NSCopying, NSSecureCoding>
 
@@ -21,6 +21,7 @@
 #import "OIDDefines.h"
 #import "OIDErrorUtilities.h"
 #import "OIDServiceDiscovery.h"
+#import "OIDTokenUtilities.h"
 
 /*! @brief The key for the @c authorizationEndpoint property.
  */
@@ -46,6 +47,10 @@ static NSString *const kEndSessionEndpointKey = @"endSessionEndpoint";
  */
 static NSString *const kDiscoveryDocumentKey = @"discoveryDocument";
 
+/*! @brief The number of entries the configuration registry can reach before its first purge.
+ */
+static const NSUInteger kRegistryMinimumPurgeCount = 64;
+
 NS_ASSUME_NONNULL_BEGIN
 
 @interface EkoOIDServiceConfiguration ()
@@ -60,6 +65,58 @@ NS_ASSUME_NONNULL_BEGIN
 
 @end
 
+/*! @brief Returns the registered configuration with the same endpoints and discovery document as
+        @c configuration, registering @c configuration if there is none.
+    @discussion Configurations are held weakly, and the keys of those which have been deallocated
+        are purged whenever the registry has doubled in size since the last purge, so the registry
+        only grows with the number of distinct configurations still in use. A configuration whose
+        discovery document differs from the registered one replaces it, so the most recently
+        discovered document is shared.
+ */
+static EkoOIDServiceConfiguration *EkoOIDRegisteredServiceConfiguration(
+    EkoOIDServiceConfiguration *configuration) {
+  static NSMapTable<NSArray *, EkoOIDServiceConfiguration *> *registry;
+  static NSUInteger purgeCount;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    registry = [NSMapTable strongToWeakObjectsMapTable];
+    purgeCount = kRegistryMinimumPurgeCount;
+  });
+
+  id null = [NSNull null];
+  NSArray *key = @[
+    [configuration class],
+    configuration.authorizationEndpoint ?: null,
+    configuration.tokenEndpoint ?: null,
+    configuration.issuer ?: null,
+    configuration.registrationEndpoint ?: null,
+    configuration.endSessionEndpoint ?: null
+  ];
+  @synchronized(registry) {
+    EkoOIDServiceConfiguration *registered = [registry objectForKey:key];
+    if (registered
+        && EkoOIDIsEqualIncludingNil(registered.discoveryDocument.discoveryDictionary,
+                                     configuration.discoveryDocument.discoveryDictionary)) {
+      return registered;
+    }
+    if (!registered && registry.count >= purgeCount) {
+      // Entries keep their keys after their configuration has been deallocated.
+      NSMutableArray<NSArray *> *deallocatedKeys = [NSMutableArray array];
+      for (NSArray *registeredKey in registry) {
+        if (![registry objectForKey:registeredKey]) {
+          [deallocatedKeys addObject:registeredKey];
+        }
+      }
+      for (NSArray *deallocatedKey in deallocatedKeys) {
+        [registry removeObjectForKey:deallocatedKey];
+      }
+      purgeCount = MAX(kRegistryMinimumPurgeCount, registry.count * 2);
+    }
+    [registry setObject:configuration forKey:key];
+    return configuration;
+  }
+}
+
 @implementation EkoOIDServiceConfiguration
 
 - (instancetype)init
@@ -76,15 +133,17 @@ NS_ASSUME_NONNULL_BEGIN
     discoveryDocument:(nullable EkoOIDServiceDiscovery *)discoveryDocument {
 
   self = [super init];
-  if (self) {
-    _authorizationEndpoint = [authorizationEndpoint copy];
-    _tokenEndpoint = [tokenEndpoint copy];
-    _issuer = [issuer copy];
-    _registrationEndpoint = [registrationEndpoint copy];
-    _endSessionEndpoint = [endSessionEndpoint copy];
-    _discoveryDocument = [discoveryDocument copy];
+  if (!self) {
+    return nil;
   }
-  return self;
+  _authorizationEndpoint = [EkoOIDTokenUtilities internedURL:authorizationEndpoint];
+  _tokenEndpoint = [EkoOIDTokenUtilities internedURL:tokenEndpoint];
+  _issuer = [EkoOIDTokenUtilities internedURL:issuer];
+  _registrationEndpoint = [EkoOIDTokenUtilities internedURL:registrationEndpoint];
+  _endSessionEndpoint = [EkoOIDTokenUtilities internedURL:endSessionEndpoint];
+  _discoveryDocument = [discoveryDocument copy];
+  // Equal configurations, including decoded ones, share one instance.
+  return EkoOIDRegisteredServiceConfiguration(self);
 }
 
 - (instancetype)initWithAuthorizationEndpoint:(NSURL *)authorizationEndpoint
@@ -0,0 +1,103 @@
+/*! @file EkoOIDTokenIntrospector.h
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "OIDAuthorizationService.h"
+
+@class EkoOIDIntrospectionResponse;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! @brief Introspects tokens for a resource server, caching the results.
+    @discussion Results for active tokens are cached for @c activeResultLifetime, but never past the
+        token's expiry, and results for inactive tokens for @c inactiveResultLifetime. Errors are
+        not cached. Concurrent introspections of the same token share a single request.
+    @see https://tools.ietf.org/html/rfc7662
+ */
+@interface EkoOIDTokenIntrospector : NSObject
+
+/*! @brief The authorization server's introspection endpoint.
+ */
+@property(nonatomic, readonly) NSURL *introspectionEndpoint;
+
+/*! @brief The client identifier the resource server authenticates with.
+ */
+@property(nonatomic, readonly) NSString *clientID;
+
+/*! @brief The client secret the resource server authenticates with.
+ */
+@property(nonatomic, readonly, nullable) NSString *clientSecret;
+
+/*! @brief The longest time a result for an active token is cached, in seconds.
+ */
+@property(nonatomic, readonly) NSTimeInterval activeResultLifetime;
+
+/*! @brief How long a result for an inactive token is cached, in seconds.
+ */
+@property(nonatomic, readonly) NSTimeInterval inactiveResultLifetime;
+
+/*! @internal
+    @brief Unavailable. Please use @c initWithIntrospectionEndpoint:clientID:clientSecret:.
+ */
+- (instancetype)init NS_UNAVAILABLE;
+
+/*! @brief Creates an introspector which caches results for active tokens for up to a minute, and
+        results for inactive tokens for ten seconds.
+    @param introspectionEndpoint The authorization server's introspection endpoint.
+    @param clientID The client identifier the resource server authenticates with.
+    @param clientSecret The client secret the resource server authenticates with.
+ */
+- (instancetype)initWithIntrospectionEndpoint:(NSURL *)introspectionEndpoint
+                                     clientID:(NSString *)clientID
+                                 clientSecret:(nullable NSString *)clientSecret;
+
+/*! @brief Designated initializer.
+    @param introspectionEndpoint The authorization server's introspection endpoint.
+    @param clientID The client identifier the resource server authenticates with.
+    @param clientSecret The client secret the resource server authenticates with.
+    @param activeResultLifetime The longest time a result for an active token is cached.
+    @param inactiveResultLifetime How long a result for an inactive token is cached.
+ */
+- (instancetype)initWithIntrospectionEndpoint:(NSURL *)introspectionEndpoint
+                                     clientID:(NSString *)clientID
+                                 clientSecret:(nullable NSString *)clientSecret
+                         activeResultLifetime:(NSTimeInterval)activeResultLifetime
+                       inactiveResultLifetime:(NSTimeInterval)inactiveResultLifetime
+    NS_DESIGNATED_INITIALIZER;
+
+/*! @brief Returns the cached result for a token, or nil if there is none or it has expired.
+    @param token The token.
+    @discussion Doesn't make a request, so a resource server can check hot tokens synchronously and
+        only fall back to @c EkoOIDTokenIntrospector.introspectToken:callback: on a miss.
+ */
+- (nullable EkoOIDIntrospectionResponse *)cachedResponseForToken:(NSString *)token;
+
+/*! @brief Introspects a token, using the cached result if there is one.
+    @param token The token.
+    @param callback The method called on the main thread with the result.
+ */
+- (void)introspectToken:(NSString *)token callback:(EkoOIDIntrospectionCallback)callback;
+
+/*! @brief Discards every cached result.
+ */
+- (void)removeAllCachedResponses;
+
+@end
+
+NS_ASSUME_NONNULL_END
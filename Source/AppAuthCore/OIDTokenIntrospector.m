@@ -0,0 +1,185 @@
+/*! @file EkoOIDTokenIntrospector.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import "OIDTokenIntrospector.h"
+
+#import "OIDDefines.h"
+#import "OIDIntrospectionRequest.h"
+#import "OIDIntrospectionResponse.h"
+
+/*! @brief The default value of @c EkoOIDTokenIntrospector.activeResultLifetime.
+ */
+static const NSTimeInterval kDefaultActiveResultLifetime = 60;
+
+/*! @brief The default value of @c EkoOIDTokenIntrospector.inactiveResultLifetime.
+ */
+static const NSTimeInterval kDefaultInactiveResultLifetime = 10;
+
+/*! @brief The number of results kept by each introspector.
+ */
+static const NSUInteger kResultCacheCountLimit = 1024;
+
+/*! @brief A cached introspection result and when it stops being used.
+ */
+@interface EkoOIDCachedIntrospection : NSObject
+@property(nonatomic, readonly) EkoOIDIntrospectionResponse *response;
+@property(nonatomic, readonly) NSTimeInterval expiry;
+- (instancetype)initWithResponse:(EkoOIDIntrospectionResponse *)response
+                          expiry:(NSTimeInterval)expiry;
+@end
+@implementation EkoOIDCachedIntrospection
+- (instancetype)initWithResponse:(EkoOIDIntrospectionResponse *)response
+                          expiry:(NSTimeInterval)expiry {
+  self = [super init];
+  if (self) {
+    _response = response;
+    _expiry = expiry;
+  }
+  return self;
+}
+@end
+
+@implementation EkoOIDTokenIntrospector {
+  /*! @brief The cached results, keyed by token.
+   */
+  NSCache<NSString *, EkoOIDCachedIntrospection *> *_results;
+
+  /*! @brief The callbacks waiting for introspections in progress, keyed by token (use @c self to
+        synchronize access).
+   */
+  NSMutableDictionary<NSString *, NSMutableArray<EkoOIDIntrospectionCallback> *> *_pendingCallbacks;
+}
+
+- (instancetype)init
+    EkoOID_UNAVAILABLE_USE_INITIALIZER(
+        @selector(initWithIntrospectionEndpoint:clientID:clientSecret:)
+    )
+
+- (instancetype)initWithIntrospectionEndpoint:(NSURL *)introspectionEndpoint
+                                     clientID:(NSString *)clientID
+                                 clientSecret:(nullable NSString *)clientSecret {
+  return [self initWithIntrospectionEndpoint:introspectionEndpoint
+                                    clientID:clientID
+                                clientSecret:clientSecret
+                        activeResultLifetime:kDefaultActiveResultLifetime
+                      inactiveResultLifetime:kDefaultInactiveResultLifetime];
+}
+
+- (instancetype)initWithIntrospectionEndpoint:(NSURL *)introspectionEndpoint
+                                     clientID:(NSString *)clientID
+                                 clientSecret:(nullable NSString *)clientSecret
+                         activeResultLifetime:(NSTimeInterval)activeResultLifetime
+                       inactiveResultLifetime:(NSTimeInterval)inactiveResultLifetime {
+  self = [super init];
+  if (self) {
+    _introspectionEndpoint = [introspectionEndpoint copy];
+    _clientID = [clientID copy];
+    _clientSecret = [clientSecret copy];
+    _activeResultLifetime = activeResultLifetime;
+    _inactiveResultLifetime = inactiveResultLifetime;
+    _results = [[NSCache alloc] init];
+    _results.countLimit = kResultCacheCountLimit;
+    _pendingCallbacks = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+- (nullable EkoOIDIntrospectionResponse *)cachedResponseForToken:(NSString *)token {
+  EkoOIDCachedIntrospection *result = [_results objectForKey:token];
+  if (!result) {
+    return nil;
+  }
+  if (result.expiry <= [NSDate timeIntervalSinceReferenceDate]) {
+    [_results removeObjectForKey:token];
+    return nil;
+  }
+  return result.response;
+}
+
+- (void)introspectToken:(NSString *)token callback:(EkoOIDIntrospectionCallback)callback {
+  EkoOIDIntrospectionResponse *cachedResponse = [self cachedResponseForToken:token];
+  if (cachedResponse) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+      callback(cachedResponse, nil);
+    });
+    return;
+  }
+
+  NSString *immutableToken = [token copy];
+  @synchronized(self) {
+    NSMutableArray<EkoOIDIntrospectionCallback> *callbacks = _pendingCallbacks[immutableToken];
+    if (callbacks) {
+      [callbacks addObject:[callback copy]];
+      return;
+    }
+    _pendingCallbacks[immutableToken] = [NSMutableArray arrayWithObject:[callback copy]];
+  }
+
+  EkoOIDIntrospectionRequest *request =
+      [[EkoOIDIntrospectionRequest alloc] initWithIntrospectionEndpoint:_introspectionEndpoint
+                                                                  token:immutableToken
+                                                          tokenTypeHint:nil
+                                                               clientID:_clientID
+                                                           clientSecret:_clientSecret
+                                                   additionalParameters:nil];
+  [EkoOIDAuthorizationService performIntrospectionRequest:request
+      callback:^(EkoOIDIntrospectionResponse *_Nullable response, NSError *_Nullable error) {
+    if (response) {
+      [self cacheResponse:response forToken:immutableToken];
+    }
+
+    NSArray<EkoOIDIntrospectionCallback> *callbacks;
+    @synchronized(self) {
+      callbacks = self->_pendingCallbacks[immutableToken];
+      [self->_pendingCallbacks removeObjectForKey:immutableToken];
+    }
+    for (EkoOIDIntrospectionCallback pendingCallback in callbacks) {
+      pendingCallback(response, error);
+    }
+  }];
+}
+
+/*! @brief Caches a result until it should no longer be used.
+    @param response The result.
+    @param token The introspected token.
+ */
+- (void)cacheResponse:(EkoOIDIntrospectionResponse *)response forToken:(NSString *)token {
+  NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+  NSTimeInterval expiry;
+  if (response.active) {
+    expiry = now + _activeResultLifetime;
+    // an active result must not outlive the token
+    NSDate *expiresAt = response.expiresAt;
+    if (expiresAt) {
+      expiry = MIN(expiry, expiresAt.timeIntervalSinceReferenceDate);
+    }
+  } else {
+    expiry = now + _inactiveResultLifetime;
+  }
+  if (expiry <= now) {
+    return;
+  }
+  [_results setObject:[[EkoOIDCachedIntrospection alloc] initWithResponse:response expiry:expiry]
+               forKey:token];
+}
+
+- (void)removeAllCachedResponses {
+  [_results removeAllObjects];
+}
+
+@end
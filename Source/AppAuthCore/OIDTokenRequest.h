@@ -152,6 +152,29 @@ NS_ASSUME_NONNULL_BEGIN
     additionalParameters:(nullable NSDictionary<NSString *, NSString *> *)additionalParameters
     NS_DESIGNATED_INITIALIZER;
 
+/*! @brief Creates a token exchange request.
+    @param configuration The service's configuration.
+    @param clientID The client identifier.
+    @param clientSecret The client secret.
+    @param subjectToken The token to exchange, such as the user's access token.
+    @param subjectTokenType The type of @c subjectToken, such as
+        @c ::EkoOIDTokenTypeAccessToken. @see EkoOIDGrantTypes.h
+    @param audience The logical name of the service the issued token is for, or nil.
+    @param scope The scope of the issued token, or nil.
+    @param additionalParameters The client's additional token request parameters, such as
+        @c requested_token_type or @c resource.
+    @discussion The subject token, its type and the audience are sent as additional parameters.
+    @see https://tools.ietf.org/html/rfc8693#section-2.1
+ */
+- (instancetype)initWithConfiguration:(EkoOIDServiceConfiguration *)configuration
+                clientID:(NSString *)clientID
+            clientSecret:(nullable NSString *)clientSecret
+            subjectToken:(NSString *)subjectToken
+        subjectTokenType:(NSString *)subjectTokenType
+                audience:(nullable NSString *)audience
+                   scope:(nullable NSString *)scope
+    additionalParameters:(nullable NSDictionary<NSString *, NSString *> *)additionalParameters;
+
 /*! @brief Constructs an @c NSURLRequest representing the token request.
     @return An @c NSURLRequest representing the token request.
  */
@@ -67,6 +67,13 @@ static NSString *const kCodeVerifierKey = @"code_verifier";
  */
 static NSString *const kAdditionalParametersKey = @"additionalParameters";
 
+/*! @brief Token exchange request parameters, sent as additional parameters.
+    @see https://tools.ietf.org/html/rfc8693#section-2.1
+ */
+static NSString *const kSubjectTokenKey = @"subject_token";
+static NSString *const kSubjectTokenTypeKey = @"subject_token_type";
+static NSString *const kAudienceKey = @"audience";
+
 @implementation EkoOIDTokenRequest
 
 - (instancetype)init
@@ -120,10 +127,10 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
     _configuration = [configuration copy];
     _grantType = [grantType copy];
     _authorizationCode = [code copy];
-    _redirectURL = [redirectURL copy];
-    _clientID = [clientID copy];
+    _redirectURL = [EkoOIDTokenUtilities internedURL:redirectURL];
+    _clientID = [EkoOIDTokenUtilities internedString:clientID];
     _clientSecret = [clientSecret copy];
-    _scope = [scope copy];
+    _scope = [EkoOIDTokenUtilities internedString:scope];
     _refreshToken = [refreshToken copy];
     _codeVerifier = [codeVerifier copy];
     _additionalParameters =
@@ -142,6 +149,31 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
   return self;
 }
 
+- (instancetype)initWithConfiguration:(EkoOIDServiceConfiguration *)configuration
+                clientID:(NSString *)clientID
+            clientSecret:(nullable NSString *)clientSecret
+            subjectToken:(NSString *)subjectToken
+        subjectTokenType:(NSString *)subjectTokenType
+                audience:(nullable NSString *)audience
+                   scope:(nullable NSString *)scope
+    additionalParameters:(nullable NSDictionary<NSString *, NSString *> *)additionalParameters {
+  NSMutableDictionary<NSString *, NSString *> *exchangeParameters =
+      additionalParameters ? [additionalParameters mutableCopy] : [NSMutableDictionary dictionary];
+  exchangeParameters[kSubjectTokenKey] = subjectToken;
+  exchangeParameters[kSubjectTokenTypeKey] = subjectTokenType;
+  exchangeParameters[kAudienceKey] = audience;
+  return [self initWithConfiguration:configuration
+                           grantType:EkoOIDGrantTypeTokenExchange
+                   authorizationCode:nil
+                         redirectURL:nil
+                            clientID:clientID
+                        clientSecret:clientSecret
+                               scope:scope
+                        refreshToken:nil
+                        codeVerifier:nil
+                additionalParameters:exchangeParameters];
+}
+
 #pragma mark - NSCopying
 
 - (instancetype)copyWithZone:(nullable NSZone *)zone {
@@ -226,38 +258,42 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
   return _configuration.tokenEndpoint;
 }
 
-/*! @brief Constructs the request body data by combining the request parameters using the
+/*! @brief Writes the request body by combining the request parameters using the
         "application/x-www-form-urlencoded" format.
-    @return The data to pass to the token request URL.
+    @param body The buffer the encoded parameters are appended to.
     @see https://tools.ietf.org/html/rfc6749#section-4.1.3
  */
-- (EkoOIDURLQueryComponent *)tokenRequestBody {
-  EkoOIDURLQueryComponent *query = [[EkoOIDURLQueryComponent alloc] init];
-
+- (void)appendTokenRequestBodyToData:(NSMutableData *)body {
   // Add parameters, as applicable.
   if (_grantType) {
-    [query addParameter:kGrantTypeKey value:_grantType];
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kGrantTypeKey value:_grantType toData:body];
   }
   if (_scope) {
-    [query addParameter:kScopeKey value:_scope];
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kScopeKey value:_scope toData:body];
   }
   if (_redirectURL) {
-    [query addParameter:kRedirectURLKey value:_redirectURL.absoluteString];
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kRedirectURLKey
+                                                 value:_redirectURL.absoluteString
+                                                toData:body];
   }
   if (_refreshToken) {
-    [query addParameter:kRefreshTokenKey value:_refreshToken];
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kRefreshTokenKey
+                                                 value:_refreshToken
+                                                toData:body];
   }
   if (_authorizationCode) {
-    [query addParameter:kAuthorizationCodeKey value:_authorizationCode];
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kAuthorizationCodeKey
+                                                 value:_authorizationCode
+                                                toData:body];
   }
   if (_codeVerifier) {
-    [query addParameter:kCodeVerifierKey value:_codeVerifier];
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kCodeVerifierKey
+                                                 value:_codeVerifier
+                                                toData:body];
   }
 
   // Add any additional parameters the client has specified.
-  [query addParameters:_additionalParameters];
-
-  return query;
+  [EkoOIDURLQueryComponent appendURLEncodedParameters:_additionalParameters toData:body];
 }
 
 - (NSURLRequest *)URLRequest {
@@ -265,42 +301,29 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
   static NSString *const kHTTPContentTypeHeaderKey = @"Content-Type";
   static NSString *const kHTTPContentTypeHeaderValue =
       @"application/x-www-form-urlencoded; charset=UTF-8";
+  static NSString *const kHTTPAuthorizationHeaderKey = @"Authorization";
+  // Large enough for typical token requests, so the body is written without reallocating.
+  static const NSUInteger kBodyCapacity = 1024;
 
   NSURL *tokenRequestURL = [self tokenRequestURL];
-  NSMutableURLRequest *URLRequest = [[NSURLRequest requestWithURL:tokenRequestURL] mutableCopy];
+  NSMutableURLRequest *URLRequest = [NSMutableURLRequest requestWithURL:tokenRequestURL];
   URLRequest.HTTPMethod = kHTTPPost;
   [URLRequest setValue:kHTTPContentTypeHeaderValue forHTTPHeaderField:kHTTPContentTypeHeaderKey];
 
-  EkoOIDURLQueryComponent *bodyParameters = [self tokenRequestBody];
-  NSMutableDictionary *httpHeaders = [[NSMutableDictionary alloc] init];
+  // Constructs the request body directly in a single buffer.
+  NSMutableData *body = [NSMutableData dataWithCapacity:kBodyCapacity];
+  [self appendTokenRequestBodyToData:body];
 
   if (_clientSecret) {
-    // The client id and secret are encoded using the "application/x-www-form-urlencoded" 
-    // encoding algorithm per RFC 6749 Section 2.3.1.
-    // https://tools.ietf.org/html/rfc6749#section-2.3.1
-    NSString *encodedClientID = [EkoOIDTokenUtilities formUrlEncode:_clientID];
-    NSString *encodedClientSecret = [EkoOIDTokenUtilities formUrlEncode:_clientSecret];
-    
-    NSString *credentials =
-        [NSString stringWithFormat:@"%@:%@", encodedClientID, encodedClientSecret];
-    NSData *plainData = [credentials dataUsingEncoding:NSUTF8StringEncoding];
-    NSString *basicAuth = [plainData base64EncodedStringWithOptions:kNilOptions];
-
-    NSString *authValue = [NSString stringWithFormat:@"Basic %@", basicAuth];
-    [httpHeaders setObject:authValue forKey:@"Authorization"];
+    NSString *authValue =
+        [EkoOIDTokenUtilities basicAuthorizationHeaderValueWithClientID:_clientID
+                                                           clientSecret:_clientSecret];
+    [URLRequest setValue:authValue forHTTPHeaderField:kHTTPAuthorizationHeaderKey];
   } else  {
-    [bodyParameters addParameter:kClientIDKey value:_clientID];
+    [EkoOIDURLQueryComponent appendURLEncodedParameter:kClientIDKey value:_clientID toData:body];
   }
 
-  // Constructs request with the body string and headers.
-  NSString *bodyString = [bodyParameters URLEncodedParameters];
-  NSData *body = [bodyString dataUsingEncoding:NSUTF8StringEncoding];
   URLRequest.HTTPBody = body;
-
-  for (id header in httpHeaders) {
-    [URLRequest setValue:httpHeaders[header] forHTTPHeaderField:header];
-  }
-
   return URLRequest;
 }
 
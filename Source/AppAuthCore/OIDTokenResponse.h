@@ -99,7 +99,11 @@ NS_ASSUME_NONNULL_BEGIN
     @param parameters The decoded parameters returned from the Authorization Server.
     @remarks Known parameters are extracted from the @c parameters parameter and the normative
         properties are populated. Non-normative parameters are placed in the
-        @c #additionalParameters dictionary.
+        @c #additionalParameters dictionary. Each property is decoded from the parameters on its
+        own, the first time it is read, through @c decodedField:, which records the decoded
+        properties in the @c _decodedFields bit mask; the parameters are released once every
+        property has been decoded. @c #accessTokenExpirationDate is always relative to when the
+        response was created.
  */
 - (instancetype)initWithRequest:(EkoOIDTokenRequest *)request
                      parameters:(NSDictionary<NSString *, NSObject<NSCopying> *> *)parameters
@@ -18,6 +18,8 @@
 
 #import "OIDTokenResponse.h"
 
+#import <stdatomic.h>
+
 #import "OIDDefines.h"
 #import "OIDFieldMapping.h"
 #import "OIDTokenRequest.h"
@@ -27,66 +29,105 @@
  */
 static NSString *const kRequestKey = @"request";
 
-/*! @brief The key for the @c accessToken property in the incoming parameters and for
-        @c NSSecureCoding.
- */
-static NSString *const kAccessTokenKey = @"access_token";
-
 /*! @brief The key for the @c accessTokenExpirationDate property in the incoming parameters and for
         @c NSSecureCoding.
  */
 static NSString *const kExpiresInKey = @"expires_in";
 
-/*! @brief The key for the @c tokenType property in the incoming parameters and for
-        @c NSSecureCoding.
+/*! @brief Key used to encode the @c additionalParameters property for @c NSSecureCoding
  */
-static NSString *const kTokenTypeKey = @"token_type";
+static NSString *const kAdditionalParametersKey = @"additionalParameters";
 
-/*! @brief The key for the @c idToken property in the incoming parameters and for @c NSSecureCoding.
- */
-static NSString *const kIDTokenKey = @"id_token";
+@implementation EkoOIDTokenResponse {
+  /*! @brief The response parameters, held until every property has been read.
+   */
+  NSDictionary<NSString *, NSObject<NSCopying> *> *_parameters;
 
-/*! @brief The key for the @c refreshToken property in the incoming parameters and for
-        @c NSSecureCoding.
+  /*! @brief When the response was created, as an interval since the reference date. The relative
+        @c expires_in parameter is measured from this time.
+   */
+  NSTimeInterval _creationTime;
+
+  /*! @brief The properties which have been decoded from @c _parameters, as bits indexed by field,
+        with @c kAdditionalParametersField for @c additionalParameters.
+   */
+  atomic_uint _decodedFields;
+}
+
+@synthesize accessToken = _accessToken;
+@synthesize accessTokenExpirationDate = _accessTokenExpirationDate;
+@synthesize tokenType = _tokenType;
+@synthesize idToken = _idToken;
+@synthesize refreshToken = _refreshToken;
+@synthesize scope = _scope;
+@synthesize additionalParameters = _additionalParameters;
+
+/*! @brief The fields of @c EkoOIDTokenResponse, as indexes into @c kFieldDescriptors.
  */
-static NSString *const kRefreshTokenKey = @"refresh_token";
+enum {
+  kAccessTokenField,
+  kExpiresInField,
+  kTokenTypeField,
+  kIDTokenField,
+  kRefreshTokenField,
+  kScopeField,
+  /*! @brief Not in @c kFieldDescriptors; marks @c additionalParameters in @c _decodedFields. */
+  kAdditionalParametersField,
+};
 
-/*! @brief The key for the @c scope property in the incoming parameters and for @c NSSecureCoding.
+/*! @brief The value of @c _decodedFields once every property has been decoded.
  */
-static NSString *const kScopeKey = @"scope";
+static const unsigned int kAllFieldsDecoded = (1u << (kAdditionalParametersField + 1)) - 1;
 
-/*! @brief Key used to encode the @c additionalParameters property for @c NSSecureCoding
+/*! @brief The incoming parameters mapped to instance variables, which are also the
+        @c NSSecureCoding keys of those variables.
  */
-static NSString *const kAdditionalParametersKey = @"additionalParameters";
+static const EkoOIDFieldDescriptor kFieldDescriptors[] = {
+  [kAccessTokenField] = { @"access_token", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kExpiresInField] = { @"expires_in", EkoOIDFieldTypeDate, EkoOIDFieldConversionDateSinceNow },
+  [kTokenTypeField] = { @"token_type", EkoOIDFieldTypeString, EkoOIDFieldConversionNone, YES },
+  [kIDTokenField] = { @"id_token", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kRefreshTokenField] = { @"refresh_token", EkoOIDFieldTypeString, EkoOIDFieldConversionNone },
+  [kScopeField] = { @"scope", EkoOIDFieldTypeString, EkoOIDFieldConversionNone, YES },
+};
 
-@implementation EkoOIDTokenResponse
+/*! @brief The perfect hash buckets of @c kFieldDescriptors.
+ */
+static const uint8_t kFieldBuckets[] = { 0, 3, 0, 0, 0, 0, 0, 4, 0, 6, 0, 5, 2, 0, 0, 1 };
 
-/*! @brief Returns a mapping of incoming parameters to instance variables.
-    @return A mapping of incoming parameters to instance variables.
+/*! @brief Returns the instance variable storage of @c field.
  */
-+ (NSDictionary<NSString *, EkoOIDFieldMapping *> *)fieldMap {
-  static NSMutableDictionary<NSString *, EkoOIDFieldMapping *> *fieldMap;
-  static dispatch_once_t onceToken;
-  dispatch_once(&onceToken, ^{
-    fieldMap = [NSMutableDictionary dictionary];
-    fieldMap[kAccessTokenKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_accessToken" type:[NSString class]];
-    fieldMap[kExpiresInKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_accessTokenExpirationDate"
-                                         type:[NSDate class]
-                                   conversion:[EkoOIDFieldMapping dateSinceNowConversion]];
-    fieldMap[kTokenTypeKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_tokenType" type:[NSString class]];
-    fieldMap[kIDTokenKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_idToken" type:[NSString class]];
-    fieldMap[kRefreshTokenKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_refreshToken" type:[NSString class]];
-    fieldMap[kScopeKey] =
-        [[EkoOIDFieldMapping alloc] initWithName:@"_scope" type:[NSString class]];
-  });
-  return fieldMap;
+static __strong id _Nullable *_Nonnull EkoOIDTokenResponseFieldSlot(id instance, NSUInteger field) {
+  EkoOIDTokenResponse *response = instance;
+  switch (field) {
+    case kAccessTokenField:
+      return (__strong id *)&response->_accessToken;
+    case kExpiresInField:
+      return (__strong id *)&response->_accessTokenExpirationDate;
+    case kTokenTypeField:
+      return (__strong id *)&response->_tokenType;
+    case kIDTokenField:
+      return (__strong id *)&response->_idToken;
+    case kRefreshTokenField:
+      return (__strong id *)&response->_refreshToken;
+    case kScopeField:
+      return (__strong id *)&response->_scope;
+  }
+  NSCAssert(NO, @"Unknown field %lu", (unsigned long)field);
+  return NULL;
 }
 
+/*! @brief Maps incoming parameters to instance variables.
+ */
+static const EkoOIDFieldTable kFieldTable = {
+  kFieldDescriptors,
+  sizeof(kFieldDescriptors) / sizeof(kFieldDescriptors[0]),
+  0x9E3779B1,
+  28,
+  kFieldBuckets,
+  EkoOIDTokenResponseFieldSlot,
+};
+
 #pragma mark - Initializers
 
 - (instancetype)init
@@ -97,15 +138,91 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
   self = [super init];
   if (self) {
     _request = [request copy];
-    NSDictionary<NSString *, NSObject<NSCopying> *> *additionalParameters =
-        [EkoOIDFieldMapping remainingParametersWithMap:[[self class] fieldMap]
-                                         parameters:parameters
-                                           instance:self];
-    _additionalParameters = additionalParameters;
+    _parameters = [parameters copy];
+    _creationTime = [NSDate timeIntervalSinceReferenceDate];
   }
   return self;
 }
 
+#pragma mark - Lazy Decoding
+
+/*! @brief Returns the storage of @c field, decoding it from the response parameters the first time
+        it is read.
+    @param field One of the fields of @c kFieldDescriptors, or @c kAdditionalParametersField.
+    @discussion Each property is decoded on its own, so reading only the access token doesn't pay
+        for decoding the other fields.
+ */
+- (__strong id *)decodedField:(NSUInteger)field {
+  __strong id *slot = field == kAdditionalParametersField
+      ? (__strong id *)&_additionalParameters
+      : EkoOIDTokenResponseFieldSlot(self, field);
+  unsigned int bit = 1u << field;
+  if (atomic_load_explicit(&_decodedFields, memory_order_acquire) & bit) {
+    return slot;
+  }
+  @synchronized(self) {
+    if (atomic_load_explicit(&_decodedFields, memory_order_relaxed) & bit) {
+      return slot;
+    }
+    NSDictionary<NSString *, NSObject<NSCopying> *> *parameters = _parameters;
+    if (field == kAdditionalParametersField) {
+      *slot = [EkoOIDFieldMapping remainingParametersWithTable:&kFieldTable parameters:parameters];
+    } else if (field == kExpiresInField) {
+      // The field table converts expires_in relative to the current time, but it is relative to
+      // when the response was received.
+      NSNumber *expiresIn = (NSNumber *)parameters[kExpiresInKey];
+      if ([expiresIn isKindOfClass:[NSNumber class]]) {
+        NSTimeInterval expiryTime = _creationTime + [expiresIn longLongValue];
+        *slot = [NSDate dateWithTimeIntervalSinceReferenceDate:expiryTime];
+      }
+    } else {
+      *slot = [EkoOIDFieldMapping valueForField:field table:&kFieldTable parameters:parameters];
+    }
+    unsigned int decodedFields =
+        atomic_fetch_or_explicit(&_decodedFields, bit, memory_order_release) | bit;
+    if (decodedFields == kAllFieldsDecoded) {
+      _parameters = nil;
+    }
+    return slot;
+  }
+}
+
+/*! @brief Decodes every property, for the methods which read all of the instance variables.
+ */
+- (void)decodeAllFields {
+  for (NSUInteger field = 0; field <= kAdditionalParametersField; field++) {
+    [self decodedField:field];
+  }
+}
+
+- (nullable NSString *)accessToken {
+  return *[self decodedField:kAccessTokenField];
+}
+
+- (nullable NSDate *)accessTokenExpirationDate {
+  return *[self decodedField:kExpiresInField];
+}
+
+- (nullable NSString *)tokenType {
+  return *[self decodedField:kTokenTypeField];
+}
+
+- (nullable NSString *)idToken {
+  return *[self decodedField:kIDTokenField];
+}
+
+- (nullable NSString *)refreshToken {
+  return *[self decodedField:kRefreshTokenField];
+}
+
+- (nullable NSString *)scope {
+  return *[self decodedField:kScopeField];
+}
+
+- (nullable NSDictionary<NSString *, NSObject<NSCopying> *> *)additionalParameters {
+  return *[self decodedField:kAdditionalParametersField];
+}
+
 #pragma mark - NSCopying
 
 - (instancetype)copyWithZone:(nullable NSZone *)zone {
@@ -127,7 +244,10 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
       [aDecoder decodeObjectOfClass:[EkoOIDTokenRequest class] forKey:kRequestKey];
   self = [self initWithRequest:request parameters:@{ }];
   if (self) {
-    [EkoOIDFieldMapping decodeWithCoder:aDecoder map:[[self class] fieldMap] instance:self];
+    // The archived values are already decoded.
+    _parameters = nil;
+    atomic_store_explicit(&_decodedFields, kAllFieldsDecoded, memory_order_release);
+    [EkoOIDFieldMapping decodeWithCoder:aDecoder table:&kFieldTable instance:self];
     _additionalParameters = [aDecoder decodeObjectOfClasses:[EkoOIDFieldMapping JSONTypes]
                                                      forKey:kAdditionalParametersKey];
   }
@@ -135,7 +255,8 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
 }
 
 - (void)encodeWithCoder:(NSCoder *)aCoder {
-  [EkoOIDFieldMapping encodeWithCoder:aCoder map:[[self class] fieldMap] instance:self];
+  [self decodeAllFields];
+  [EkoOIDFieldMapping encodeWithCoder:aCoder table:&kFieldTable instance:self];
   [aCoder encodeObject:_request forKey:kRequestKey];
   [aCoder encodeObject:_additionalParameters forKey:kAdditionalParametersKey];
 }
@@ -143,6 +264,7 @@ static NSString *const kAdditionalParametersKey = @"additionalParameters";
 #pragma mark - NSObject overrides
 
 - (NSString *)description {
+  [self decodeAllFields];
   return [NSString stringWithFormat:@"<%@: %p, accessToken: \"%@\", accessTokenExpirationDate: %@, "
                                      "tokenType: %@, idToken: \"%@\", refreshToken: \"%@\", "
                                      "scope: \"%@\", additionalParameters: %@, request: %@>",
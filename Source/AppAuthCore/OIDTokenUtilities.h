@@ -62,6 +62,34 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (NSString*)formUrlEncode:(NSString*)inputString;
 
+/*! @brief Builds the value of an HTTP Basic Authorization header for client authentication.
+    @param clientID The client identifier.
+    @param clientSecret The client secret.
+    @return "Basic " followed by the base64 encoding of the form url encoded client identifier and
+        secret, separated by a colon.
+    @see https://tools.ietf.org/html/rfc6749#section-2.3.1
+ */
++ (NSString *)basicAuthorizationHeaderValueWithClientID:(NSString *)clientID
+                                           clientSecret:(NSString *)clientSecret;
+
+/*! @brief Returns a shared immutable string equal to the input string.
+    @param string The input string.
+    @return An immutable string equal to @c string, which is the same instance for equal inputs
+        while any caller holds it. Long strings are copied but not shared.
+    @discussion Intended for metadata repeated across many authorizations, such as token types,
+        scopes and client identifiers. Never use it for tokens or other secrets.
+ */
++ (nullable NSString *)internedString:(nullable NSString *)string;
+
+/*! @brief Returns a shared immutable URL equal to the input URL.
+    @param URL The input URL.
+    @return An immutable URL equal to @c URL, which is the same instance for equal inputs while any
+        caller holds it.
+    @discussion Intended for issuers, endpoints and redirect URLs repeated across many
+        authorizations.
+ */
++ (nullable NSURL *)internedURL:(nullable NSURL *)URL;
+
 @end
 
 NS_ASSUME_NONNULL_END
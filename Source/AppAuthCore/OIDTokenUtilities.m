@@ -20,11 +20,72 @@
 
 #import <CommonCrypto/CommonDigest.h>
 
-/*! @brief String representing the set of characters that are allowed as is for the
-        application/x-www-form-urlencoded encoding algorithm.
+/*! @brief How each byte is written by the application/x-www-form-urlencoded encoding algorithm:
+        0 means percent encoded, 1 means written as is, and 2 means replaced by '+'.
  */
-static NSString *const kFormUrlEncodedAllowedCharacters =
-    @" *-._0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const uint8_t kFormUrlEncodedByteActions[256] = {
+  ['0' ... '9'] = 1, ['A' ... 'Z'] = 1, ['a' ... 'z'] = 1,
+  ['*'] = 1, ['-'] = 1, ['.'] = 1, ['_'] = 1, [' '] = 2,
+};
+
+/*! @brief Upper case hexadecimal digits used when percent encoding.
+ */
+static const char kHexDigits[] = "0123456789ABCDEF";
+
+/*! @brief Appends the application/x-www-form-urlencoded encoding of @c string to @c data.
+ */
+static void EkoOIDAppendFormUrlEncoded(NSMutableData *data, NSString *string) {
+  const uint8_t *bytes = (const uint8_t *)string.UTF8String;
+  size_t length = strlen((const char *)bytes);
+  NSUInteger offset = data.length;
+  // Reserves room for the worst case, where every byte is percent encoded.
+  data.length = offset + length * 3;
+  uint8_t *output = (uint8_t *)data.mutableBytes + offset;
+  uint8_t *cursor = output;
+  for (size_t i = 0; i < length; i++) {
+    uint8_t byte = bytes[i];
+    switch (kFormUrlEncodedByteActions[byte]) {
+      case 1:
+        *cursor++ = byte;
+        break;
+      case 2:
+        *cursor++ = '+';
+        break;
+      default:
+        cursor[0] = '%';
+        cursor[1] = kHexDigits[byte >> 4];
+        cursor[2] = kHexDigits[byte & 0xF];
+        cursor += 3;
+        break;
+    }
+  }
+  data.length = offset + (NSUInteger)(cursor - output);
+}
+
+/*! @brief The longest string, in UTF-16 code units, which is shared by
+        @c EkoOIDTokenUtilities.internedString:.
+ */
+static const NSUInteger kMaxInternedStringLength = 1024;
+
+/*! @brief Returns the shared instance equal to @c object, adding @c object if there is none.
+    @discussion The table holds its members weakly, so it only grows with the number of distinct
+        values which are still in use.
+ */
+static id EkoOIDInternedObject(id object) {
+  static NSHashTable *internedObjects;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    internedObjects = [NSHashTable weakObjectsHashTable];
+  });
+  @synchronized(internedObjects) {
+    id member = [internedObjects member:object];
+    if (member) {
+      return member;
+    }
+    [internedObjects addObject:object];
+    return object;
+  }
+}
 
 @implementation EkoOIDTokenUtilities
 
@@ -77,13 +138,43 @@ static NSString *const kFormUrlEncodedAllowedCharacters =
   if (inputString.length == 0) {
     return inputString;
   }
-  NSCharacterSet *allowedCharacters =
-      [NSCharacterSet characterSetWithCharactersInString:kFormUrlEncodedAllowedCharacters];
-  // Percent encode all characters not present in the provided set.
-  NSString *encodedString =
-      [inputString stringByAddingPercentEncodingWithAllowedCharacters:allowedCharacters];
-  // Replace occurences of space by '+' character
-  return [encodedString stringByReplacingOccurrencesOfString:@" " withString:@"+"];
+  NSMutableData *encodedData = [NSMutableData dataWithCapacity:inputString.length];
+  EkoOIDAppendFormUrlEncoded(encodedData, inputString);
+  return [[NSString alloc] initWithData:encodedData encoding:NSASCIIStringEncoding];
+}
+
++ (NSString *)basicAuthorizationHeaderValueWithClientID:(NSString *)clientID
+                                           clientSecret:(NSString *)clientSecret {
+  // The client id and secret are encoded using the "application/x-www-form-urlencoded"
+  // encoding algorithm per RFC 6749 Section 2.3.1, and written straight into one buffer.
+  // https://tools.ietf.org/html/rfc6749#section-2.3.1
+  NSMutableData *credentials =
+      [NSMutableData dataWithCapacity:clientID.length + clientSecret.length + 1];
+  EkoOIDAppendFormUrlEncoded(credentials, clientID);
+  [credentials appendBytes:":" length:1];
+  EkoOIDAppendFormUrlEncoded(credentials, clientSecret);
+
+  static const char kBasicPrefix[] = "Basic ";
+  NSMutableData *headerValue = [NSMutableData dataWithBytes:kBasicPrefix
+                                                     length:sizeof(kBasicPrefix) - 1];
+  [headerValue appendData:[credentials base64EncodedDataWithOptions:kNilOptions]];
+  return [[NSString alloc] initWithData:headerValue encoding:NSASCIIStringEncoding];
+}
+
++ (nullable NSString *)internedString:(nullable NSString *)string {
+  NSString *immutableString = [string copy];
+  if (!immutableString || immutableString.length > kMaxInternedStringLength) {
+    return immutableString;
+  }
+  return EkoOIDInternedObject(immutableString);
+}
+
++ (nullable NSURL *)internedURL:(nullable NSURL *)URL {
+  NSURL *immutableURL = [URL copy];
+  if (!immutableURL) {
+    return nil;
+  }
+  return EkoOIDInternedObject(immutableURL);
 }
 
 @end
@@ -23,8 +23,9 @@
 NS_ASSUME_NONNULL_BEGIN
 
 /*! @brief If set to YES, will force the iOS 7-only code for @c EkoOIDURLQueryComponent to be used,
-        even on non-iOS 7 devices and simulators. Useful for testing the iOS 7 code paths on the
-        simulator. Defaults to NO.
+        even on non-iOS 7 devices and simulators. Defaults to NO.
+    @remarks Encoding and decoding no longer depend on @c NSURLComponents, so all platforms share
+        a single code path and this flag has no effect. It is kept for source compatibility.
  */
 extern BOOL gEkoOIDURLQueryComponentForceIOS7Handling;
 
@@ -32,7 +33,8 @@ extern BOOL gEkoOIDURLQueryComponentForceIOS7Handling;
         application/x-www-form-urlencoded format.
     @description Supports application/x-www-form-urlencoded encoding and decoding, specifically
         '+' is replaced with space before percent decoding. For encoding, simply percent encodes
-        space, as this is valid application/x-www-form-urlencoded.
+        space, as this is valid application/x-www-form-urlencoded. Both directions use a
+        table-driven codec which makes a single pass over the UTF-8 bytes.
     @see https://tools.ietf.org/html/rfc6749#section-4.1.2
     @see https://tools.ietf.org/html/rfc6749#section-4.1.3
     @see https://tools.ietf.org/html/rfc6749#appendix-B
@@ -40,13 +42,14 @@ extern BOOL gEkoOIDURLQueryComponentForceIOS7Handling;
  */
 @interface EkoOIDURLQueryComponent : NSObject
 
-/*! @brief The parameter names in the query.
+/*! @brief The parameter names in the query, in the order they were first added.
  */
 @property(nonatomic, readonly) NSArray<NSString *> *parameters;
 
 /*! @brief The parameters represented as a dictionary.
     @remarks All values are @c NSString except for parameters which contain multiple values, in
-        which case the value is an @c NSArray<NSString *> *.
+        which case the value is an @c NSArray<NSString *> *. The dictionary is built on first
+        access and reused until another parameter is added.
  */
 @property(nonatomic, readonly) NSDictionary<NSString *, NSObject<NSCopying> *> *dictionaryValue;
 
@@ -55,6 +58,21 @@ extern BOOL gEkoOIDURLQueryComponentForceIOS7Handling;
  */
 - (nullable instancetype)initWithURL:(NSURL *)URL;
 
+/*! @brief Creates an @c EkoOIDURLQueryComponent from the response parameters in a redirect URL.
+    @param URL The redirect URL received from the authorization server.
+    @param responseInFragment Whether the response was returned in the fragment of the URL, as
+        with the implicit and hybrid flows, rather than in its query.
+    @discussion The URL is scanned once and each parameter is decoded in place. A response
+        returned in the query is read from the query alone, and the fragment is never decoded. A
+        response returned in the fragment is read from the fragment, and then from the query,
+        which only carries the parameters of the redirect URI itself; where a parameter appears in
+        both, the fragment takes precedence.
+    @see https://tools.ietf.org/html/rfc6749#section-4.1.2
+    @see https://tools.ietf.org/html/rfc6749#section-4.2.2
+ */
+- (nullable instancetype)initWithRedirectURL:(NSURL *)URL
+                          responseInFragment:(BOOL)responseInFragment;
+
 /*! @brief The value (or values) for a named parameter in the query.
     @param parameter The parameter name. Case sensitive.
     @return The value (or values) for a named parameter in the query.
@@ -69,6 +87,8 @@ extern BOOL gEkoOIDURLQueryComponentForceIOS7Handling;
 
 /*! @brief Adds multiple parameters with associated values to the query.
     @param parameters The parameter name value pairs to add to the query.
+    @discussion The parameters are added in order of their names, so that identical parameters
+        always produce an identical encoding.
  */
 - (void)addParameters:(NSDictionary<NSString *, NSString *> *)parameters;
 
@@ -78,15 +98,43 @@ extern BOOL gEkoOIDURLQueryComponentForceIOS7Handling;
 - (NSURL *)URLByReplacingQueryInURL:(NSURL *)URL;
 
 /*! @brief Builds an x-www-form-urlencoded string representing the parameters.
+    @discussion Parameters are encoded in the order they were added.
     @return The x-www-form-urlencoded string representing the parameters.
  */
 - (NSString *)URLEncodedParameters;
 
-/*! @brief A NSMutableCharacterSet containing allowed characters in URL parameter values (that is
+/*! @brief Appends the x-www-form-urlencoded parameters directly to a buffer, such as a request
+        body, without building intermediate strings.
+    @param data The buffer to append to. If it isn't empty, a '&' separator is written first.
+    @discussion Parameters are encoded in the order they were added.
+ */
+- (void)appendURLEncodedParametersToData:(NSMutableData *)data;
+
+/*! @brief Appends a single x-www-form-urlencoded name/value pair directly to a buffer.
+    @param parameter The name of the parameter.
+    @param value The value of the parameter.
+    @param data The buffer to append to. If it isn't empty, a '&' separator is written first.
+ */
++ (void)appendURLEncodedParameter:(NSString *)parameter
+                            value:(NSString *)value
+                           toData:(NSMutableData *)data;
+
+/*! @brief Appends x-www-form-urlencoded name/value pairs directly to a buffer.
+    @param parameters The parameter name value pairs to append.
+    @param data The buffer to append to. If it isn't empty, a '&' separator is written first.
+    @discussion The parameters are appended in order of their names, as with
+        @c EkoOIDURLQueryComponent.addParameters:.
+ */
++ (void)appendURLEncodedParameters:(NSDictionary<NSString *, NSString *> *)parameters
+                            toData:(NSMutableData *)data;
+
+/*! @brief A NSCharacterSet containing allowed characters in URL parameter values (that is
         the "value" part of "?key=value"). This has less allowed characters than
         @c URLQueryAllowedCharacterSet, as the query component includes both the key & value.
+    @discussion The set is built once and shared, so it is immutable; make a @c mutableCopy to
+        modify it.
  */
-+ (NSMutableCharacterSet *)URLParamValueAllowedCharacters;
++ (NSCharacterSet *)URLParamValueAllowedCharacters;
 
 @end
 
@@ -26,16 +26,196 @@ BOOL gEkoOIDURLQueryComponentForceIOS7Handling = NO;
  */
 static NSString *const kQueryStringParamAdditionalDisallowedCharacters = @"=&+";
 
+/*! @brief The number of parameters up to which lookups scan the parameters linearly. Larger
+        queries build an index of parameter positions.
+ */
+static const NSUInteger kLinearScanLimit = 8;
+
+/*! @brief Bytes which may appear unencoded in an application/x-www-form-urlencoded parameter
+        name or value. This is @c NSCharacterSet.URLQueryAllowedCharacterSet less the
+        characters in @c kQueryStringParamAdditionalDisallowedCharacters.
+ */
+static const uint8_t kParamValueAllowedBytes[256] = {
+  ['0' ... '9'] = 1, ['A' ... 'Z'] = 1, ['a' ... 'z'] = 1,
+  ['!'] = 1, ['$'] = 1, ['\''] = 1, ['('] = 1, [')'] = 1, ['*'] = 1, [','] = 1, ['-'] = 1,
+  ['.'] = 1, ['/'] = 1, [':'] = 1, [';'] = 1, ['?'] = 1, ['@'] = 1, ['_'] = 1, ['~'] = 1,
+};
+
+/*! @brief Upper case hexadecimal digits used when percent encoding.
+ */
+static const char kHexDigits[] = "0123456789ABCDEF";
+
+/*! @brief A 64-bit word with each byte set to 0x01, used for word-at-a-time byte comparisons.
+ */
+static const uint64_t kWordLowBits = 0x0101010101010101ULL;
+
+/*! @brief A 64-bit word with the high bit of each byte set.
+ */
+static const uint64_t kWordHighBits = 0x8080808080808080ULL;
+
+/*! @brief Flags the high bit of each byte in @c word which is strictly between @c low and @c high.
+    @discussion Bytes with their high bit set are never flagged.
+    @see https://graphics.stanford.edu/~seander/bithacks.html#HasBetweenInWord
+ */
+static inline uint64_t EkoOIDWordBytesBetween(uint64_t word, uint8_t low, uint8_t high) {
+  uint64_t masked = word & (kWordLowBits * 127);
+  return ((kWordLowBits * (127 + high) - masked) & ~word &
+          (masked + kWordLowBits * (127 - low))) & kWordHighBits;
+}
+
+/*! @brief Returns non-zero if any byte in @c word equals @c byte.
+    @see https://graphics.stanford.edu/~seander/bithacks.html#ValueInWord
+ */
+static inline uint64_t EkoOIDWordHasByte(uint64_t word, uint8_t byte) {
+  uint64_t difference = word ^ (kWordLowBits * byte);
+  return (difference - kWordLowBits) & ~difference & kWordHighBits;
+}
+
+/*! @brief Returns YES if all eight bytes starting at @c bytes are ASCII letters or digits, which
+        never need to be percent encoded.
+ */
+static inline BOOL EkoOIDIsAlphanumericWord(const uint8_t *bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+  uint64_t digits = EkoOIDWordBytesBetween(word, '0' - 1, '9' + 1);
+  // Setting 0x20 on every byte folds upper case letters into lower case.
+  uint64_t letters = EkoOIDWordBytesBetween(word | (kWordLowBits * 0x20), 'a' - 1, 'z' + 1);
+  return (digits | letters) == kWordHighBits;
+}
+
+/*! @brief Returns YES if any of the eight bytes starting at @c bytes need form decoding.
+ */
+static inline BOOL EkoOIDWordNeedsDecoding(const uint8_t *bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+  return (EkoOIDWordHasByte(word, '%') | EkoOIDWordHasByte(word, '+')) != 0;
+}
+
+/*! @brief Returns the value of a hexadecimal digit, or -1 if @c byte isn't one.
+ */
+static inline int EkoOIDHexDigitValue(uint8_t byte) {
+  if (byte >= '0' && byte <= '9') {
+    return byte - '0';
+  }
+  byte |= 0x20;
+  if (byte >= 'a' && byte <= 'f') {
+    return byte - 'a' + 10;
+  }
+  return -1;
+}
+
+/*! @brief Percent encodes @c length bytes from @c bytes into @c output in a single pass.
+    @param output A buffer with room for at least three times @c length bytes.
+    @return The number of bytes written to @c output.
+ */
+static size_t EkoOIDFormURLEncodeBytes(const uint8_t *bytes, size_t length, uint8_t *output) {
+  uint8_t *cursor = output;
+  size_t index = 0;
+  while (index < length) {
+    // Fast path: copies runs of alphanumeric characters eight bytes at a time.
+    while (index + sizeof(uint64_t) <= length && EkoOIDIsAlphanumericWord(bytes + index)) {
+      memcpy(cursor, bytes + index, sizeof(uint64_t));
+      cursor += sizeof(uint64_t);
+      index += sizeof(uint64_t);
+    }
+    if (index == length) {
+      break;
+    }
+    uint8_t byte = bytes[index++];
+    if (kParamValueAllowedBytes[byte]) {
+      *cursor++ = byte;
+    } else {
+      cursor[0] = '%';
+      cursor[1] = kHexDigits[byte >> 4];
+      cursor[2] = kHexDigits[byte & 0xF];
+      cursor += 3;
+    }
+  }
+  return (size_t)(cursor - output);
+}
+
+/*! @brief Decodes application/x-www-form-urlencoded bytes in place, replacing '+' with space and
+        percent decoding. Malformed percent escapes are left as-is.
+    @return The decoded length, which is never more than @c length.
+    @see https://url.spec.whatwg.org/#urlencoded-parsing
+ */
+static size_t EkoOIDFormURLDecodeBytesInPlace(uint8_t *bytes, size_t length) {
+  size_t read = 0;
+  size_t write = 0;
+  while (read < length) {
+    // Fast path: skips (or shifts, once something has been decoded) eight bytes at a time.
+    while (read + sizeof(uint64_t) <= length && !EkoOIDWordNeedsDecoding(bytes + read)) {
+      if (write != read) {
+        memmove(bytes + write, bytes + read, sizeof(uint64_t));
+      }
+      read += sizeof(uint64_t);
+      write += sizeof(uint64_t);
+    }
+    if (read == length) {
+      break;
+    }
+    uint8_t byte = bytes[read++];
+    if (byte == '+') {
+      byte = ' ';
+    } else if (byte == '%' && read + 1 < length) {
+      int high = EkoOIDHexDigitValue(bytes[read]);
+      int low = EkoOIDHexDigitValue(bytes[read + 1]);
+      if (high >= 0 && low >= 0) {
+        byte = (uint8_t)((high << 4) | low);
+        read += 2;
+      }
+    }
+    bytes[write++] = byte;
+  }
+  return write;
+}
+
+/*! @brief Appends the application/x-www-form-urlencoded encoding of @c string to @c data.
+ */
+static void EkoOIDAppendFormURLEncodedString(NSMutableData *data, NSString *string) {
+  const char *UTF8String = string.UTF8String;
+  size_t length = strlen(UTF8String);
+  NSUInteger offset = data.length;
+  // Reserves room for the worst case, where every byte is percent encoded.
+  data.length = offset + length * 3;
+  size_t encodedLength = EkoOIDFormURLEncodeBytes((const uint8_t *)UTF8String,
+                                                  length,
+                                                  (uint8_t *)data.mutableBytes + offset);
+  data.length = offset + encodedLength;
+}
+
+/*! @brief Returns the names of @c parameters in a stable order, as dictionary ordering is
+        unspecified and identical parameters should always produce an identical encoding.
+ */
+static NSArray<NSString *> *EkoOIDSortedParameterNames(
+    NSDictionary<NSString *, NSString *> *parameters) {
+  return [parameters.allKeys sortedArrayUsingSelector:@selector(compare:)];
+}
+
 @implementation EkoOIDURLQueryComponent {
-  /*! @brief A dictionary of parameter names and values representing the contents of the query.
+  /*! @brief The parameter names in insertion order. A name appears once for each of its values.
+   */
+  NSMutableArray<NSString *> *_names;
+
+  /*! @brief The parameter values, at the same positions as their names in @c _names.
+   */
+  NSMutableArray<NSString *> *_values;
+
+  /*! @brief The positions of each parameter name in @c _names. Only built once the query has more
+        than @c kLinearScanLimit parameters.
    */
-  NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *_parameters;
+  NSMutableDictionary<NSString *, NSMutableIndexSet *> *_index;
+
+  /*! @brief Cached result of @c dictionaryValue, cleared whenever a parameter is added.
+   */
+  NSDictionary<NSString *, NSObject<NSCopying> *> *_dictionaryValue;
 }
 
 - (nullable instancetype)init {
   self = [super init];
   if (self) {
-    _parameters = [NSMutableDictionary dictionary];
+    _names = [NSMutableArray array];
+    _values = [NSMutableArray array];
   }
   return self;
 }
@@ -43,156 +223,234 @@ static NSString *const kQueryStringParamAdditionalDisallowedCharacters = @"=&+";
 - (nullable instancetype)initWithURL:(NSURL *)URL {
   self = [self init];
   if (self) {
-    if (@available(iOS 8.0, macOS 10.10, *)) {
-      // If NSURLQueryItem is available, use it for deconstructing the new URL. (iOS 8+)
-      if (!gEkoOIDURLQueryComponentForceIOS7Handling) {
-        NSURLComponents *components =
-            [NSURLComponents componentsWithURL:URL resolvingAgainstBaseURL:NO];
-        // As OAuth uses application/x-www-form-urlencoded encoding, interprets '+' as a space
-        // in addition to regular percent decoding. https://url.spec.whatwg.org/#urlencoded-parsing
-        components.percentEncodedQuery =
-            [components.percentEncodedQuery stringByReplacingOccurrencesOfString:@"+"
-                                                                      withString:@"%20"];
-        // NB. @c queryItems are already percent decoded
-        NSArray<NSURLQueryItem *> *queryItems = components.queryItems;
-        for (NSURLQueryItem *queryItem in queryItems) {
-          [self addParameter:queryItem.name value:queryItem.value];
-        }
-        return self;
-      }
+    // NB. @c NSURL.query is still percent encoded, so it is decoded here in a single pass.
+    const char *query = URL.query.UTF8String;
+    if (query) {
+      NSMutableData *buffer = [NSMutableData dataWithBytes:query length:strlen(query)];
+      [self addParametersFromURLEncodedBytes:buffer.mutableBytes
+                                      length:buffer.length
+                     skipExistingParameters:NO];
     }
-    
-    // Fallback for iOS 7
-    NSString *query = URL.query;
-    // As OAuth uses application/x-www-form-urlencoded encoding, interprets '+' as a space
-    // in addition to regular percent decoding. https://url.spec.whatwg.org/#urlencoded-parsing
-    query = [query stringByReplacingOccurrencesOfString:@"+" withString:@"%20"];
-
-    NSArray<NSString *> *queryParts = [query componentsSeparatedByString:@"&"];
-    for (NSString *queryPart in queryParts) {
-      NSRange equalsRange = [queryPart rangeOfString:@"="];
-      if (equalsRange.location == NSNotFound) {
-        continue;
-      }
-      NSString *name = [queryPart substringToIndex:equalsRange.location];
-      name = name.stringByRemovingPercentEncoding;
-      NSString *value = [queryPart substringFromIndex:equalsRange.location + equalsRange.length];
-      value = value.stringByRemovingPercentEncoding;
-      [self addParameter:name value:value];
+  }
+  return self;
+}
+
+- (nullable instancetype)initWithRedirectURL:(NSURL *)URL
+                          responseInFragment:(BOOL)responseInFragment {
+  self = [self init];
+  if (self) {
+    const char *URLString = URL.absoluteString.UTF8String;
+    if (!URLString) {
+      return self;
+    }
+    // Copies the URL once, then locates the query and fragment and decodes them in place.
+    size_t length = strlen(URLString);
+    NSMutableData *buffer = [NSMutableData dataWithBytes:URLString length:length];
+    uint8_t *bytes = buffer.mutableBytes;
+    uint8_t *end = bytes + length;
+    uint8_t *fragment = memchr(bytes, '#', length);
+    uint8_t *queryEnd = fragment ? fragment : end;
+    uint8_t *query = memchr(bytes, '?', (size_t)(queryEnd - bytes));
+    if (responseInFragment && fragment) {
+      [self addParametersFromURLEncodedBytes:fragment + 1
+                                      length:(size_t)(end - fragment - 1)
+                     skipExistingParameters:NO];
+    }
+    if (query) {
+      [self addParametersFromURLEncodedBytes:query + 1
+                                      length:(size_t)(queryEnd - query - 1)
+                     skipExistingParameters:responseInFragment];
     }
-    return self;
   }
   return self;
 }
 
+/*! @brief Splits an application/x-www-form-urlencoded string into name/value pairs, decoding
+        each name and value in place, and adds them to the query.
+    @param bytes The encoded bytes, which are overwritten during decoding.
+    @param length The number of encoded bytes.
+    @param skipExistingParameters Whether pairs whose name is already in the query are ignored.
+    @see https://url.spec.whatwg.org/#urlencoded-parsing
+ */
+- (void)addParametersFromURLEncodedBytes:(uint8_t *)bytes
+                                  length:(size_t)length
+                  skipExistingParameters:(BOOL)skipExistingParameters {
+  uint8_t *end = bytes + length;
+  uint8_t *pair = bytes;
+  while (pair < end) {
+    uint8_t *pairEnd = memchr(pair, '&', (size_t)(end - pair));
+    if (!pairEnd) {
+      pairEnd = end;
+    }
+    if (pairEnd > pair) {
+      uint8_t *nameEnd = memchr(pair, '=', (size_t)(pairEnd - pair));
+      uint8_t *valueStart = nameEnd ? nameEnd + 1 : pairEnd;
+      if (!nameEnd) {
+        nameEnd = pairEnd;
+      }
+      size_t nameLength = EkoOIDFormURLDecodeBytesInPlace(pair, (size_t)(nameEnd - pair));
+      size_t valueLength =
+          EkoOIDFormURLDecodeBytesInPlace(valueStart, (size_t)(pairEnd - valueStart));
+      NSString *name = [[NSString alloc] initWithBytes:pair
+                                                length:nameLength
+                                              encoding:NSUTF8StringEncoding];
+      NSString *value = [[NSString alloc] initWithBytes:valueStart
+                                                 length:valueLength
+                                               encoding:NSUTF8StringEncoding];
+      // Pairs which don't decode to valid UTF-8 are dropped.
+      if (name && value && !(skipExistingParameters && [self hasParameter:name])) {
+        [self addParameter:name value:value];
+      }
+    }
+    if (pairEnd == end) {
+      break;
+    }
+    pair = pairEnd + 1;
+  }
+}
+
 - (NSArray<NSString *> *)parameters {
-  return _parameters.allKeys;
+  return [NSOrderedSet orderedSetWithArray:_names].array;
 }
 
 - (NSDictionary<NSString *, NSObject<NSCopying> *> *)dictionaryValue {
-  // This method will flatten arrays in our @c _parameters' values if only one value exists.
-  NSMutableDictionary<NSString *, NSObject<NSCopying> *> *values = [NSMutableDictionary dictionary];
-  for (NSString *parameter in _parameters.allKeys) {
-    NSArray<NSString *> *value = _parameters[parameter];
-    if (value.count == 1) {
-      values[parameter] = [value.firstObject copy];
+  if (_dictionaryValue) {
+    return _dictionaryValue;
+  }
+  // Parameters with a single value map to that value, others to an array of all their values.
+  NSUInteger count = _names.count;
+  NSMutableDictionary<NSString *, NSObject<NSCopying> *> *values =
+      [NSMutableDictionary dictionaryWithCapacity:count];
+  NSMutableArray<NSString *> *multiValuedParameters;
+  for (NSUInteger i = 0; i < count; i++) {
+    NSString *parameter = _names[i];
+    NSObject<NSCopying> *existingValue = values[parameter];
+    if (!existingValue) {
+      values[parameter] = _values[i];
+    } else if ([existingValue isKindOfClass:[NSMutableArray class]]) {
+      [(NSMutableArray<NSString *> *)existingValue addObject:_values[i]];
     } else {
-      values[parameter] = [value copy];
+      values[parameter] = [NSMutableArray arrayWithObjects:existingValue, _values[i], nil];
+      if (!multiValuedParameters) {
+        multiValuedParameters = [NSMutableArray array];
+      }
+      [multiValuedParameters addObject:parameter];
     }
   }
-  return values;
+  // The result is shared between callers, so must not contain mutable arrays.
+  for (NSString *parameter in multiValuedParameters) {
+    values[parameter] = [values[parameter] copy];
+  }
+  _dictionaryValue = [values copy];
+  return _dictionaryValue;
+}
+
+/*! @brief Whether the query contains at least one value for a parameter.
+    @param parameter The parameter name. Case sensitive.
+ */
+- (BOOL)hasParameter:(NSString *)parameter {
+  if (_index) {
+    return _index[parameter] != nil;
+  }
+  return [_names containsObject:parameter];
 }
 
 - (NSArray<NSString *> *)valuesForParameter:(NSString *)parameter {
-  return _parameters[parameter];
+  if (_index) {
+    NSIndexSet *positions = _index[parameter];
+    return positions ? [_values objectsAtIndexes:positions] : nil;
+  }
+  NSMutableArray<NSString *> *values;
+  NSUInteger count = _names.count;
+  for (NSUInteger i = 0; i < count; i++) {
+    if ([_names[i] isEqualToString:parameter]) {
+      if (!values) {
+        values = [NSMutableArray array];
+      }
+      [values addObject:_values[i]];
+    }
+  }
+  return values;
 }
 
 - (void)addParameter:(NSString *)parameter value:(NSString *)value {
-  NSMutableArray<NSString *> *parameterValues = _parameters[parameter];
-  if (!parameterValues) {
-    parameterValues = [NSMutableArray array];
-    _parameters[parameter] = parameterValues;
+  [_names addObject:[parameter copy]];
+  [_values addObject:[value copy]];
+  _dictionaryValue = nil;
+
+  NSUInteger count = _names.count;
+  if (_index) {
+    [self indexParameterAtPosition:count - 1];
+  } else if (count > kLinearScanLimit) {
+    _index = [NSMutableDictionary dictionaryWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+      [self indexParameterAtPosition:i];
+    }
   }
-  [parameterValues addObject:value];
 }
 
-- (void)addParameters:(NSDictionary<NSString *, NSString *> *)parameters {
-  for (NSString *parameterName in parameters.allKeys) {
-    [self addParameter:parameterName value:parameters[parameterName]];
+/*! @brief Records the position of a parameter in @c _index.
+    @param position The position of the parameter in @c _names.
+ */
+- (void)indexParameterAtPosition:(NSUInteger)position {
+  NSString *parameter = _names[position];
+  NSMutableIndexSet *positions = _index[parameter];
+  if (!positions) {
+    positions = [NSMutableIndexSet indexSet];
+    _index[parameter] = positions;
   }
+  [positions addIndex:position];
 }
 
-/*! @brief Builds a query items array that can be set to @c NSURLComponents.queryItems
-    @discussion The parameter names and values are NOT URL encoded.
-    @return An array of unencoded @c NSURLQueryItem objects.
- */
-- (NSMutableArray<NSURLQueryItem *> *)queryItems NS_AVAILABLE(10.10, 8.0) {
-  NSMutableArray<NSURLQueryItem *> *queryParameters = [NSMutableArray array];
-  for (NSString *parameterName in _parameters.allKeys) {
-    NSArray<NSString *> *values = _parameters[parameterName];
-    for (NSString *value in values) {
-      NSURLQueryItem *item = [NSURLQueryItem queryItemWithName:parameterName value:value];
-      [queryParameters addObject:item];
-    }
+- (void)addParameters:(NSDictionary<NSString *, NSString *> *)parameters {
+  for (NSString *parameterName in EkoOIDSortedParameterNames(parameters)) {
+    [self addParameter:parameterName value:parameters[parameterName]];
   }
-  return queryParameters;
 }
 
-+ (NSMutableCharacterSet *)URLParamValueAllowedCharacters {
-  // Starts with the standard URL-allowed character set.
-  NSMutableCharacterSet *allowedParamCharacters =
-      [[NSCharacterSet URLQueryAllowedCharacterSet] mutableCopy];
-  // Removes additional characters we don't want to see in the query component.
-  [allowedParamCharacters removeCharactersInString:kQueryStringParamAdditionalDisallowedCharacters];
++ (NSCharacterSet *)URLParamValueAllowedCharacters {
+  static NSCharacterSet *allowedParamCharacters;
+  static dispatch_once_t once;
+  dispatch_once(&once, ^{
+    // Starts with the standard URL-allowed character set.
+    NSMutableCharacterSet *characters = [[NSCharacterSet URLQueryAllowedCharacterSet] mutableCopy];
+    // Removes additional characters we don't want to see in the query component.
+    [characters removeCharactersInString:kQueryStringParamAdditionalDisallowedCharacters];
+    allowedParamCharacters = [characters copy];
+  });
   return allowedParamCharacters;
 }
 
-/*! @brief Builds a query string that can be set to @c NSURLComponents.percentEncodedQuery
-    @discussion This string is percent encoded, and shouldn't be used with
-        @c NSURLComponents.query.
-    @return An percentage encoded query string.
- */
-- (NSString *)percentEncodedQueryString {
-  NSMutableArray<NSString *> *parameterizedValues = [NSMutableArray array];
-
-  // Starts with the standard URL-allowed character set.
-  NSMutableCharacterSet *allowedParamCharacters = [[self class] URLParamValueAllowedCharacters];
-
-  for (NSString *parameterName in _parameters.allKeys) {
-    NSString *encodedParameterName =
-        [parameterName stringByAddingPercentEncodingWithAllowedCharacters:allowedParamCharacters];
-
-    NSArray<NSString *> *values = _parameters[parameterName];
-    for (NSString *value in values) {
-      NSString *encodedValue =
-          [value stringByAddingPercentEncodingWithAllowedCharacters:allowedParamCharacters];
-      NSString *parameterizedValue =
-          [NSString stringWithFormat:@"%@=%@", encodedParameterName, encodedValue];
-      [parameterizedValues addObject:parameterizedValue];
-    }
++ (void)appendURLEncodedParameter:(NSString *)parameter
+                            value:(NSString *)value
+                           toData:(NSMutableData *)data {
+  if (data.length) {
+    [data appendBytes:"&" length:1];
   }
+  EkoOIDAppendFormURLEncodedString(data, parameter);
+  [data appendBytes:"=" length:1];
+  EkoOIDAppendFormURLEncodedString(data, value);
+}
 
-  NSString *queryString = [parameterizedValues componentsJoinedByString:@"&"];
-  return queryString;
++ (void)appendURLEncodedParameters:(NSDictionary<NSString *, NSString *> *)parameters
+                            toData:(NSMutableData *)data {
+  for (NSString *parameterName in EkoOIDSortedParameterNames(parameters)) {
+    [self appendURLEncodedParameter:parameterName value:parameters[parameterName] toData:data];
+  }
 }
 
-- (NSString *)URLEncodedParameters {
-  // If NSURLQueryItem is available, uses it for constructing the encoded parameters. (iOS 8+)
-  if (@available(iOS 8.0, macOS 10.10, *)) {
-    if (!gEkoOIDURLQueryComponentForceIOS7Handling) {
-      NSURLComponents *components = [[NSURLComponents alloc] init];
-      components.queryItems = [self queryItems];
-      NSString *encodedQuery = components.percentEncodedQuery;
-      // NSURLComponents.percentEncodedQuery creates a validly escaped URL query component, but
-      // doesn't encode the '+' leading to potential ambiguity with application/x-www-form-urlencoded
-      // encoding. Percent encodes '+' to avoid this ambiguity.
-      encodedQuery = [encodedQuery stringByReplacingOccurrencesOfString:@"+" withString:@"%2B"];
-      return encodedQuery;
-    }
+- (void)appendURLEncodedParametersToData:(NSMutableData *)data {
+  NSUInteger count = _names.count;
+  for (NSUInteger i = 0; i < count; i++) {
+    [[self class] appendURLEncodedParameter:_names[i] value:_values[i] toData:data];
   }
+}
 
-  // else, falls back to building query string manually (iOS 7)
-  return [self percentEncodedQueryString];
+- (NSString *)URLEncodedParameters {
+  NSMutableData *encodedParameters = [NSMutableData data];
+  [self appendURLEncodedParametersToData:encodedParameters];
+  // The encoded output is pure ASCII.
+  return [[NSString alloc] initWithData:encodedParameters encoding:NSASCIIStringEncoding];
 }
 
 - (NSURL *)URLByReplacingQueryInURL:(NSURL *)URL {
@@ -213,7 +471,7 @@ static NSString *const kQueryStringParamAdditionalDisallowedCharacters = @"=&+";
   return [NSString stringWithFormat:@"<%@: %p, parameters: %@>",
                                     NSStringFromClass([self class]),
                                     (void *)self,
-                                    _parameters];
+                                    self.dictionaryValue];
 }
 
 @end
@@ -103,7 +103,7 @@ NS_ASSUME_NONNULL_BEGIN
 + (EkoOIDCustomBrowserURLTransformation)URLTransformationSchemeConcatPrefix:(NSString *)URLprefix {
   EkoOIDCustomBrowserURLTransformation transform = ^NSURL *(NSURL *requestURL) {
     NSString *requestURLString = [requestURL absoluteString];
-    NSMutableCharacterSet *allowedParamCharacters =
+    NSCharacterSet *allowedParamCharacters =
         [EkoOIDURLQueryComponent URLParamValueAllowedCharacters];
     NSString *encodedUrl = [requestURLString stringByAddingPercentEncodingWithAllowedCharacters:allowedParamCharacters];
     NSString *newURL = [NSString stringWithFormat:@"%@%@", URLprefix, encodedUrl];
@@ -30,6 +30,7 @@ FOUNDATION_EXPORT const unsigned char AppAuthCoreVersionString[];
 #import <AppAuthCore/EkoOIDAuthorizationRequest.h>
 #import <AppAuthCore/EkoOIDAuthorizationResponse.h>
 #import <AppAuthCore/EkoOIDAuthorizationService.h>
+#import <AppAuthCore/EkoOIDClientCredentialsTokenManager.h>
 #import <AppAuthCore/EkoOIDError.h>
 #import <AppAuthCore/EkoOIDErrorUtilities.h>
 #import <AppAuthCore/EkoOIDExternalUserAgent.h>
@@ -37,14 +38,19 @@ FOUNDATION_EXPORT const unsigned char AppAuthCoreVersionString[];
 #import <AppAuthCore/EkoOIDExternalUserAgentSession.h>
 #import <AppAuthCore/EkoOIDGrantTypes.h>
 #import <AppAuthCore/EkoOIDIDToken.h>
+#import <AppAuthCore/EkoOIDIntrospectionRequest.h>
+#import <AppAuthCore/EkoOIDIntrospectionResponse.h>
 #import <AppAuthCore/EkoOIDRegistrationRequest.h>
 #import <AppAuthCore/EkoOIDRegistrationResponse.h>
 #import <AppAuthCore/EkoOIDResponseTypes.h>
+#import <AppAuthCore/EkoOIDRevocationRequest.h>
 #import <AppAuthCore/EkoOIDScopes.h>
+#import <AppAuthCore/EkoOIDScopeSet.h>
 #import <AppAuthCore/EkoOIDScopeUtilities.h>
 #import <AppAuthCore/EkoOIDServiceConfiguration.h>
 #import <AppAuthCore/EkoOIDServiceDiscovery.h>
 #import <AppAuthCore/EkoOIDTokenRequest.h>
+#import <AppAuthCore/EkoOIDTokenIntrospector.h>
 #import <AppAuthCore/EkoOIDTokenResponse.h>
 #import <AppAuthCore/EkoOIDTokenUtilities.h>
 #import <AppAuthCore/EkoOIDURLSessionProvider.h>
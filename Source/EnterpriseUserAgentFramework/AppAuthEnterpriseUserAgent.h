@@ -30,6 +30,7 @@ FOUNDATION_EXPORT const unsigned char AppAuthEnterpriseUserAgentEnterpriseUserAg
 #import <AppAuthEnterpriseUserAgent/EkoOIDAuthorizationRequest.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDAuthorizationResponse.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDAuthorizationService.h>
+#import <AppAuthEnterpriseUserAgent/EkoOIDClientCredentialsTokenManager.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDError.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDErrorUtilities.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDExternalUserAgent.h>
@@ -37,14 +38,19 @@ FOUNDATION_EXPORT const unsigned char AppAuthEnterpriseUserAgentEnterpriseUserAg
 #import <AppAuthEnterpriseUserAgent/EkoOIDExternalUserAgentSession.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDGrantTypes.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDIDToken.h>
+#import <AppAuthEnterpriseUserAgent/EkoOIDIntrospectionRequest.h>
+#import <AppAuthEnterpriseUserAgent/EkoOIDIntrospectionResponse.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDRegistrationRequest.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDRegistrationResponse.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDResponseTypes.h>
+#import <AppAuthEnterpriseUserAgent/EkoOIDRevocationRequest.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDScopes.h>
+#import <AppAuthEnterpriseUserAgent/EkoOIDScopeSet.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDScopeUtilities.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDServiceConfiguration.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDServiceDiscovery.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDTokenRequest.h>
+#import <AppAuthEnterpriseUserAgent/EkoOIDTokenIntrospector.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDTokenResponse.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDTokenUtilities.h>
 #import <AppAuthEnterpriseUserAgent/EkoOIDURLSessionProvider.h>
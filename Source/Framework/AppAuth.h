@@ -30,6 +30,7 @@ FOUNDATION_EXPORT const unsigned char AppAuthVersionString[];
 #import <AppAuth/OIDAuthorizationRequest.h>
 #import <AppAuth/OIDAuthorizationResponse.h>
 #import <AppAuth/OIDAuthorizationService.h>
+#import <AppAuth/OIDClientCredentialsTokenManager.h>
 #import <AppAuth/OIDError.h>
 #import <AppAuth/OIDErrorUtilities.h>
 #import <AppAuth/OIDExternalUserAgent.h>
@@ -37,14 +38,19 @@ FOUNDATION_EXPORT const unsigned char AppAuthVersionString[];
 #import <AppAuth/OIDExternalUserAgentSession.h>
 #import <AppAuth/OIDGrantTypes.h>
 #import <AppAuth/OIDIDToken.h>
+#import <AppAuth/OIDIntrospectionRequest.h>
+#import <AppAuth/OIDIntrospectionResponse.h>
 #import <AppAuth/OIDRegistrationRequest.h>
 #import <AppAuth/OIDRegistrationResponse.h>
 #import <AppAuth/OIDResponseTypes.h>
+#import <AppAuth/OIDRevocationRequest.h>
 #import <AppAuth/OIDScopes.h>
+#import <AppAuth/OIDScopeSet.h>
 #import <AppAuth/OIDScopeUtilities.h>
 #import <AppAuth/OIDServiceConfiguration.h>
 #import <AppAuth/OIDServiceDiscovery.h>
 #import <AppAuth/OIDTokenRequest.h>
+#import <AppAuth/OIDTokenIntrospector.h>
 #import <AppAuth/OIDTokenResponse.h>
 #import <AppAuth/OIDTokenUtilities.h>
 #import <AppAuth/OIDURLSessionProvider.h>
@@ -20,6 +20,7 @@
 
 #import "OIDAuthorizationResponseTests.h"
 #import "OIDRegistrationResponseTests.h"
+#import "OIDTestURLProtocol.h"
 #import "OIDTokenResponseTests.h"
 
 #if SWIFT_PACKAGE
@@ -28,8 +29,12 @@
 #import "Source/AppAuthCore/OIDAuthState.h"
 #import "Source/AppAuthCore/OIDAuthorizationResponse.h"
 #import "Source/AppAuthCore/OIDErrorUtilities.h"
+#import "Source/AppAuthCore/OIDGrantTypes.h"
 #import "Source/AppAuthCore/OIDRegistrationResponse.h"
+#import "Source/AppAuthCore/OIDScopeSet.h"
+#import "Source/AppAuthCore/OIDTokenRequest.h"
 #import "Source/AppAuthCore/OIDTokenResponse.h"
+#import "Source/AppAuthCore/OIDURLSessionProvider.h"
 #endif
 
 #import "OIDTokenRequestTests.h"
@@ -126,6 +131,8 @@
   _didChangeStateExpectation = nil;
   _didEncounterAuthorizationErrorExpectation = nil;
   _didEncounterTransientErrorExpectation = nil;
+  [EkoOIDURLSessionProvider setSession:[NSURLSession sharedSession]];
+  [OIDTestURLProtocol removeHandler];
 
   [super tearDown];
 }
@@ -435,6 +442,266 @@
   XCTAssertEqual([authState isTokenFresh], YES, @"");
 }
 
+/*! @brief Tests that compaction drops the code exchange history but keeps the tokens and the
+        ability to refresh them.
+ */
+- (void)testCompactHistory {
+  EkoOIDAuthState *authState = [[self class] testInstance];
+  EkoOIDTokenRequest *expectedRefreshRequest = [authState tokenRefreshRequest];
+  NSString *accessToken = authState.lastTokenResponse.accessToken;
+  NSDate *expirationDate = authState.lastTokenResponse.accessTokenExpirationDate;
+  BOOL isTokenFresh = [authState isTokenFresh];
+  NSUInteger archivedLength = [NSKeyedArchiver archivedDataWithRootObject:authState].length;
+
+  authState.compactsHistory = YES;
+
+  // The compacted state archives smaller, as it no longer holds the dropped parameters.
+  NSUInteger compactArchivedLength =
+      [NSKeyedArchiver archivedDataWithRootObject:authState].length;
+  XCTAssertLessThan(compactArchivedLength, archivedLength, @"");
+
+  EkoOIDAuthorizationRequest *request = authState.lastAuthorizationResponse.request;
+  XCTAssertNil(request.codeVerifier, @"");
+  XCTAssertNil(request.state, @"");
+  XCTAssertNil(request.nonce, @"");
+  XCTAssertNil(authState.lastAuthorizationResponse.authorizationCode, @"");
+  XCTAssertNil(authState.lastTokenResponse.request.codeVerifier, @"");
+  XCTAssertNil(authState.lastTokenResponse.request.authorizationCode, @"");
+  XCTAssertEqualObjects(authState.lastTokenResponse.accessToken, accessToken, @"");
+  XCTAssertLessThanOrEqual(
+      [authState.lastTokenResponse.accessTokenExpirationDate timeIntervalSinceDate:expirationDate],
+      0, @"");
+  XCTAssertEqual([authState isTokenFresh], isTokenFresh, @"");
+
+  EkoOIDTokenRequest *refreshRequest = [authState tokenRefreshRequest];
+  XCTAssertEqualObjects(refreshRequest.URLRequest.HTTPBody,
+                        expectedRefreshRequest.URLRequest.HTTPBody, @"");
+  XCTAssertEqualObjects(refreshRequest.URLRequest.allHTTPHeaderFields,
+                        expectedRefreshRequest.URLRequest.allHTTPHeaderFields, @"");
+
+  // Compacting again keeps the compacted responses.
+  EkoOIDAuthorizationResponse *compactAuthorizationResponse = authState.lastAuthorizationResponse;
+  [authState compactHistory];
+  XCTAssertEqual(authState.lastAuthorizationResponse, compactAuthorizationResponse, @"");
+}
+
+/*! @brief Tests that compaction notifies the state change delegate, so that the compacted state is
+        saved, and doesn't notify it again when there is nothing left to compact.
+ */
+- (void)testCompactHistoryChangesState {
+  EkoOIDAuthState *authState = [[self class] testInstance];
+  authState.stateChangeDelegate = self;
+
+  _didChangeStateExpectation = [self expectationWithDescription:
+      @"OIDAuthStateChangeDelegate.didChangeState: should be called on compaction."];
+  authState.compactsHistory = YES;
+  [self waitForExpectationsWithTimeout:2 handler:nil];
+
+  // Nothing is left to compact, so didChangeState: asserts if it is called.
+  _didChangeStateExpectation = nil;
+  [authState compactHistory];
+  authState.compactsHistory = YES;
+}
+
+/*! @brief Tests that scope checks compare against the latest granted scope.
+ */
+- (void)testIsAuthorizedForScopeSet {
+  EkoOIDAuthState *authState = [[self class] testInstance];
+  EkoOIDScopeSet *grantedScopes = [EkoOIDScopeSet scopeSetWithString:authState.scope];
+  XCTAssertEqual(authState.scopeSet, grantedScopes, @"");
+  XCTAssertTrue([authState isAuthorizedForScopeSet:grantedScopes], @"");
+  XCTAssertTrue([authState isAuthorizedForScopeSet:[EkoOIDScopeSet emptyScopeSet]], @"");
+
+  EkoOIDScopeSet *moreScopes = [grantedScopes
+      scopeSetByAddingScopeSet:[EkoOIDScopeSet scopeSetWithString:@"OIDAuthStateTests-scope"]];
+  XCTAssertFalse([authState isAuthorizedForScopeSet:moreScopes], @"");
+}
+
+/*! @brief Tests that a token for a resource can't be fetched without a refresh token.
+ */
+- (void)testFreshTokensForResourceWithoutRefreshToken {
+  XCTestExpectation *expectation =
+      [self expectationWithDescription:@"The action should be called with an error."];
+  EkoOIDAuthState *authState = [[EkoOIDAuthState alloc]
+      initWithAuthorizationResponse:[OIDAuthorizationResponseTests testInstanceCodeFlow]];
+  [authState performActionWithFreshTokens:^(NSString *_Nullable accessToken,
+                                            NSString *_Nullable idToken,
+                                            NSError *_Nullable error) {
+    XCTAssertNil(accessToken, @"");
+    XCTAssertEqual(error.code, EkoOIDErrorCodeTokenRefreshError, @"");
+    [expectation fulfill];
+  }
+                              forResource:@"https://api.example.com/"
+                                 scopeSet:[EkoOIDScopeSet scopeSetWithString:@"read"]
+                            dispatchQueue:dispatch_get_main_queue()];
+  [self waitForExpectationsWithTimeout:2 handler:nil];
+}
+
+/*! @brief Stubs the token endpoint with one which issues a new access token for each request,
+        numbered from 1, and records the bodies of the requests in @c bodies.
+ */
+- (void)stubTokenEndpointRecordingBodies:(NSMutableArray<NSString *> *)bodies {
+  [EkoOIDURLSessionProvider setSession:[OIDTestURLProtocol
+      sessionWithHandler:^id(NSURLRequest *request, NSString *body, NSInteger *statusCode) {
+        NSUInteger count;
+        @synchronized(bodies) {
+          [bodies addObject:body];
+          count = bodies.count;
+        }
+        return @{
+          @"access_token" : [NSString stringWithFormat:@"access token %lu", (unsigned long)count],
+          @"token_type" : @"Bearer",
+          @"expires_in" : @3600,
+        };
+      }
+           responseDelay:0]];
+}
+
+/*! @brief Requests fresh tokens for a resource and scope set @c count times before waiting for any
+        of them, and returns the access tokens the actions were called with, in the order they
+        were called.
+ */
+- (NSArray<NSString *> *)freshTokensFromAuthState:(EkoOIDAuthState *)authState
+                                      forResource:(NSString *)resource
+                                         scopeSet:(EkoOIDScopeSet *)scopeSet
+                                            count:(NSUInteger)count {
+  NSMutableArray<NSString *> *accessTokens = [NSMutableArray array];
+  for (NSUInteger i = 0; i < count; i++) {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Action called."];
+    [authState performActionWithFreshTokens:^(NSString *_Nullable accessToken,
+                                              NSString *_Nullable idToken,
+                                              NSError *_Nullable error) {
+      XCTAssertNil(error, @"");
+      [accessTokens addObject:accessToken ?: @""];
+      [expectation fulfill];
+    }
+                                forResource:resource
+                                   scopeSet:scopeSet
+                              dispatchQueue:dispatch_get_main_queue()];
+  }
+  [self waitForExpectationsWithTimeout:2 handler:nil];
+  return accessTokens;
+}
+
+/*! @brief Tests that a token for a resource is requested with the resource and scope, and is then
+        served from the cache without another request, while other audiences get their own.
+ */
+- (void)testFreshTokensForResourceAreCached {
+  NSMutableArray<NSString *> *bodies = [NSMutableArray array];
+  [self stubTokenEndpointRecordingBodies:bodies];
+  EkoOIDAuthState *authState = [[self class] testInstance];
+  NSString *stateAccessToken = authState.accessToken;
+  EkoOIDScopeSet *scopeSet = [EkoOIDScopeSet scopeSetWithString:@"read"];
+
+  NSArray<NSString *> *accessTokens = [self freshTokensFromAuthState:authState
+                                                         forResource:@"https://api.example.com/"
+                                                            scopeSet:scopeSet
+                                                               count:1];
+  XCTAssertEqualObjects(accessTokens, @[ @"access token 1" ], @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)1, @"");
+  XCTAssertTrue([bodies.firstObject containsString:@"resource=https"], @"%@", bodies.firstObject);
+  XCTAssertTrue([bodies.firstObject containsString:@"scope=read"], @"%@", bodies.firstObject);
+  // the state's own access token is kept
+  XCTAssertEqualObjects(authState.accessToken, stateAccessToken, @"");
+
+  accessTokens = [self freshTokensFromAuthState:authState
+                                    forResource:@"https://api.example.com/"
+                                       scopeSet:scopeSet
+                                          count:1];
+  XCTAssertEqualObjects(accessTokens, @[ @"access token 1" ], @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)1, @"");
+
+  accessTokens = [self freshTokensFromAuthState:authState
+                                    forResource:@"https://other.example.com/"
+                                       scopeSet:scopeSet
+                                          count:1];
+  XCTAssertEqualObjects(accessTokens, @[ @"access token 2" ], @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)2, @"");
+}
+
+/*! @brief Tests that callers asking for the same resource and scope while its token is being
+        refreshed share a single refresh.
+ */
+- (void)testConcurrentFreshTokensForResourceShareRefresh {
+  NSMutableArray<NSString *> *bodies = [NSMutableArray array];
+  [self stubTokenEndpointRecordingBodies:bodies];
+  EkoOIDAuthState *authState = [[self class] testInstance];
+
+  NSArray<NSString *> *accessTokens =
+      [self freshTokensFromAuthState:authState
+                         forResource:@"https://api.example.com/"
+                            scopeSet:[EkoOIDScopeSet scopeSetWithString:@"read"]
+                               count:3];
+  XCTAssertEqualObjects(accessTokens,
+                        (@[ @"access token 1", @"access token 1", @"access token 1" ]), @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)1, @"");
+}
+
+/*! @brief Tests that @c setNeedsTokenRefresh discards the tokens cached for resources, so that the
+        next caller gets a new one.
+ */
+- (void)testSetNeedsTokenRefreshDiscardsResourceTokens {
+  NSMutableArray<NSString *> *bodies = [NSMutableArray array];
+  [self stubTokenEndpointRecordingBodies:bodies];
+  EkoOIDAuthState *authState = [[self class] testInstance];
+  EkoOIDScopeSet *scopeSet = [EkoOIDScopeSet scopeSetWithString:@"read"];
+
+  NSArray<NSString *> *accessTokens = [self freshTokensFromAuthState:authState
+                                                         forResource:@"https://api.example.com/"
+                                                            scopeSet:scopeSet
+                                                               count:1];
+  XCTAssertEqualObjects(accessTokens, @[ @"access token 1" ], @"");
+
+  [authState setNeedsTokenRefresh];
+  accessTokens = [self freshTokensFromAuthState:authState
+                                    forResource:@"https://api.example.com/"
+                                       scopeSet:scopeSet
+                                          count:1];
+  XCTAssertEqualObjects(accessTokens, @[ @"access token 2" ], @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)2, @"");
+}
+
+/*! @brief Tests that refresh requests built from the cached template encode the same URL request
+        as an equivalent token request.
+ */
+- (void)testTokenRefreshRequestMatchesTokenRequest {
+  EkoOIDAuthState *authState = [[self class] testInstance];
+  NSDictionary<NSString *, NSString *> *additionalParameters = @{ @"resource": @"a b&c" };
+  EkoOIDTokenRequest *refreshRequest =
+      [authState tokenRefreshRequestWithAdditionalParameters:additionalParameters];
+  EkoOIDAuthorizationRequest *authorizationRequest = authState.lastAuthorizationResponse.request;
+  EkoOIDTokenRequest *expectedRequest =
+      [[EkoOIDTokenRequest alloc] initWithConfiguration:authorizationRequest.configuration
+                                              grantType:EkoOIDGrantTypeRefreshToken
+                                      authorizationCode:nil
+                                            redirectURL:nil
+                                               clientID:authorizationRequest.clientID
+                                           clientSecret:authorizationRequest.clientSecret
+                                                  scope:nil
+                                           refreshToken:authState.refreshToken
+                                           codeVerifier:nil
+                                   additionalParameters:additionalParameters];
+
+  NSURLRequest *URLRequest = refreshRequest.URLRequest;
+  NSURLRequest *expectedURLRequest = expectedRequest.URLRequest;
+  XCTAssertEqualObjects(URLRequest.URL, expectedURLRequest.URL, @"");
+  XCTAssertEqualObjects(URLRequest.HTTPMethod, expectedURLRequest.HTTPMethod, @"");
+  XCTAssertEqualObjects(URLRequest.allHTTPHeaderFields, expectedURLRequest.allHTTPHeaderFields,
+                        @"");
+  XCTAssertEqualObjects(URLRequest.HTTPBody, expectedURLRequest.HTTPBody, @"");
+
+  // A second refresh reuses the template but encodes the current refresh token.
+  XCTAssertEqualObjects(
+      [authState tokenRefreshRequestWithAdditionalParameters:additionalParameters]
+          .URLRequest.HTTPBody,
+      expectedURLRequest.HTTPBody, @"");
+
+  // Archived refresh requests are plain token requests.
+  NSData *data = [NSKeyedArchiver archivedDataWithRootObject:refreshRequest];
+  id unarchivedRequest = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+  XCTAssertEqualObjects([unarchivedRequest class], [EkoOIDTokenRequest class], @"");
+}
+
 @end
 
 #pragma GCC diagnostic pop
@@ -0,0 +1,236 @@
+/*! @file OIDClientCredentialsTokenManagerTests.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "OIDServiceConfigurationTests.h"
+#import "OIDTestURLProtocol.h"
+
+#if SWIFT_PACKAGE
+@import AppAuthCore;
+#else
+#import "Source/AppAuthCore/OIDClientCredentialsTokenManager.h"
+#import "Source/AppAuthCore/OIDScopeSet.h"
+#import "Source/AppAuthCore/OIDServiceConfiguration.h"
+#import "Source/AppAuthCore/OIDURLSessionProvider.h"
+#endif
+
+// Ignore warnings about "Use of GNU statement expression extension" which is raised by our use of
+// the XCTAssert___ macros.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wgnu"
+
+/*! @brief Unit tests for @c EkoOIDClientCredentialsTokenManager.
+ */
+@interface OIDClientCredentialsTokenManagerTests : XCTestCase
+@end
+@implementation OIDClientCredentialsTokenManagerTests
+
+- (void)tearDown {
+  [EkoOIDURLSessionProvider setSession:[NSURLSession sharedSession]];
+  [OIDTestURLProtocol removeHandler];
+  [super tearDown];
+}
+
+/*! @brief Stubs the token endpoint with one which issues a new access token for each request,
+        numbered from 1, and records the bodies of the requests in @c bodies.
+    @param firstExpiresIn When the first token expires, in seconds; the others expire in an hour.
+ */
+- (void)stubTokenEndpointWithFirstExpiresIn:(NSNumber *)firstExpiresIn
+                            recordingBodies:(NSMutableArray<NSString *> *)bodies {
+  [EkoOIDURLSessionProvider setSession:[OIDTestURLProtocol
+      sessionWithHandler:^id(NSURLRequest *request, NSString *body, NSInteger *statusCode) {
+        NSUInteger count;
+        @synchronized(bodies) {
+          [bodies addObject:body];
+          count = bodies.count;
+        }
+        return @{
+          @"access_token" : [NSString stringWithFormat:@"access token %lu", (unsigned long)count],
+          @"token_type" : @"Bearer",
+          @"expires_in" : count == 1 ? firstExpiresIn : @3600,
+        };
+      }
+           responseDelay:0]];
+}
+
+/*! @brief Returns a manager which isn't shared, so that no other test has cached its tokens.
+ */
++ (EkoOIDClientCredentialsTokenManager *)testManager {
+  return [[EkoOIDClientCredentialsTokenManager alloc]
+      initWithConfiguration:[OIDServiceConfigurationTests testInstance]
+                   clientID:@"agent"
+               clientSecret:@"secret"
+       additionalParameters:nil];
+}
+
+/*! @brief Asks @c manager for a token for @c scopeSet @c count times before waiting for any of
+        them, and returns the access tokens the actions were called with, in the order they were
+        called.
+ */
+- (NSArray<NSString *> *)accessTokensFromManager:(EkoOIDClientCredentialsTokenManager *)manager
+                                        scopeSet:(nullable EkoOIDScopeSet *)scopeSet
+                                           count:(NSUInteger)count {
+  NSMutableArray<NSString *> *accessTokens = [NSMutableArray array];
+  for (NSUInteger i = 0; i < count; i++) {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Action called."];
+    [manager performActionWithFreshTokens:^(NSString *_Nullable accessToken,
+                                            NSString *_Nullable idToken,
+                                            NSError *_Nullable error) {
+      XCTAssertNil(error, @"");
+      [accessTokens addObject:accessToken ?: @""];
+      [expectation fulfill];
+    }
+                                 scopeSet:scopeSet
+                            dispatchQueue:dispatch_get_main_queue()];
+  }
+  [self waitForExpectationsWithTimeout:2 handler:nil];
+  return accessTokens;
+}
+
+/*! @brief Tests that managers are shared per client.
+ */
+- (void)testSharedManagers {
+  EkoOIDServiceConfiguration *configuration = [OIDServiceConfigurationTests testInstance];
+  EkoOIDClientCredentialsTokenManager *manager =
+      [EkoOIDClientCredentialsTokenManager managerWithConfiguration:configuration
+                                                           clientID:@"agent"
+                                                       clientSecret:@"secret"];
+  XCTAssertEqualObjects(manager.clientID, @"agent", @"");
+  XCTAssertEqualObjects(manager.clientSecret, @"secret", @"");
+  XCTAssertEqual(manager,
+                 [EkoOIDClientCredentialsTokenManager managerWithConfiguration:configuration
+                                                                      clientID:@"agent"
+                                                                  clientSecret:@"secret"],
+                 @"");
+  XCTAssertNotEqual(manager,
+                    [EkoOIDClientCredentialsTokenManager managerWithConfiguration:configuration
+                                                                         clientID:@"other"
+                                                                     clientSecret:@"secret"],
+                    @"");
+}
+
+/*! @brief Tests that shared managers are released once nothing else holds them, and that a new
+        client secret replaces the shared manager.
+ */
+- (void)testSharedManagersAreReleased {
+  EkoOIDServiceConfiguration *configuration = [OIDServiceConfigurationTests testInstance];
+  __weak EkoOIDClientCredentialsTokenManager *weakManager;
+  @autoreleasepool {
+    weakManager =
+        [EkoOIDClientCredentialsTokenManager managerWithConfiguration:configuration
+                                                               clientID:@"released"
+                                                           clientSecret:@"secret"];
+  }
+  XCTAssertNil(weakManager, @"");
+
+  EkoOIDClientCredentialsTokenManager *manager =
+      [EkoOIDClientCredentialsTokenManager managerWithConfiguration:configuration
+                                                           clientID:@"rotated"
+                                                       clientSecret:@"secret"];
+  EkoOIDClientCredentialsTokenManager *rotatedManager =
+      [EkoOIDClientCredentialsTokenManager managerWithConfiguration:configuration
+                                                           clientID:@"rotated"
+                                                       clientSecret:@"new secret"];
+  XCTAssertNotEqual(manager, rotatedManager, @"");
+  XCTAssertEqualObjects(rotatedManager.clientSecret, @"new secret", @"");
+  XCTAssertEqual(rotatedManager,
+                 [EkoOIDClientCredentialsTokenManager managerWithConfiguration:configuration
+                                                                      clientID:@"rotated"
+                                                                  clientSecret:@"new secret"],
+                 @"");
+}
+
+/*! @brief Tests that tokens are requested and cached per scope set.
+ */
+- (void)testTokensAreCachedPerScopeSet {
+  NSMutableArray<NSString *> *bodies = [NSMutableArray array];
+  [self stubTokenEndpointWithFirstExpiresIn:@3600 recordingBodies:bodies];
+  EkoOIDClientCredentialsTokenManager *manager = [[self class] testManager];
+  EkoOIDScopeSet *read = [EkoOIDScopeSet scopeSetWithString:@"read"];
+  EkoOIDScopeSet *write = [EkoOIDScopeSet scopeSetWithString:@"write"];
+
+  XCTAssertEqualObjects([self accessTokensFromManager:manager scopeSet:read count:1],
+                        @[ @"access token 1" ], @"");
+  XCTAssertEqualObjects([self accessTokensFromManager:manager scopeSet:write count:1],
+                        @[ @"access token 2" ], @"");
+  XCTAssertEqualObjects([self accessTokensFromManager:manager scopeSet:nil count:1],
+                        @[ @"access token 3" ], @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)3, @"");
+  XCTAssertTrue([bodies[0] containsString:@"scope=read"], @"%@", bodies[0]);
+  XCTAssertTrue([bodies[1] containsString:@"scope=write"], @"%@", bodies[1]);
+  XCTAssertTrue([bodies[0] containsString:@"grant_type=client_credentials"], @"%@", bodies[0]);
+
+  // each token is served from the cache
+  XCTAssertEqualObjects([self accessTokensFromManager:manager
+                                             scopeSet:[EkoOIDScopeSet scopeSetWithString:@"read"]
+                                                count:1],
+                        @[ @"access token 1" ], @"");
+  XCTAssertEqualObjects([self accessTokensFromManager:manager scopeSet:write count:1],
+                        @[ @"access token 2" ], @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)3, @"");
+}
+
+/*! @brief Tests that a token which expires within the refresh-ahead interval of five minutes is
+        still used, while the next one is requested in the background.
+ */
+- (void)testTokenIsRefreshedAhead {
+  NSMutableArray<NSString *> *bodies = [NSMutableArray array];
+  // expires after the tolerance of a minute, but within the refresh-ahead interval
+  [self stubTokenEndpointWithFirstExpiresIn:@200 recordingBodies:bodies];
+  EkoOIDClientCredentialsTokenManager *manager = [[self class] testManager];
+
+  XCTAssertEqualObjects([self accessTokensFromManager:manager scopeSet:nil count:1],
+                        @[ @"access token 1" ], @"");
+  XCTAssertEqualObjects([self accessTokensFromManager:manager scopeSet:nil count:1],
+                        @[ @"access token 1" ], @"");
+
+  // the token requested in the background replaces the old one once it arrives
+  NSString *accessToken;
+  for (NSUInteger attempt = 0; attempt < 40; attempt++) {
+    accessToken = [self accessTokensFromManager:manager scopeSet:nil count:1].firstObject;
+    if ([accessToken isEqualToString:@"access token 2"]) {
+      break;
+    }
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+  }
+  XCTAssertEqualObjects(accessToken, @"access token 2", @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)2, @"");
+}
+
+/*! @brief Tests that concurrent demands for a token share a single request.
+ */
+- (void)testConcurrentDemandsShareRequest {
+  NSMutableArray<NSString *> *bodies = [NSMutableArray array];
+  [self stubTokenEndpointWithFirstExpiresIn:@3600 recordingBodies:bodies];
+  EkoOIDClientCredentialsTokenManager *manager = [[self class] testManager];
+
+  XCTAssertEqualObjects([self accessTokensFromManager:manager scopeSet:nil count:3],
+                        (@[ @"access token 1", @"access token 1", @"access token 1" ]), @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)1, @"");
+
+  // after setNeedsTokenRefresh, concurrent demands share the next request too
+  [manager setNeedsTokenRefresh];
+  XCTAssertEqualObjects([self accessTokensFromManager:manager scopeSet:nil count:2],
+                        (@[ @"access token 2", @"access token 2" ]), @"");
+  XCTAssertEqual(bodies.count, (NSUInteger)2, @"");
+}
+
+@end
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,367 @@
+/*! @file OIDFieldMappingTests.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "OIDAuthorizationRequestTests.h"
+#import "OIDEndSessionRequestTests.h"
+#import "OIDRegistrationRequestTests.h"
+#import "OIDTokenRequestTests.h"
+
+#if SWIFT_PACKAGE
+@import AppAuthCore;
+#else
+#import "Source/AppAuthCore/OIDAuthorizationResponse.h"
+#import "Source/AppAuthCore/OIDEndSessionResponse.h"
+#import "Source/AppAuthCore/OIDFieldMapping.h"
+#import "Source/AppAuthCore/OIDIDToken.h"
+#import "Source/AppAuthCore/OIDRegistrationResponse.h"
+#import "Source/AppAuthCore/OIDTokenResponse.h"
+#endif
+
+// Ignore warnings about "Use of GNU statement expression extension" which is raised by our use of
+// the XCTAssert___ macros.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wgnu"
+
+/*! @brief The number of objects whose fields each performance test assigns.
+ */
+static const NSUInteger kPerformanceIterations = 10000;
+
+/*! @brief Returns parameters which must not map to any field of a table declaring @c fields: for
+        each key, one which differs only in its second character, and so has the same perfect hash
+        as the key whenever it is at least four characters long; and one unknown key.
+ */
+static NSDictionary<NSString *, NSObject<NSCopying> *> *OIDUnmappedParameters(
+    NSDictionary<NSString *, NSObject<NSCopying> *> *fields) {
+  NSMutableDictionary<NSString *, NSObject<NSCopying> *> *parameters =
+      [NSMutableDictionary dictionary];
+  for (NSString *key in fields) {
+    NSString *collidingKey = [key stringByReplacingCharactersInRange:NSMakeRange(1, 1)
+                                                          withString:@"~"];
+    parameters[collidingKey] = @"colliding value";
+  }
+  parameters[@"unknown"] = @"unknown value";
+  return parameters;
+}
+
+/*! @brief Returns @c fields together with @c OIDUnmappedParameters of @c fields.
+ */
+static NSDictionary<NSString *, NSObject<NSCopying> *> *OIDParametersWithUnmapped(
+    NSDictionary<NSString *, NSObject<NSCopying> *> *fields) {
+  NSMutableDictionary<NSString *, NSObject<NSCopying> *> *parameters =
+      [OIDUnmappedParameters(fields) mutableCopy];
+  [parameters addEntriesFromDictionary:fields];
+  return parameters;
+}
+
+/*! @brief Returns the base64url encoding, without padding, of the JSON serialization of
+        @c object.
+ */
+static NSString *OIDBase64URLEncodedJSON(NSDictionary *object) {
+  NSData *JSON = [NSJSONSerialization dataWithJSONObject:object options:0 error:NULL];
+  NSString *base64 = [JSON base64EncodedStringWithOptions:0];
+  base64 = [base64 stringByReplacingOccurrencesOfString:@"+" withString:@"-"];
+  base64 = [base64 stringByReplacingOccurrencesOfString:@"/" withString:@"_"];
+  return [base64 stringByReplacingOccurrencesOfString:@"=" withString:@""];
+}
+
+/*! @brief A value whose lifetime is observable, as copying returns the value itself.
+ */
+@interface OIDFieldMappingTestValue : NSObject <NSCopying>
+@end
+@implementation OIDFieldMappingTestValue
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+  return self;
+}
+
+@end
+
+/*! @brief An object with fields of each ownership.
+ */
+@interface OIDFieldMappingTestObject : NSObject
+@property(nonatomic, strong, nullable) NSString *strongField;
+@property(nonatomic, copy, nullable) NSString *copiedField;
+/*! @brief Implicitly strong, like the properties of the response classes, so that its property has
+        no ownership attribute.
+ */
+@property(nonatomic, readonly, nullable) NSString *readonlyField;
+@property(nonatomic, weak, nullable) OIDFieldMappingTestValue *weakField;
+@property(nonatomic, unsafe_unretained, nullable) OIDFieldMappingTestValue *unretainedField;
+/*! @brief The number of fields assigned through key-value coding rather than directly.
+ */
+@property(nonatomic, readonly) NSUInteger keyValueCodingCount;
+@end
+@implementation OIDFieldMappingTestObject
+
+- (void)setValue:(nullable id)value forKey:(NSString *)key {
+  _keyValueCodingCount++;
+  [super setValue:value forKey:key];
+}
+
+@end
+
+/*! @brief Unit tests for @c EkoOIDFieldMapping.
+ */
+@interface OIDFieldMappingTests : XCTestCase
+@end
+@implementation OIDFieldMappingTests
+
+/*! @brief Returns a map of the fields of @c OIDFieldMappingTestObject.
+ */
++ (NSDictionary<NSString *, EkoOIDFieldMapping *> *)fieldMap {
+  static NSDictionary<NSString *, EkoOIDFieldMapping *> *fieldMap;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    Class valueClass = [OIDFieldMappingTestValue class];
+    fieldMap = @{
+      @"strong" : [[EkoOIDFieldMapping alloc] initWithName:@"_strongField"
+                                                      type:[NSString class]],
+      @"copied" : [[EkoOIDFieldMapping alloc] initWithName:@"_copiedField"
+                                                      type:[NSString class]],
+      @"readonly" : [[EkoOIDFieldMapping alloc] initWithName:@"_readonlyField"
+                                                        type:[NSString class]],
+      @"weak" : [[EkoOIDFieldMapping alloc] initWithName:@"_weakField" type:valueClass],
+      @"unretained" : [[EkoOIDFieldMapping alloc] initWithName:@"_unretainedField"
+                                                          type:valueClass],
+    };
+  });
+  return fieldMap;
+}
+
+/*! @brief Tests that strong, copied and implicitly strong fields are assigned directly, and
+        retained.
+ */
+- (void)testStrongFields {
+  OIDFieldMappingTestObject *object = [[OIDFieldMappingTestObject alloc] init];
+  @autoreleasepool {
+    NSDictionary *parameters = @{
+      @"strong" : [NSMutableString stringWithString:@"strong value"],
+      @"copied" : [NSMutableString stringWithString:@"copied value"],
+      @"readonly" : [NSMutableString stringWithString:@"readonly value"],
+      @"other" : @"other value"
+    };
+    NSDictionary *remaining = [EkoOIDFieldMapping remainingParametersWithMap:[[self class] fieldMap]
+                                                                  parameters:parameters
+                                                                    instance:object];
+    XCTAssertEqualObjects(remaining, @{ @"other" : @"other value" });
+  }
+  XCTAssertEqualObjects(object.strongField, @"strong value");
+  XCTAssertEqualObjects(object.copiedField, @"copied value");
+  XCTAssertEqualObjects(object.readonlyField, @"readonly value");
+  XCTAssertEqual(object.keyValueCodingCount, (NSUInteger)0);
+}
+
+/*! @brief Tests that a weak field doesn't retain its value, and is cleared when the value is
+        deallocated.
+ */
+- (void)testWeakField {
+  OIDFieldMappingTestObject *object = [[OIDFieldMappingTestObject alloc] init];
+  __weak OIDFieldMappingTestValue *weakValue;
+  @autoreleasepool {
+    OIDFieldMappingTestValue *value = [[OIDFieldMappingTestValue alloc] init];
+    weakValue = value;
+    [EkoOIDFieldMapping remainingParametersWithMap:[[self class] fieldMap]
+                                        parameters:@{ @"weak" : value }
+                                          instance:object];
+    XCTAssertEqual(object.weakField, value);
+  }
+  XCTAssertNil(weakValue);
+  XCTAssertNil(object.weakField);
+}
+
+/*! @brief Tests that an unretained field doesn't retain its value.
+ */
+- (void)testUnretainedField {
+  OIDFieldMappingTestObject *object = [[OIDFieldMappingTestObject alloc] init];
+  __weak OIDFieldMappingTestValue *weakValue;
+  @autoreleasepool {
+    OIDFieldMappingTestValue *value = [[OIDFieldMappingTestValue alloc] init];
+    weakValue = value;
+    [EkoOIDFieldMapping remainingParametersWithMap:[[self class] fieldMap]
+                                        parameters:@{ @"unretained" : value }
+                                          instance:object];
+    XCTAssertEqual(object.unretainedField, value);
+    object.unretainedField = nil;
+  }
+  XCTAssertNil(weakValue);
+}
+
+/*! @brief Tests that every key of the field table of @c EkoOIDTokenResponse is found, and that
+        other keys, including ones with the same perfect hash, are not.
+ */
+- (void)testTokenResponseFieldTable {
+  NSDictionary<NSString *, NSObject<NSCopying> *> *fields = @{
+    @"access_token" : @"access token",
+    @"expires_in" : @3600,
+    @"token_type" : @"Bearer",
+    @"id_token" : @"id token",
+    @"refresh_token" : @"refresh token",
+    @"scope" : @"openid email",
+  };
+  EkoOIDTokenResponse *response =
+      [[EkoOIDTokenResponse alloc] initWithRequest:[OIDTokenRequestTests testInstance]
+                                        parameters:OIDParametersWithUnmapped(fields)];
+  XCTAssertEqualObjects(response.accessToken, @"access token");
+  XCTAssertNotNil(response.accessTokenExpirationDate);
+  XCTAssertEqualObjects(response.tokenType, @"Bearer");
+  XCTAssertEqualObjects(response.idToken, @"id token");
+  XCTAssertEqualObjects(response.refreshToken, @"refresh token");
+  XCTAssertEqualObjects(response.scope, @"openid email");
+  XCTAssertEqualObjects(response.additionalParameters, OIDUnmappedParameters(fields));
+}
+
+/*! @brief Tests that every key of the field table of @c EkoOIDAuthorizationResponse is found, and
+        that other keys, including ones with the same perfect hash, are not.
+ */
+- (void)testAuthorizationResponseFieldTable {
+  NSDictionary<NSString *, NSObject<NSCopying> *> *fields = @{
+    @"state" : @"state",
+    @"code" : @"code",
+    @"access_token" : @"access token",
+    @"expires_in" : @3600,
+    @"token_type" : @"Bearer",
+    @"id_token" : @"id token",
+    @"scope" : @"openid email",
+  };
+  EkoOIDAuthorizationResponse *response = [[EkoOIDAuthorizationResponse alloc]
+      initWithRequest:[OIDAuthorizationRequestTests testInstance]
+           parameters:OIDParametersWithUnmapped(fields)];
+  XCTAssertEqualObjects(response.state, @"state");
+  XCTAssertEqualObjects(response.authorizationCode, @"code");
+  XCTAssertEqualObjects(response.accessToken, @"access token");
+  XCTAssertNotNil(response.accessTokenExpirationDate);
+  XCTAssertEqualObjects(response.tokenType, @"Bearer");
+  XCTAssertEqualObjects(response.idToken, @"id token");
+  XCTAssertEqualObjects(response.scope, @"openid email");
+  XCTAssertEqualObjects(response.additionalParameters, OIDUnmappedParameters(fields));
+}
+
+/*! @brief Tests that every key of the field table of @c EkoOIDRegistrationResponse is found, and
+        that other keys, including ones with the same perfect hash, are not.
+ */
+- (void)testRegistrationResponseFieldTable {
+  NSDictionary<NSString *, NSObject<NSCopying> *> *fields = @{
+    @"client_id" : @"client id",
+    @"client_id_issued_at" : @1500000000,
+    @"client_secret" : @"client secret",
+    @"client_secret_expires_at" : @1600000000,
+    @"registration_access_token" : @"registration access token",
+    @"registration_client_uri" : @"https://www.example.com/register/client",
+    @"token_endpoint_auth_method" : @"client_secret_basic",
+  };
+  EkoOIDRegistrationResponse *response = [[EkoOIDRegistrationResponse alloc]
+      initWithRequest:[OIDRegistrationRequestTests testInstance]
+           parameters:OIDParametersWithUnmapped(fields)];
+  XCTAssertEqualObjects(response.clientID, @"client id");
+  XCTAssertEqualObjects(response.clientIDIssuedAt,
+                        [NSDate dateWithTimeIntervalSince1970:1500000000]);
+  XCTAssertEqualObjects(response.clientSecret, @"client secret");
+  XCTAssertEqualObjects(response.clientSecretExpiresAt,
+                        [NSDate dateWithTimeIntervalSince1970:1600000000]);
+  XCTAssertEqualObjects(response.registrationAccessToken, @"registration access token");
+  XCTAssertEqualObjects(response.registrationClientURI,
+                        [NSURL URLWithString:@"https://www.example.com/register/client"]);
+  XCTAssertEqualObjects(response.tokenEndpointAuthenticationMethod, @"client_secret_basic");
+  XCTAssertEqualObjects(response.additionalParameters, OIDUnmappedParameters(fields));
+}
+
+/*! @brief Tests that the key of the field table of @c EkoOIDEndSessionResponse is found, and that
+        other keys, including one with the same perfect hash, are not.
+ */
+- (void)testEndSessionResponseFieldTable {
+  NSDictionary<NSString *, NSObject<NSCopying> *> *fields = @{ @"state" : @"state" };
+  EkoOIDEndSessionResponse *response =
+      [[EkoOIDEndSessionResponse alloc] initWithRequest:[OIDEndSessionRequestTests testInstance]
+                                             parameters:OIDParametersWithUnmapped(fields)];
+  XCTAssertEqualObjects(response.state, @"state");
+  XCTAssertEqualObjects(response.additionalParameters, OIDUnmappedParameters(fields));
+}
+
+/*! @brief Tests that every claim of the field table of @c EkoOIDIDToken is found, and that other
+        claims, including ones with the same perfect hash, don't overwrite them.
+ */
+- (void)testIDTokenFieldTable {
+  NSDictionary<NSString *, NSObject<NSCopying> *> *fields = @{
+    @"iss" : @"https://accounts.example.com",
+    @"sub" : @"subject",
+    @"aud" : @"client id",
+    @"exp" : @1600000000,
+    @"iat" : @1500000000,
+    @"nonce" : @"nonce",
+  };
+  NSString *IDTokenString =
+      [NSString stringWithFormat:@"%@.%@.",
+                                 OIDBase64URLEncodedJSON(@{ @"alg" : @"none" }),
+                                 OIDBase64URLEncodedJSON(OIDParametersWithUnmapped(fields))];
+  EkoOIDIDToken *IDToken = [[EkoOIDIDToken alloc] initWithIDTokenString:IDTokenString];
+  XCTAssertEqualObjects(IDToken.issuer, [NSURL URLWithString:@"https://accounts.example.com"]);
+  XCTAssertEqualObjects(IDToken.subject, @"subject");
+  XCTAssertEqualObjects(IDToken.audience, @[ @"client id" ]);
+  XCTAssertEqualObjects(IDToken.expiresAt, [NSDate dateWithTimeIntervalSince1970:1600000000]);
+  XCTAssertEqualObjects(IDToken.issuedAt, [NSDate dateWithTimeIntervalSince1970:1500000000]);
+  XCTAssertEqualObjects(IDToken.nonce, @"nonce");
+}
+
+/*! @brief Measures assigning strong fields through the compiled map. Compare with
+        @c testKeyValueCodingPerformance, which assigns the same fields the way the map did before
+        it was compiled.
+ */
+- (void)testCompiledMapPerformance {
+  NSDictionary<NSString *, EkoOIDFieldMapping *> *map = [[self class] fieldMap];
+  NSDictionary *parameters = @{
+    @"strong" : @"strong value",
+    @"copied" : @"copied value",
+    @"readonly" : @"readonly value"
+  };
+  [self measureBlock:^{
+    for (NSUInteger i = 0; i < kPerformanceIterations; i++) {
+      @autoreleasepool {
+        OIDFieldMappingTestObject *object = [[OIDFieldMappingTestObject alloc] init];
+        [EkoOIDFieldMapping remainingParametersWithMap:map parameters:parameters instance:object];
+      }
+    }
+  }];
+}
+
+/*! @brief Measures assigning the fields of @c testCompiledMapPerformance through key-value coding,
+        as the baseline for that test.
+ */
+- (void)testKeyValueCodingPerformance {
+  NSDictionary<NSString *, EkoOIDFieldMapping *> *map = [[self class] fieldMap];
+  NSDictionary *parameters = @{
+    @"strong" : @"strong value",
+    @"copied" : @"copied value",
+    @"readonly" : @"readonly value"
+  };
+  [self measureBlock:^{
+    for (NSUInteger i = 0; i < kPerformanceIterations; i++) {
+      @autoreleasepool {
+        OIDFieldMappingTestObject *object = [[OIDFieldMappingTestObject alloc] init];
+        [parameters enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+          [object setValue:[value copy] forKey:map[key].name];
+        }];
+      }
+    }
+  }];
+}
+
+@end
+
+#pragma GCC diagnostic pop
@@ -53,6 +53,13 @@
   XCTAssertEqualObjects(OIDGrantTypeClientCredentials, @"client_credentials");
 }
 
+- (void)testTokenExchange {
+  XCTAssertEqualObjects(EkoOIDGrantTypeTokenExchange,
+                        @"urn:ietf:params:oauth:grant-type:token-exchange");
+  XCTAssertEqualObjects(EkoOIDTokenTypeAccessToken,
+                        @"urn:ietf:params:oauth:token-type:access_token");
+}
+
 @end
 
 #pragma GCC diagnostic pop
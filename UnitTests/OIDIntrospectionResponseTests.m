@@ -0,0 +1,250 @@
+/*! @file OIDIntrospectionResponseTests.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "OIDTestURLProtocol.h"
+
+#if SWIFT_PACKAGE
+@import AppAuthCore;
+#else
+#import "Source/AppAuthCore/OIDError.h"
+#import "Source/AppAuthCore/OIDIntrospectionRequest.h"
+#import "Source/AppAuthCore/OIDIntrospectionResponse.h"
+#import "Source/AppAuthCore/OIDTokenIntrospector.h"
+#import "Source/AppAuthCore/OIDURLSessionProvider.h"
+#endif
+
+// Ignore warnings about "Use of GNU statement expression extension" which is raised by our use of
+// the XCTAssert___ macros.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wgnu"
+
+/*! @brief Test value for the introspection endpoint.
+ */
+static NSString *const kTestIntrospectionEndpoint = @"https://www.example.com/introspect";
+
+/*! @brief Unit tests for @c EkoOIDIntrospectionResponse.
+ */
+@interface OIDIntrospectionResponseTests : XCTestCase
+@end
+@implementation OIDIntrospectionResponseTests
+
+- (void)tearDown {
+  [EkoOIDURLSessionProvider setSession:[NSURLSession sharedSession]];
+  [OIDTestURLProtocol removeHandler];
+  [super tearDown];
+}
+
++ (EkoOIDIntrospectionRequest *)testRequest {
+  return [[EkoOIDIntrospectionRequest alloc]
+      initWithIntrospectionEndpoint:[NSURL URLWithString:kTestIntrospectionEndpoint]
+                              token:@"token"
+                      tokenTypeHint:nil
+                           clientID:@"gateway"
+                       clientSecret:@"secret"
+               additionalParameters:nil];
+}
+
+/*! @brief Tests that the members of an active token's response are decoded.
+ */
+- (void)testActiveResponse {
+  EkoOIDIntrospectionResponse *response =
+      [[EkoOIDIntrospectionResponse alloc] initWithRequest:[[self class] testRequest]
+                                                parameters:@{
+                                                  @"active" : @YES,
+                                                  @"scope" : @"read write",
+                                                  @"client_id" : @"client",
+                                                  @"exp" : @1700000000,
+                                                  @"sub" : @42,
+                                                }];
+  XCTAssertTrue(response.active, @"");
+  XCTAssertEqualObjects(response.scope, @"read write", @"");
+  XCTAssertEqualObjects(response.clientID, @"client", @"");
+  XCTAssertEqualObjects(response.expiresAt, [NSDate dateWithTimeIntervalSince1970:1700000000], @"");
+  // members with the wrong type are ignored
+  XCTAssertNil(response.subject, @"");
+}
+
+/*! @brief Tests that only the JSON boolean true makes a token active.
+ */
+- (void)testInactiveResponse {
+  EkoOIDIntrospectionRequest *request = [[self class] testRequest];
+  XCTAssertFalse([[EkoOIDIntrospectionResponse alloc] initWithRequest:request
+                                                           parameters:@{ @"active" : @NO }]
+                     .active, @"");
+  XCTAssertFalse([[EkoOIDIntrospectionResponse alloc] initWithRequest:request
+                                                           parameters:@{ @"active" : @"true" }]
+                     .active, @"");
+  XCTAssertFalse([[EkoOIDIntrospectionResponse alloc] initWithRequest:request parameters:@{}]
+                     .active, @"");
+}
+
+/*! @brief Tests that an introspector has no result for a token it hasn't introspected.
+ */
+- (void)testIntrospectorCacheMiss {
+  EkoOIDTokenIntrospector *introspector = [[EkoOIDTokenIntrospector alloc]
+      initWithIntrospectionEndpoint:[NSURL URLWithString:kTestIntrospectionEndpoint]
+                           clientID:@"gateway"
+                       clientSecret:@"secret"];
+  XCTAssertNil([introspector cachedResponseForToken:@"token"], @"");
+}
+
+/*! @brief Returns an introspector for the test endpoint with the given cache lifetimes.
+ */
++ (EkoOIDTokenIntrospector *)introspectorWithActiveResultLifetime:(NSTimeInterval)activeLifetime
+                                           inactiveResultLifetime:(NSTimeInterval)inactiveLifetime {
+  return [[EkoOIDTokenIntrospector alloc]
+      initWithIntrospectionEndpoint:[NSURL URLWithString:kTestIntrospectionEndpoint]
+                           clientID:@"gateway"
+                       clientSecret:@"secret"
+               activeResultLifetime:activeLifetime
+             inactiveResultLifetime:inactiveLifetime];
+}
+
+/*! @brief Stubs the introspection endpoint to answer every request with @c parameters.
+ */
++ (void)stubIntrospectionEndpointWithParameters:(NSDictionary *)parameters {
+  [EkoOIDURLSessionProvider setSession:[OIDTestURLProtocol
+      sessionWithHandler:^id(NSURLRequest *request, NSString *body, NSInteger *statusCode) {
+        return parameters;
+      }
+           responseDelay:0]];
+}
+
+/*! @brief Introspects @c token and waits for the result.
+ */
+- (EkoOIDIntrospectionResponse *)introspectToken:(NSString *)token
+                                    introspector:(EkoOIDTokenIntrospector *)introspector
+                                           error:(NSError **)error {
+  XCTestExpectation *expectation = [self expectationWithDescription:@"Introspected token."];
+  __block EkoOIDIntrospectionResponse *introspection;
+  __block NSError *introspectionError;
+  [introspector introspectToken:token
+                       callback:^(EkoOIDIntrospectionResponse *_Nullable response,
+                                  NSError *_Nullable callbackError) {
+    introspection = response;
+    introspectionError = callbackError;
+    [expectation fulfill];
+  }];
+  [self waitForExpectationsWithTimeout:2 handler:nil];
+  if (error) {
+    *error = introspectionError;
+  }
+  return introspection;
+}
+
+/*! @brief Tests that a result for an active token is not cached past the token's expiry, even
+        when @c activeResultLifetime is longer.
+ */
+- (void)testActiveResultIsCappedAtExpiry {
+  NSTimeInterval expiresAt = [[NSDate date] timeIntervalSince1970] + 0.5;
+  [[self class] stubIntrospectionEndpointWithParameters:@{ @"active" : @YES,
+                                                           @"exp" : @(expiresAt) }];
+  EkoOIDTokenIntrospector *introspector =
+      [[self class] introspectorWithActiveResultLifetime:60 inactiveResultLifetime:60];
+
+  EkoOIDIntrospectionResponse *response =
+      [self introspectToken:@"token" introspector:introspector error:NULL];
+  XCTAssertTrue(response.active, @"");
+  XCTAssertEqual([introspector cachedResponseForToken:@"token"], response, @"");
+
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSince1970:expiresAt + 0.1]];
+  XCTAssertNil([introspector cachedResponseForToken:@"token"], @"");
+  [self introspectToken:@"token" introspector:introspector error:NULL];
+  XCTAssertEqual([OIDTestURLProtocol requestCount], (NSUInteger)2, @"");
+}
+
+/*! @brief Tests that a result for an inactive token is cached for @c inactiveResultLifetime.
+ */
+- (void)testInactiveResultExpires {
+  [[self class] stubIntrospectionEndpointWithParameters:@{ @"active" : @NO }];
+  EkoOIDTokenIntrospector *introspector =
+      [[self class] introspectorWithActiveResultLifetime:60 inactiveResultLifetime:0.5];
+
+  EkoOIDIntrospectionResponse *response =
+      [self introspectToken:@"token" introspector:introspector error:NULL];
+  XCTAssertFalse(response.active, @"");
+  XCTAssertEqual([introspector cachedResponseForToken:@"token"], response, @"");
+  [self introspectToken:@"token" introspector:introspector error:NULL];
+  XCTAssertEqual([OIDTestURLProtocol requestCount], (NSUInteger)1, @"");
+
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.6]];
+  XCTAssertNil([introspector cachedResponseForToken:@"token"], @"");
+}
+
+/*! @brief Tests that a failed introspection is not cached, so the next one makes a request.
+ */
+- (void)testErrorsAreNotCached {
+  __block BOOL fail = YES;
+  [EkoOIDURLSessionProvider setSession:[OIDTestURLProtocol
+      sessionWithHandler:^id(NSURLRequest *request, NSString *body, NSInteger *statusCode) {
+        return fail ? nil : @{ @"active" : @YES };
+      }
+           responseDelay:0]];
+  EkoOIDTokenIntrospector *introspector =
+      [[self class] introspectorWithActiveResultLifetime:60 inactiveResultLifetime:60];
+
+  NSError *error;
+  XCTAssertNil([self introspectToken:@"token" introspector:introspector error:&error], @"");
+  XCTAssertEqual(error.code, EkoOIDErrorCodeNetworkError, @"");
+  XCTAssertNil([introspector cachedResponseForToken:@"token"], @"");
+
+  fail = NO;
+  EkoOIDIntrospectionResponse *response =
+      [self introspectToken:@"token" introspector:introspector error:&error];
+  XCTAssertTrue(response.active, @"");
+  XCTAssertNil(error, @"");
+  XCTAssertEqual([OIDTestURLProtocol requestCount], (NSUInteger)2, @"");
+}
+
+/*! @brief Tests that concurrent introspections of the same token share a single request.
+ */
+- (void)testConcurrentIntrospectionsShareRequest {
+  [EkoOIDURLSessionProvider setSession:[OIDTestURLProtocol
+      sessionWithHandler:^id(NSURLRequest *request, NSString *body, NSInteger *statusCode) {
+        return @{ @"active" : @YES };
+      }
+           responseDelay:0.1]];
+  EkoOIDTokenIntrospector *introspector =
+      [[self class] introspectorWithActiveResultLifetime:60 inactiveResultLifetime:60];
+
+  NSMutableArray<EkoOIDIntrospectionResponse *> *responses = [NSMutableArray array];
+  for (NSUInteger i = 0; i < 3; i++) {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Introspected token."];
+    [introspector introspectToken:@"token"
+                         callback:^(EkoOIDIntrospectionResponse *_Nullable response,
+                                    NSError *_Nullable error) {
+      XCTAssertNotNil(response, @"");
+      if (response) {
+        [responses addObject:response];
+      }
+      [expectation fulfill];
+    }];
+  }
+  [self waitForExpectationsWithTimeout:2 handler:nil];
+
+  XCTAssertEqual(responses.count, (NSUInteger)3, @"");
+  XCTAssertEqual(responses[1], responses[0], @"");
+  XCTAssertEqual(responses[2], responses[0], @"");
+  XCTAssertEqual([OIDTestURLProtocol requestCount], (NSUInteger)1, @"");
+}
+
+@end
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,884 @@
+/*! @file OIDLoopbackHTTPServerTests.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2016 The AppAuth Authors.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <TargetConditionals.h>
+
+// The loopback server is part of the macOS framework only, which the Swift package's tests don't
+// link against.
+#if TARGET_OS_OSX && !SWIFT_PACKAGE
+
+#import <XCTest/XCTest.h>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#import "Source/AppAuth/macOS/LoopbackHTTPServer/OIDLoopbackHTTPServer.h"
+#import "Source/AppAuth/macOS/OIDRedirectHTTPHandler.h"
+#import "Source/AppAuthCore/OIDError.h"
+#import "Source/AppAuthCore/OIDExternalUserAgentSession.h"
+
+// Ignore warnings about "Use of GNU statement expression extension" which is raised by our use of
+// the XCTAssert___ macros.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wgnu"
+
+// The internal classes of the loopback server are declared in its implementation file; these
+// declarations expose the methods the tests use.
+
+@interface HTTPEventLoop : NSObject
++ (HTTPEventLoop *)sharedLoop;
+- (void)performBlock:(dispatch_block_t)block;
+- (BOOL)isLoopThread;
+@end
+
+@interface HTTPRequestParser : NSObject
+- (id)initWithMaxHeaderLength:(NSUInteger)maxHeader maxBodyLength:(NSUInteger)maxBody;
+- (void *)readBufferWithCapacity:(NSUInteger *)capacity;
+- (void)didReadLength:(NSUInteger)length;
+- (CFHTTPMessageRef)copyNextRequest CF_RETURNS_RETAINED;
+- (BOOL)hasPartialRequest;
+- (NSInteger)errorStatusCode;
+@end
+
+@interface HTTPResponseWriter : NSObject
+- (void)appendData:(NSData *)data;
+- (BOOL)hasPendingBytes;
+- (BOOL)writeToSocket:(int)fd;
+@end
+
+/*! @brief The request limits of the parsers under test, unless a test needs others.
+ */
+static const NSUInteger kTestMaxHeaderLength = 1024;
+static const NSUInteger kTestMaxBodyLength = 1024;
+
+/*! @brief How long a test waits for the listener to respond.
+ */
+static const NSTimeInterval kTestResponseTimeout = 5;
+
+/*! @brief Returns the bytes of a string of HTTP/1.1 protocol elements.
+ */
+static NSData *OIDHTTPBytes(NSString *string) {
+  return [string dataUsingEncoding:NSISOLatin1StringEncoding];
+}
+
+/*! @brief Gives bytes to a parser as if a single read from the socket had received them.
+ */
+static void OIDFeedParser(HTTPRequestParser *parser, NSData *bytes) {
+  NSUInteger offset = 0;
+  while (offset < bytes.length) {
+    NSUInteger capacity = 0;
+    void *buffer = [parser readBufferWithCapacity:&capacity];
+    if (!capacity) {
+      return;
+    }
+    NSUInteger length = MIN(capacity, bytes.length - offset);
+    memcpy(buffer, (const uint8_t *)bytes.bytes + offset, length);
+    [parser didReadLength:length];
+    offset += length;
+  }
+}
+
+/*! @brief Connects a blocking socket to a port of the IPv4 loopback interface, with reads that
+        give up after @c kTestResponseTimeout, and returns it, or -1 if the connection failed.
+ */
+static int OIDConnectToLoopbackPort(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    return -1;
+  }
+  int yes = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+  struct timeval timeout = { (time_t)kTestResponseTimeout, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_len = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*! @brief Sends all the bytes of a request on a connected socket.
+ */
+static BOOL OIDSendRequest(int fd, NSString *request) {
+  NSData *bytes = OIDHTTPBytes(request);
+  NSUInteger sent = 0;
+  while (sent < bytes.length) {
+    ssize_t written = send(fd, (const uint8_t *)bytes.bytes + sent, bytes.length - sent, 0);
+    if (written <= 0) {
+      return NO;
+    }
+    sent += (NSUInteger)written;
+  }
+  return YES;
+}
+
+/*! @brief Returns everything received on a connected socket until the peer closes it, or until a
+        read times out, in which case @c closed is set to NO.
+ */
+static NSString *OIDReceiveUntilClosed(int fd, BOOL *closed) {
+  NSMutableData *response = [NSMutableData data];
+  uint8_t chunk[4096];
+  ssize_t received;
+  while (0 < (received = recv(fd, chunk, sizeof(chunk), 0))) {
+    [response appendBytes:chunk length:(NSUInteger)received];
+  }
+  if (closed) {
+    *closed = (0 == received);
+  }
+  return [[NSString alloc] initWithData:response encoding:NSISOLatin1StringEncoding];
+}
+
+/*! @brief Sends bytes to the listener on the IPv4 loopback interface, and returns everything it
+        responds with until it closes the connection.
+ */
+static NSString *OIDExchangeLoopbackBytes(uint16_t port, NSString *request) {
+  int fd = OIDConnectToLoopbackPort(port);
+  if (fd < 0) {
+    return nil;
+  }
+  NSString *response = OIDSendRequest(fd, request) ? OIDReceiveUntilClosed(fd, NULL) : nil;
+  close(fd);
+  return response;
+}
+
+/*! @brief Sets how long reads on a socket wait before they give up.
+ */
+static void OIDSetReceiveTimeout(int fd, NSTimeInterval seconds) {
+  struct timeval timeout = { (time_t)seconds, (suseconds_t)(fmod(seconds, 1) * USEC_PER_SEC) };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+/*! @brief Returns the status line and headers of the next response received on a connected socket,
+        or nil if the connection is closed or a read times out before they are complete.
+ */
+static NSString *OIDReceiveResponseHeader(int fd) {
+  NSMutableData *response = [NSMutableData data];
+  NSData *end = OIDHTTPBytes(@"\r\n\r\n");
+  uint8_t byte;
+  // reads a byte at a time, so that nothing of the next response is consumed
+  while (1 == recv(fd, &byte, 1, 0)) {
+    [response appendBytes:&byte length:1];
+    NSRange range = NSMakeRange(response.length - MIN(response.length, end.length),
+                                MIN(response.length, end.length));
+    if ([[response subdataWithRange:range] isEqualToData:end]) {
+      return [[NSString alloc] initWithData:response encoding:NSISOLatin1StringEncoding];
+    }
+  }
+  return nil;
+}
+
+/*! @brief Returns a socket bound to a kernel-chosen port of an IPv4 address, and listening if
+        @c listening is YES, or -1 if it couldn't be created.
+ */
+static int OIDCreateBoundSocket(in_addr_t address, BOOL listening) {
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    return -1;
+  }
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_len = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  addr.sin_addr.s_addr = htonl(address);
+  if (0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || (listening && 0 != listen(fd, 4))) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*! @brief Returns the port a socket is bound to.
+ */
+static uint16_t OIDBoundPort(int fd) {
+  struct sockaddr_in addr;
+  socklen_t length = sizeof(addr);
+  if (0 != getsockname(fd, (struct sockaddr *)&addr, &length)) {
+    return 0;
+  }
+  return ntohs(addr.sin_port);
+}
+
+/*! @brief An external user-agent session which records what the redirect handler calls it with.
+ */
+@interface OIDLoopbackTestSession : NSObject <EkoOIDExternalUserAgentSession>
+@property(nonatomic) NSURL *resumedURL;
+@property(nonatomic) NSError *error;
+/*! @brief Fulfilled when the session is resumed.
+ */
+@property(nonatomic) XCTestExpectation *resumeExpectation;
+@end
+
+@implementation OIDLoopbackTestSession
+
+- (void)cancel {
+}
+
+- (void)cancelWithCompletion:(void (^)(void))completion {
+  if (completion) {
+    completion();
+  }
+}
+
+- (BOOL)resumeExternalUserAgentFlowWithURL:(NSURL *)URL {
+  _resumedURL = URL;
+  [_resumeExpectation fulfill];
+  return YES;
+}
+
+- (void)failExternalUserAgentFlowWithError:(NSError *)error {
+  _error = error;
+}
+
+@end
+
+/*! @brief Unit tests for the loopback HTTP server used by @c EkoOIDRedirectHTTPHandler.
+ */
+@interface OIDLoopbackHTTPServerTests : XCTestCase
+@end
+
+@implementation OIDLoopbackHTTPServerTests
+
+/*! @brief Returns a parser with the test limits.
+ */
++ (HTTPRequestParser *)testParser {
+  return [[HTTPRequestParser alloc] initWithMaxHeaderLength:kTestMaxHeaderLength
+                                              maxBodyLength:kTestMaxBodyLength];
+}
+
+/*! @brief Parses the bytes of a request which must fail, and returns the status code the parser
+        responds to it with.
+ */
+- (NSInteger)errorStatusCodeForRequest:(NSString *)request
+                       maxHeaderLength:(NSUInteger)maxHeaderLength
+                         maxBodyLength:(NSUInteger)maxBodyLength {
+  HTTPRequestParser *parser = [[HTTPRequestParser alloc] initWithMaxHeaderLength:maxHeaderLength
+                                                                   maxBodyLength:maxBodyLength];
+  OIDFeedParser(parser, OIDHTTPBytes(request));
+  CFHTTPMessageRef message = [parser copyNextRequest];
+  XCTAssertTrue(message == NULL, @"");
+  if (message) {
+    CFRelease(message);
+  }
+  return [parser errorStatusCode];
+}
+
+#pragma mark - HTTPRequestParser
+
+/*! @brief Tests that a request line and headers which arrive a byte at a time are parsed once the
+        empty line ending them is received.
+ */
+- (void)testFragmentedRequest {
+  HTTPRequestParser *parser = [[self class] testParser];
+  NSData *bytes = OIDHTTPBytes(@"GET /redirect?state=a HTTP/1.1\r\n"
+                                "Host: 127.0.0.1:8080\r\n"
+                                "X-Test: \t value \r\n"
+                                "\r\n");
+  for (NSUInteger i = 0; i + 1 < bytes.length; i++) {
+    OIDFeedParser(parser, [bytes subdataWithRange:NSMakeRange(i, 1)]);
+    CFHTTPMessageRef partial = [parser copyNextRequest];
+    XCTAssertTrue(partial == NULL, @"");
+    if (partial) {
+      CFRelease(partial);
+    }
+    XCTAssertTrue([parser hasPartialRequest], @"");
+  }
+  OIDFeedParser(parser, [bytes subdataWithRange:NSMakeRange(bytes.length - 1, 1)]);
+
+  CFHTTPMessageRef request = [parser copyNextRequest];
+  XCTAssertTrue(request != NULL, @"");
+  if (!request) {
+    return;
+  }
+  NSString *method = (__bridge_transfer NSString *)CFHTTPMessageCopyRequestMethod(request);
+  NSURL *URL = (__bridge_transfer NSURL *)CFHTTPMessageCopyRequestURL(request);
+  NSString *value =
+      (__bridge_transfer NSString *)CFHTTPMessageCopyHeaderFieldValue(request, CFSTR("X-Test"));
+  CFRelease(request);
+  XCTAssertEqualObjects(method, @"GET", @"");
+  XCTAssertEqualObjects(URL.absoluteString, @"http://127.0.0.1:8080/redirect?state=a", @"");
+  XCTAssertEqualObjects(value, @"value", @"");
+  XCTAssertFalse([parser hasPartialRequest], @"");
+  XCTAssertEqual([parser errorStatusCode], 0, @"");
+}
+
+/*! @brief Tests that pipelined requests received in one read are returned one at a time, in order,
+        and that the start of the next one is kept until the rest of it arrives.
+ */
+- (void)testPipelinedRequests {
+  HTTPRequestParser *parser = [[self class] testParser];
+  OIDFeedParser(parser, OIDHTTPBytes(@"GET /first HTTP/1.1\r\nHost: h\r\n\r\n"
+                                      "POST /second HTTP/1.1\r\nHost: h\r\n"
+                                      "Content-Length: 3\r\n\r\n"
+                                      "abc"
+                                      "GET /third HTTP/1.1\r\n"));
+
+  NSMutableArray<NSString *> *paths = [NSMutableArray array];
+  NSData *secondBody;
+  CFHTTPMessageRef request;
+  while ((request = [parser copyNextRequest])) {
+    NSURL *URL = (__bridge_transfer NSURL *)CFHTTPMessageCopyRequestURL(request);
+    [paths addObject:URL.path];
+    if (paths.count == 2) {
+      secondBody = (__bridge_transfer NSData *)CFHTTPMessageCopyBody(request);
+    }
+    CFRelease(request);
+  }
+  XCTAssertEqualObjects(paths, (@[ @"/first", @"/second" ]), @"");
+  XCTAssertEqualObjects(secondBody, OIDHTTPBytes(@"abc"), @"");
+  XCTAssertTrue([parser hasPartialRequest], @"");
+  XCTAssertEqual([parser errorStatusCode], 0, @"");
+
+  OIDFeedParser(parser, OIDHTTPBytes(@"Host: h\r\n\r\n"));
+  request = [parser copyNextRequest];
+  XCTAssertTrue(request != NULL, @"");
+  if (request) {
+    NSURL *URL = (__bridge_transfer NSURL *)CFHTTPMessageCopyRequestURL(request);
+    XCTAssertEqualObjects(URL.path, @"/third", @"");
+    CFRelease(request);
+  }
+  XCTAssertFalse([parser hasPartialRequest], @"");
+}
+
+/*! @brief Tests that a chunked body is decoded, with its chunk extensions and trailers dropped,
+        when it arrives in pieces which split its framing.
+ */
+- (void)testChunkedBody {
+  HTTPRequestParser *parser = [[self class] testParser];
+  NSData *bytes = OIDHTTPBytes(@"POST / HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                "5\r\nhello\r\n"
+                                "6;name=value\r\n world\r\n"
+                                "0\r\n"
+                                "Trailer: dropped\r\n"
+                                "\r\n");
+  static const NSUInteger kPieceLength = 7;
+  CFHTTPMessageRef request = NULL;
+  for (NSUInteger offset = 0; offset < bytes.length && !request; offset += kPieceLength) {
+    NSRange piece = NSMakeRange(offset, MIN(kPieceLength, bytes.length - offset));
+    OIDFeedParser(parser, [bytes subdataWithRange:piece]);
+    request = [parser copyNextRequest];
+    XCTAssertTrue(!request || NSMaxRange(piece) == bytes.length, @"");
+  }
+  XCTAssertTrue(request != NULL, @"");
+  if (!request) {
+    return;
+  }
+  NSData *body = (__bridge_transfer NSData *)CFHTTPMessageCopyBody(request);
+  NSString *trailer =
+      (__bridge_transfer NSString *)CFHTTPMessageCopyHeaderFieldValue(request, CFSTR("Trailer"));
+  CFRelease(request);
+  XCTAssertEqualObjects(body, OIDHTTPBytes(@"hello world"), @"");
+  XCTAssertNil(trailer, @"");
+  XCTAssertFalse([parser hasPartialRequest], @"");
+}
+
+/*! @brief Tests that a request with both a Content-Length and a chunked Transfer-Encoding, whose
+        length would be ambiguous to a proxy, is rejected.
+ */
+- (void)testContentLengthWithTransferEncoding {
+  NSString *request = @"POST / HTTP/1.1\r\nHost: h\r\n"
+                       "Content-Length: 5\r\n"
+                       "Transfer-Encoding: chunked\r\n"
+                       "\r\n"
+                       "0\r\n\r\n";
+  XCTAssertEqual([self errorStatusCodeForRequest:request
+                                 maxHeaderLength:kTestMaxHeaderLength
+                                   maxBodyLength:kTestMaxBodyLength],
+                 400,
+                 @"");
+  NSString *duplicateLength = @"POST / HTTP/1.1\r\nHost: h\r\n"
+                               "Content-Length: 1\r\n"
+                               "Content-Length: 2\r\n"
+                               "\r\n";
+  XCTAssertEqual([self errorStatusCodeForRequest:duplicateLength
+                                 maxHeaderLength:kTestMaxHeaderLength
+                                   maxBodyLength:kTestMaxBodyLength],
+                 400,
+                 @"");
+}
+
+/*! @brief Tests that headers longer than the limit are answered with 431.
+ */
+- (void)testHeaderTooLong {
+  NSString *value = [@"" stringByPaddingToLength:64 withString:@"x" startingAtIndex:0];
+  NSString *request = [NSString stringWithFormat:@"GET / HTTP/1.1\r\nX-Long: %@\r\n\r\n", value];
+  XCTAssertEqual([self errorStatusCodeForRequest:request
+                                 maxHeaderLength:64
+                                   maxBodyLength:kTestMaxBodyLength],
+                 431,
+                 @"");
+}
+
+/*! @brief Tests that bodies larger than the limit are answered with 413, whether their length is
+        given up front or by their chunks.
+ */
+- (void)testBodyTooLarge {
+  NSString *request = @"POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 17\r\n\r\n";
+  XCTAssertEqual([self errorStatusCodeForRequest:request
+                                 maxHeaderLength:kTestMaxHeaderLength
+                                   maxBodyLength:16],
+                 413,
+                 @"");
+  NSString *chunkedRequest = @"POST / HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: chunked\r\n\r\n"
+                              "10\r\n0123456789abcdef\r\n"
+                              "1\r\n";
+  XCTAssertEqual([self errorStatusCodeForRequest:chunkedRequest
+                                 maxHeaderLength:kTestMaxHeaderLength
+                                   maxBodyLength:16],
+                 413,
+                 @"");
+}
+
+/*! @brief Tests that chunk framing and trailers count against the length of the request, so that a
+        small body can't be sent with any number of framing lines.
+ */
+- (void)testChunkFramingTooLong {
+  NSString *extension = [@"" stringByPaddingToLength:40 withString:@"x" startingAtIndex:0];
+  NSMutableString *request = [NSMutableString stringWithString:
+      @"POST / HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: chunked\r\n\r\n"];
+  for (NSUInteger i = 0; i < 8; i++) {
+    [request appendFormat:@"1;%@\r\na\r\n", extension];
+  }
+  XCTAssertEqual([self errorStatusCodeForRequest:request maxHeaderLength:64 maxBodyLength:16],
+                 413,
+                 @"");
+
+  NSMutableString *trailers = [NSMutableString stringWithString:
+      @"POST / HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n"];
+  for (NSUInteger i = 0; i < 8; i++) {
+    [trailers appendFormat:@"X-Trailer: %@\r\n", extension];
+  }
+  XCTAssertEqual([self errorStatusCodeForRequest:trailers maxHeaderLength:64 maxBodyLength:16],
+                 413,
+                 @"");
+}
+
+/*! @brief Tests that a request line which isn't one is answered with 400.
+ */
+- (void)testMalformedRequestLine {
+  XCTAssertEqual([self errorStatusCodeForRequest:@"GARBAGE\r\n\r\n"
+                                 maxHeaderLength:kTestMaxHeaderLength
+                                   maxBodyLength:kTestMaxBodyLength],
+                 400,
+                 @"");
+  XCTAssertEqual([self errorStatusCodeForRequest:@"GET / HTTP/1.1\r\n folded: header\r\n\r\n"
+                                 maxHeaderLength:kTestMaxHeaderLength
+                                   maxBodyLength:kTestMaxBodyLength],
+                 400,
+                 @"");
+}
+
+/*! @brief Tests that a transfer coding other than chunked is answered with 501.
+ */
+- (void)testUnsupportedTransferEncoding {
+  NSString *request = @"POST / HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: gzip\r\n\r\n";
+  XCTAssertEqual([self errorStatusCodeForRequest:request
+                                 maxHeaderLength:kTestMaxHeaderLength
+                                   maxBodyLength:kTestMaxBodyLength],
+                 501,
+                 @"");
+}
+
+#pragma mark - HTTPResponseWriter
+
+/*! @brief Tests that the bytes a socket doesn't accept at once are written when it has room again,
+        in order and without any being repeated or lost.
+ */
+- (void)testPartialWrites {
+  int fds[2];
+  XCTAssertEqual(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0, @"");
+  int bufferSize = 4096;
+  setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+  HTTPResponseWriter *writer = [[HTTPResponseWriter alloc] init];
+  NSMutableData *expected = [NSMutableData data];
+  for (NSUInteger i = 0; i < 20; i++) {
+    NSMutableData *segment = [NSMutableData dataWithLength:10000 + i];
+    memset(segment.mutableBytes, 'a' + (int)i, segment.length);
+    [writer appendData:segment];
+    [expected appendData:segment];
+  }
+
+  NSMutableData *received = [NSMutableData data];
+  BOOL wrotePartially = NO;
+  while ([writer hasPendingBytes]) {
+    BOOL written = [writer writeToSocket:fds[0]];
+    XCTAssertTrue(written, @"");
+    if (!written) {
+      break;
+    }
+    wrotePartially = wrotePartially || [writer hasPendingBytes];
+    // reads what was written, as the client would
+    uint8_t chunk[65536];
+    ssize_t length;
+    while (0 < (length = recv(fds[1], chunk, sizeof(chunk), MSG_DONTWAIT))) {
+      [received appendBytes:chunk length:(NSUInteger)length];
+    }
+  }
+  close(fds[0]);
+  close(fds[1]);
+  XCTAssertTrue(wrotePartially, @"");
+  XCTAssertEqualObjects(received, expected, @"");
+}
+
+/*! @brief Tests that writing to a socket whose peer has closed fails.
+ */
+- (void)testWriteToClosedSocket {
+  int fds[2];
+  XCTAssertEqual(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0, @"");
+  int yes = 1;
+  setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+  close(fds[1]);
+
+  HTTPResponseWriter *writer = [[HTTPResponseWriter alloc] init];
+  [writer appendData:OIDHTTPBytes(@"HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n")];
+  XCTAssertFalse([writer writeToSocket:fds[0]], @"");
+  close(fds[0]);
+}
+
+#pragma mark - HTTPEventLoop
+
+/*! @brief Tests that blocks scheduled from another thread run on the loop thread, in order.
+ */
+- (void)testEventLoopPerformsBlocksInOrder {
+  HTTPEventLoop *loop = [HTTPEventLoop sharedLoop];
+  XCTAssertNotNil(loop, @"");
+  XCTAssertFalse([loop isLoopThread], @"");
+
+  XCTestExpectation *expectation = [self expectationWithDescription:@"Blocks performed."];
+  NSMutableArray<NSNumber *> *order = [NSMutableArray array];
+  for (NSUInteger i = 0; i < 3; i++) {
+    [loop performBlock:^{
+      XCTAssertTrue([loop isLoopThread], @"");
+      [order addObject:@(i)];
+      if (i == 2) {
+        [expectation fulfill];
+      }
+    }];
+  }
+  [self waitForExpectationsWithTimeout:kTestResponseTimeout handler:nil];
+  XCTAssertEqualObjects(order, (@[ @0, @1, @2 ]), @"");
+}
+
+#pragma mark - HTTPServer
+
+/*! @brief Returns a server listening on a kernel-chosen port, configured before it starts. As it
+        has no delegate, it answers every request with its default response.
+ */
+- (HTTPServer *)startedServerWithConfiguration:(void (^)(HTTPServer *server))configuration {
+  HTTPServer *server = [[HTTPServer alloc] init];
+  if (configuration) {
+    configuration(server);
+  }
+  NSError *error;
+  XCTAssertTrue([server start:&error], @"%@", error);
+  XCTAssertTrue([server hasIPv4Socket], @"");
+  return server;
+}
+
+/*! @brief Tests that connections over @c maxConnections wait in the listen backlog, unanswered,
+        until a connection being served closes.
+ */
+- (void)testConnectionsOverTheLimitWait {
+  HTTPServer *server = [self startedServerWithConfiguration:^(HTTPServer *server) {
+    [server setMaxConnections:1];
+  }];
+  NSString *request = @"GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+
+  int first = OIDConnectToLoopbackPort([server port]);
+  XCTAssertGreaterThanOrEqual(first, 0, @"");
+  XCTAssertTrue(OIDSendRequest(first, request), @"");
+  NSString *response = OIDReceiveResponseHeader(first);
+  XCTAssertTrue([response hasPrefix:@"HTTP/1.1 500"], @"%@", response);
+
+  // the first connection is kept alive, so the second one isn't accepted, nor closed
+  int second = OIDConnectToLoopbackPort([server port]);
+  XCTAssertGreaterThanOrEqual(second, 0, @"");
+  XCTAssertTrue(OIDSendRequest(second, request), @"");
+  OIDSetReceiveTimeout(second, 0.5);
+  BOOL closed = YES;
+  response = OIDReceiveUntilClosed(second, &closed);
+  XCTAssertFalse(closed, @"");
+  XCTAssertEqualObjects(response, @"", @"");
+
+  // once the first connection closes, the second one is accepted and answered
+  close(first);
+  OIDSetReceiveTimeout(second, kTestResponseTimeout);
+  response = OIDReceiveResponseHeader(second);
+  XCTAssertTrue([response hasPrefix:@"HTTP/1.1 500"], @"%@", response);
+  close(second);
+  [server stop];
+}
+
+/*! @brief Tests that a connection which sends nothing is closed after @c idleTimeout.
+ */
+- (void)testIdleConnectionIsClosed {
+  HTTPServer *server = [self startedServerWithConfiguration:^(HTTPServer *server) {
+    [server setIdleTimeout:0.2];
+  }];
+  int fd = OIDConnectToLoopbackPort([server port]);
+  XCTAssertGreaterThanOrEqual(fd, 0, @"");
+  BOOL closed = NO;
+  NSString *response = OIDReceiveUntilClosed(fd, &closed);
+  XCTAssertTrue(closed, @"");
+  XCTAssertEqualObjects(response, @"", @"");
+  close(fd);
+  [server stop];
+}
+
+/*! @brief Tests that a connection which starts a request and doesn't finish it is closed after
+        @c headerTimeout, even though the idle timeout is longer than the test waits.
+ */
+- (void)testIncompleteRequestIsClosed {
+  HTTPServer *server = [self startedServerWithConfiguration:^(HTTPServer *server) {
+    [server setIdleTimeout:kTestResponseTimeout * 2];
+    [server setHeaderTimeout:0.2];
+  }];
+  int fd = OIDConnectToLoopbackPort([server port]);
+  XCTAssertGreaterThanOrEqual(fd, 0, @"");
+  XCTAssertTrue(OIDSendRequest(fd, @"GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n"), @"");
+  BOOL closed = NO;
+  NSString *response = OIDReceiveUntilClosed(fd, &closed);
+  XCTAssertTrue(closed, @"");
+  XCTAssertEqualObjects(response, @"", @"");
+  close(fd);
+  [server stop];
+}
+
+/*! @brief Tests that the connection is closed after the response to an HTTP/1.0 request, and to
+        one which asks for it with a Connection header, but kept open otherwise.
+ */
+- (void)testConnectionIsClosedWhenRequested {
+  HTTPServer *server = [self startedServerWithConfiguration:nil];
+  NSArray<NSString *> *requests = @[
+    @"GET / HTTP/1.0\r\n\r\n",
+    @"GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n",
+    @"GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive, close\r\n\r\n",
+  ];
+  for (NSString *request in requests) {
+    int fd = OIDConnectToLoopbackPort([server port]);
+    XCTAssertGreaterThanOrEqual(fd, 0, @"");
+    XCTAssertTrue(OIDSendRequest(fd, request), @"");
+    BOOL closed = NO;
+    NSString *response = OIDReceiveUntilClosed(fd, &closed);
+    XCTAssertTrue(closed, @"%@", request);
+    XCTAssertTrue([response hasPrefix:@"HTTP/1."], @"%@", response);
+    close(fd);
+  }
+
+  int fd = OIDConnectToLoopbackPort([server port]);
+  XCTAssertGreaterThanOrEqual(fd, 0, @"");
+  XCTAssertTrue(OIDSendRequest(fd, @"GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"), @"");
+  NSString *response = OIDReceiveResponseHeader(fd);
+  XCTAssertTrue([response hasPrefix:@"HTTP/1.1 500"], @"%@", response);
+  OIDSetReceiveTimeout(fd, 0.5);
+  BOOL closed = YES;
+  OIDReceiveUntilClosed(fd, &closed);
+  XCTAssertFalse(closed, @"");
+  close(fd);
+  [server stop];
+}
+
+#pragma mark - TCPServer
+
+/*! @brief Tests that a listener given a port range moves past a port that is already taken.
+ */
+- (void)testPortRangeSkipsTakenPort {
+  int taken = OIDCreateBoundSocket(INADDR_LOOPBACK, YES);
+  XCTAssertGreaterThanOrEqual(taken, 0, @"");
+  uint16_t takenPort = OIDBoundPort(taken);
+  NSRange range = NSMakeRange(takenPort, MIN((NSUInteger)8, (NSUInteger)UINT16_MAX - takenPort));
+  XCTAssertGreaterThan(range.length, (NSUInteger)1, @"");
+
+  HTTPServer *server = [[HTTPServer alloc] init];
+  [server setPortRange:range];
+  NSError *error;
+  XCTAssertTrue([server start:&error], @"%@", error);
+  XCTAssertNotEqual([server port], takenPort, @"");
+  XCTAssertTrue(NSLocationInRange([server port], range), @"");
+  [server stop];
+  close(taken);
+}
+
+/*! @brief Tests that a socket already listening on the loopback interface is adopted, and that
+        connections to it are served.
+ */
+- (void)testStartWithListeningSocket {
+  int fd = OIDCreateBoundSocket(INADDR_LOOPBACK, YES);
+  XCTAssertGreaterThanOrEqual(fd, 0, @"");
+  uint16_t port = OIDBoundPort(fd);
+
+  HTTPServer *server = [[HTTPServer alloc] init];
+  NSError *error;
+  XCTAssertTrue([server startWithListeningSocket:fd error:&error], @"%@", error);
+  XCTAssertEqual([server port], port, @"");
+  XCTAssertTrue([server hasIPv4Socket], @"");
+  XCTAssertFalse([server hasIPv6Socket], @"");
+
+  NSString *response = OIDExchangeLoopbackBytes(port, @"GET / HTTP/1.1\r\n"
+                                                       "Host: 127.0.0.1\r\n"
+                                                       "Connection: close\r\n"
+                                                       "\r\n");
+  XCTAssertTrue([response hasPrefix:@"HTTP/1.1 500"], @"%@", response);
+  // the server owns the socket now
+  [server stop];
+}
+
+/*! @brief Tests that a socket which isn't listening, or isn't bound to the loopback interface, is
+        rejected and left to the caller.
+ */
+- (void)testStartWithUnsuitableSocket {
+  int notListening = OIDCreateBoundSocket(INADDR_LOOPBACK, NO);
+  int notLoopback = OIDCreateBoundSocket(INADDR_ANY, YES);
+  for (NSNumber *descriptor in @[ @(notListening), @(notLoopback) ]) {
+    int fd = descriptor.intValue;
+    XCTAssertGreaterThanOrEqual(fd, 0, @"");
+    HTTPServer *server = [[HTTPServer alloc] init];
+    NSError *error;
+    XCTAssertFalse([server startWithListeningSocket:fd error:&error], @"");
+    XCTAssertEqualObjects(error.domain, TCPServerErrorDomain, @"");
+    XCTAssertEqual(error.code, kTCPServerNoSocketsAvailable, @"");
+    XCTAssertFalse([server hasIPv4Socket], @"");
+    // the socket is still open
+    XCTAssertNotEqual(fcntl(fd, F_GETFD), -1, @"");
+    close(fd);
+  }
+}
+
+#pragma mark - EkoOIDRedirectHTTPHandler
+
+/*! @brief Sends bytes to the handler's listener on a background queue, and returns its response
+        once it closes the connection, waiting for every other expectation of the test as well.
+ */
+- (NSString *)responseFromHandler:(EkoOIDRedirectHTTPHandler *)handler
+                         toRequest:(NSString *)request {
+  uint16_t port = handler.listenerURL.port.unsignedShortValue;
+  XCTestExpectation *expectation = [self expectationWithDescription:@"Response received."];
+  __block NSString *response;
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    response = OIDExchangeLoopbackBytes(port, request);
+    [expectation fulfill];
+  });
+  // the handler is called on the main thread, which runs while waiting
+  [self waitForExpectationsWithTimeout:kTestResponseTimeout handler:nil];
+  return response;
+}
+
+/*! @brief Tests that redirects are routed to the session registered for their state, and that the
+        listener keeps running, and keeps its sessions, until the last one is done.
+ */
+- (void)testRedirectsAreRoutedByState {
+  EkoOIDRedirectHTTPHandler *handler = [[EkoOIDRedirectHTTPHandler alloc] initWithSuccessURL:nil];
+  NSError *error;
+  NSURL *listenerURL = [handler startHTTPListener:&error];
+  XCTAssertNotNil(listenerURL, @"%@", error);
+  XCTAssertEqualObjects(handler.listenerURL, listenerURL, @"");
+
+  OIDLoopbackTestSession *first = [[OIDLoopbackTestSession alloc] init];
+  OIDLoopbackTestSession *second = [[OIDLoopbackTestSession alloc] init];
+  [handler addAuthorizationFlow:first forState:@"first"];
+  [handler addAuthorizationFlow:second forState:@"second"];
+
+  // reusing the running listener keeps the registered sessions
+  XCTAssertEqualObjects([handler startHTTPListener:&error], listenerURL, @"");
+  XCTAssertNil(first.error, @"");
+  XCTAssertNil(second.error, @"");
+
+  second.resumeExpectation = [self expectationWithDescription:@"Second session resumed."];
+  NSString *response = [self responseFromHandler:handler
+                                       toRequest:@"GET /?code=c&state=second HTTP/1.1\r\n"
+                                                  "Host: 127.0.0.1\r\n"
+                                                  "Connection: close\r\n"
+                                                  "\r\n"];
+  XCTAssertTrue([response hasPrefix:@"HTTP/1.1 200"], @"%@", response);
+  XCTAssertTrue([second.resumedURL.query containsString:@"state=second"], @"");
+  XCTAssertNil(first.resumedURL, @"");
+  XCTAssertEqualObjects(handler.listenerURL, listenerURL, @"");
+
+  // the second session was removed once it handled its redirect
+  response = [self responseFromHandler:handler
+                             toRequest:@"GET /?code=c&state=second HTTP/1.1\r\n"
+                                        "Host: 127.0.0.1\r\n"
+                                        "Connection: close\r\n"
+                                        "\r\n"];
+  XCTAssertTrue([response hasPrefix:@"HTTP/1.1 404"], @"%@", response);
+
+  [handler cancelHTTPListener];
+  XCTAssertEqualObjects(first.error.domain, EkoOIDGeneralErrorDomain, @"");
+  XCTAssertEqual(first.error.code, EkoOIDErrorCodeProgramCanceledAuthorizationFlow, @"");
+  XCTAssertNil(second.error, @"");
+  XCTAssertNil(handler.listenerURL, @"");
+}
+
+/*! @brief Tests that pipelined requests on one connection are answered in order.
+ */
+- (void)testPipelinedRedirects {
+  EkoOIDRedirectHTTPHandler *handler = [[EkoOIDRedirectHTTPHandler alloc] initWithSuccessURL:nil];
+  NSError *error;
+  XCTAssertNotNil([handler startHTTPListener:&error], @"%@", error);
+  OIDLoopbackTestSession *session = [[OIDLoopbackTestSession alloc] init];
+  OIDLoopbackTestSession *otherSession = [[OIDLoopbackTestSession alloc] init];
+  [handler addAuthorizationFlow:session forState:@"state"];
+  [handler addAuthorizationFlow:otherSession forState:@"other"];
+  session.resumeExpectation = [self expectationWithDescription:@"Session resumed."];
+
+  NSString *response = [self responseFromHandler:handler
+                                       toRequest:@"GET /?state=state HTTP/1.1\r\n"
+                                                  "Host: 127.0.0.1\r\n"
+                                                  "\r\n"
+                                                  "GET /?state=unknown HTTP/1.1\r\n"
+                                                  "Host: 127.0.0.1\r\n"
+                                                  "Connection: close\r\n"
+                                                  "\r\n"];
+  NSRange handled = [response rangeOfString:@"HTTP/1.1 200"];
+  NSRange notHandled = [response rangeOfString:@"HTTP/1.1 404"];
+  XCTAssertEqual(handled.location, (NSUInteger)0, @"%@", response);
+  XCTAssertNotEqual(notHandled.location, NSNotFound, @"%@", response);
+  XCTAssertGreaterThan(notHandled.location, handled.location, @"");
+  XCTAssertNil(otherSession.resumedURL, @"");
+  [handler cancelHTTPListener];
+}
+
+/*! @brief Tests that a request the listener can't parse is answered with the error, and that the
+        connection is then closed.
+ */
+- (void)testMalformedRequestIsAnswered {
+  EkoOIDRedirectHTTPHandler *handler = [[EkoOIDRedirectHTTPHandler alloc] initWithSuccessURL:nil];
+  NSError *error;
+  XCTAssertNotNil([handler startHTTPListener:&error], @"%@", error);
+  NSString *response = [self responseFromHandler:handler toRequest:@"GARBAGE\r\n\r\n"];
+  XCTAssertTrue([response hasPrefix:@"HTTP/1.1 400"], @"%@", response);
+  XCTAssertTrue([response containsString:@"Connection: close"], @"%@", response);
+  [handler cancelHTTPListener];
+}
+
+@end
+
+#pragma GCC diagnostic pop
+
+#endif // TARGET_OS_OSX && !SWIFT_PACKAGE
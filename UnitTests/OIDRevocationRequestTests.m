@@ -0,0 +1,163 @@
+/*! @file OIDRevocationRequestTests.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "OIDTestURLProtocol.h"
+
+#if SWIFT_PACKAGE
+@import AppAuthCore;
+#else
+#import "Source/AppAuthCore/OIDAuthorizationService.h"
+#import "Source/AppAuthCore/OIDError.h"
+#import "Source/AppAuthCore/OIDRevocationRequest.h"
+#import "Source/AppAuthCore/OIDURLSessionProvider.h"
+#endif
+
+// Ignore warnings about "Use of GNU statement expression extension" which is raised by our use of
+// the XCTAssert___ macros.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wgnu"
+
+/*! @brief Test value for the @c revocationEndpoint property.
+ */
+static NSString *const kTestRevocationEndpoint = @"https://www.example.com/revoke";
+
+/*! @brief Unit tests for @c EkoOIDRevocationRequest.
+ */
+@interface OIDRevocationRequestTests : XCTestCase
+@end
+@implementation OIDRevocationRequestTests
+
+- (void)tearDown {
+  [EkoOIDURLSessionProvider setSession:[NSURLSession sharedSession]];
+  [OIDTestURLProtocol removeHandler];
+  [super tearDown];
+}
+
+/*! @brief Tests the request of a public client, which sends its identifier in the body.
+ */
+- (void)testURLRequestNoClientAuth {
+  EkoOIDRevocationRequest *request = [[EkoOIDRevocationRequest alloc]
+      initWithRevocationEndpoint:[NSURL URLWithString:kTestRevocationEndpoint]
+                           token:@"a+b"
+                   tokenTypeHint:EkoOIDTokenTypeHintRefreshToken
+                        clientID:@"client"
+                    clientSecret:nil
+            additionalParameters:nil];
+  NSURLRequest *URLRequest = [request URLRequest];
+  NSString *body = [[NSString alloc] initWithData:URLRequest.HTTPBody
+                                         encoding:NSUTF8StringEncoding];
+
+  XCTAssertEqualObjects(URLRequest.URL.absoluteString, kTestRevocationEndpoint, @"");
+  XCTAssertEqualObjects(URLRequest.HTTPMethod, @"POST", @"");
+  XCTAssertEqualObjects(body, @"token=a%2Bb&token_type_hint=refresh_token&client_id=client", @"");
+  XCTAssertNil([URLRequest valueForHTTPHeaderField:@"Authorization"], @"");
+}
+
+/*! @brief Tests the request of a confidential client, which authenticates with HTTP Basic.
+ */
+- (void)testURLRequestBasicClientAuth {
+  EkoOIDRevocationRequest *request = [[EkoOIDRevocationRequest alloc]
+      initWithRevocationEndpoint:[NSURL URLWithString:kTestRevocationEndpoint]
+                           token:@"token"
+                   tokenTypeHint:nil
+                        clientID:@"client"
+                    clientSecret:@"secret"
+            additionalParameters:nil];
+  NSURLRequest *URLRequest = [request URLRequest];
+  NSString *body = [[NSString alloc] initWithData:URLRequest.HTTPBody
+                                         encoding:NSUTF8StringEncoding];
+
+  XCTAssertEqualObjects(body, @"token=token", @"");
+  XCTAssertNotNil([URLRequest valueForHTTPHeaderField:@"Authorization"], @"");
+}
+
+/*! @brief Tests that a batch keeps no more than @c maxConcurrentRequests requests in flight, calls
+        back once when every request is done, and keys each failure by the index of its request.
+ */
+- (void)testBatchRevocation {
+  // the server rejects token-2, and the connection fails for token-7
+  [EkoOIDURLSessionProvider setSession:[OIDTestURLProtocol
+      sessionWithHandler:^id(NSURLRequest *request, NSString *body, NSInteger *statusCode) {
+        if ([body containsString:@"token=token-2&"]) {
+          *statusCode = 400;
+          return @{ @"error" : @"unsupported_token_type" };
+        }
+        if ([body containsString:@"token=token-7&"]) {
+          return nil;
+        }
+        return @{ };
+      }
+           responseDelay:0.05]];
+
+  NSMutableArray<EkoOIDRevocationRequest *> *requests = [NSMutableArray array];
+  for (NSUInteger i = 0; i < 10; i++) {
+    [requests addObject:[[EkoOIDRevocationRequest alloc]
+        initWithRevocationEndpoint:[NSURL URLWithString:kTestRevocationEndpoint]
+                             token:[NSString stringWithFormat:@"token-%lu", (unsigned long)i]
+                     tokenTypeHint:nil
+                          clientID:@"client"
+                      clientSecret:nil
+              additionalParameters:nil]];
+  }
+
+  XCTestExpectation *expectation = [self expectationWithDescription:@"Batch completed."];
+  __block NSUInteger callbackCount = 0;
+  __block NSDictionary<NSNumber *, NSError *> *batchErrors;
+  EkoOIDBatchRevocationCallback callback = ^(NSDictionary<NSNumber *, NSError *> *errors) {
+    XCTAssertTrue([NSThread isMainThread], @"");
+    callbackCount++;
+    batchErrors = errors;
+    [expectation fulfill];
+  };
+  [EkoOIDAuthorizationService performRevocationRequests:requests
+                                  maxConcurrentRequests:3
+                                               callback:callback];
+  [self waitForExpectationsWithTimeout:5 handler:nil];
+  // gives a second callback the time to arrive, if there were one
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+
+  XCTAssertEqual(callbackCount, (NSUInteger)1, @"");
+  XCTAssertEqual([OIDTestURLProtocol requestCount], requests.count, @"");
+  XCTAssertLessThanOrEqual([OIDTestURLProtocol maxConcurrentRequestCount], (NSUInteger)3, @"");
+  XCTAssertGreaterThan([OIDTestURLProtocol maxConcurrentRequestCount], (NSUInteger)1, @"");
+  NSSet<NSNumber *> *failedIndexes = [NSSet setWithArray:@[ @2, @7 ]];
+  XCTAssertEqualObjects([NSSet setWithArray:batchErrors.allKeys], failedIndexes, @"");
+  XCTAssertEqualObjects(batchErrors[@2].domain, EkoOIDOAuthTokenErrorDomain, @"");
+  XCTAssertEqualObjects(batchErrors[@7].domain, EkoOIDGeneralErrorDomain, @"");
+  XCTAssertEqual(batchErrors[@7].code, EkoOIDErrorCodeNetworkError, @"");
+}
+
+/*! @brief Tests that an empty batch calls back with no errors.
+ */
+- (void)testEmptyBatchRevocation {
+  XCTestExpectation *expectation = [self expectationWithDescription:@"Batch completed."];
+  EkoOIDBatchRevocationCallback callback = ^(NSDictionary<NSNumber *, NSError *> *errors) {
+    XCTAssertEqualObjects(errors, @{ }, @"");
+    [expectation fulfill];
+  };
+  [EkoOIDAuthorizationService performRevocationRequests:@[]
+                                  maxConcurrentRequests:3
+                                               callback:callback];
+  [self waitForExpectationsWithTimeout:2 handler:nil];
+}
+
+@end
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,126 @@
+/*! @file OIDScopeSetTests.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#if SWIFT_PACKAGE
+@import AppAuthCore;
+#else
+#import "Source/AppAuthCore/OIDScopeSet.h"
+#endif
+
+// Ignore warnings about "Use of GNU statement expression extension" which is raised by our use of
+// the XCTAssert___ macros.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wgnu"
+
+/*! @brief Unit tests for @c EkoOIDScopeSet.
+ */
+@interface OIDScopeSetTests : XCTestCase
+@end
+@implementation OIDScopeSetTests
+
+/*! @brief Tests that equal sets are the same instance, however they were created.
+ */
+- (void)testInterning {
+  EkoOIDScopeSet *fromString = [EkoOIDScopeSet scopeSetWithString:@"openid  profile email"];
+  EkoOIDScopeSet *fromArray =
+      [EkoOIDScopeSet scopeSetWithArray:@[ @"email", @"openid", @"profile" ]];
+  XCTAssertEqual(fromString, fromArray);
+  XCTAssertEqual(fromString.count, 3);
+  XCTAssertEqual([EkoOIDScopeSet scopeSetWithString:nil], [EkoOIDScopeSet emptyScopeSet]);
+  XCTAssertEqual([EkoOIDScopeSet scopeSetWithString:@" "], [EkoOIDScopeSet emptyScopeSet]);
+  XCTAssertEqual([EkoOIDScopeSet emptyScopeSet].count, 0);
+  XCTAssertEqualObjects([EkoOIDScopeSet emptyScopeSet].scopeString, @"");
+}
+
+/*! @brief Tests membership and subset checks.
+ */
+- (void)testSubsets {
+  EkoOIDScopeSet *granted = [EkoOIDScopeSet scopeSetWithString:@"openid profile email"];
+  EkoOIDScopeSet *required = [EkoOIDScopeSet scopeSetWithString:@"email openid"];
+  EkoOIDScopeSet *other = [EkoOIDScopeSet scopeSetWithString:@"email phone"];
+
+  XCTAssertTrue([granted containsScope:@"profile"]);
+  XCTAssertFalse([granted containsScope:@"phone"]);
+  XCTAssertFalse([granted containsScope:@"OIDScopeSetTests-unregistered"]);
+  XCTAssertTrue([required isSubsetOfScopeSet:granted]);
+  XCTAssertFalse([granted isSubsetOfScopeSet:required]);
+  XCTAssertFalse([other isSubsetOfScopeSet:granted]);
+  XCTAssertTrue([[EkoOIDScopeSet emptyScopeSet] isSubsetOfScopeSet:required]);
+}
+
+/*! @brief Tests unions, including of sets whose bitsets span several words.
+ */
+- (void)testUnion {
+  NSMutableArray<NSString *> *manyScopes = [NSMutableArray array];
+  for (NSUInteger i = 0; i < 200; i++) {
+    [manyScopes addObject:[NSString stringWithFormat:@"OIDScopeSetTests-%lu", (unsigned long)i]];
+  }
+  EkoOIDScopeSet *many = [EkoOIDScopeSet scopeSetWithArray:manyScopes];
+  EkoOIDScopeSet *few = [EkoOIDScopeSet scopeSetWithString:@"openid email"];
+
+  EkoOIDScopeSet *both = [few scopeSetByAddingScopeSet:many];
+  XCTAssertEqual(both, [many scopeSetByAddingScopeSet:few]);
+  XCTAssertEqual(both.count, 202);
+  XCTAssertTrue([many isSubsetOfScopeSet:both]);
+  XCTAssertTrue([few isSubsetOfScopeSet:both]);
+  XCTAssertEqual([few scopeSetByAddingScopeSet:[EkoOIDScopeSet emptyScopeSet]], few);
+  XCTAssertEqual([EkoOIDScopeSet scopeSetWithString:both.scopeString], both);
+}
+
+/*! @brief Tests that once the scope registry is full, new scopes are still held, compared,
+        combined and interned as if they were registered.
+ */
+- (void)testScopesBeyondRegistryCapacity {
+  // More new scopes than the registry can ever hold, so at least the last ones aren't registered.
+  NSMutableArray<NSString *> *manyScopes = [NSMutableArray array];
+  for (NSUInteger i = 0; i < 1100; i++) {
+    [manyScopes addObject:[NSString stringWithFormat:@"OIDScopeSetTests-capacity-%lu",
+                                                     (unsigned long)i]];
+  }
+  EkoOIDScopeSet *many = [EkoOIDScopeSet scopeSetWithArray:manyScopes];
+  XCTAssertEqual(many.count, 1100);
+  XCTAssertEqualObjects([NSSet setWithArray:many.scopes], [NSSet setWithArray:manyScopes]);
+  XCTAssertTrue([many containsScope:manyScopes.lastObject]);
+  XCTAssertFalse([many containsScope:@"OIDScopeSetTests-capacity-other"]);
+  XCTAssertEqual([EkoOIDScopeSet scopeSetWithArray:manyScopes.reverseObjectEnumerator.allObjects],
+                 many);
+  XCTAssertEqual([EkoOIDScopeSet scopeSetWithString:many.scopeString], many);
+
+  EkoOIDScopeSet *last =
+      [EkoOIDScopeSet scopeSetWithArray:@[ manyScopes.lastObject, @"openid" ]];
+  EkoOIDScopeSet *other =
+      [EkoOIDScopeSet scopeSetWithString:@"OIDScopeSetTests-capacity-other openid"];
+  XCTAssertNotEqual(last, other);
+  XCTAssertFalse([last isSubsetOfScopeSet:many]);
+  XCTAssertFalse([other isSubsetOfScopeSet:last]);
+  XCTAssertTrue([[EkoOIDScopeSet scopeSetWithString:@"openid"] isSubsetOfScopeSet:last]);
+
+  EkoOIDScopeSet *both = [last scopeSetByAddingScopeSet:many];
+  XCTAssertEqual(both, [many scopeSetByAddingScopeSet:last]);
+  XCTAssertEqual(both.count, 1101);
+  XCTAssertTrue([last isSubsetOfScopeSet:both]);
+  XCTAssertTrue([many isSubsetOfScopeSet:both]);
+  XCTAssertFalse([both isSubsetOfScopeSet:many]);
+  XCTAssertEqual([last scopeSetByAddingScopeSet:other].count, 3);
+}
+
+@end
+
+#pragma GCC diagnostic pop
@@ -384,6 +384,23 @@ static NSString *const kIssuerTestExpectedFullDiscoveryURL =
   XCTAssertEqualObjects(configuration.registrationEndpoint, unarchived.registrationEndpoint, @"");
 }
 
+/*! @brief Tests that equal configurations, whether initialized or decoded, share one instance.
+ */
+- (void)testSharedInstances {
+  EkoOIDServiceConfiguration *configuration = [[self class] testInstance];
+  XCTAssertEqual(configuration, [[self class] testInstance], @"");
+
+  NSData *data = [NSKeyedArchiver archivedDataWithRootObject:configuration];
+  XCTAssertEqual(configuration, [NSKeyedUnarchiver unarchiveObjectWithData:data], @"");
+
+  NSURL *otherTokenEndpoint = [NSURL URLWithString:@"https://other.test/token"];
+  EkoOIDServiceConfiguration *other =
+      [[EkoOIDServiceConfiguration alloc]
+          initWithAuthorizationEndpoint:configuration.authorizationEndpoint
+                          tokenEndpoint:otherTokenEndpoint];
+  XCTAssertNotEqual(configuration, other, @"");
+}
+
 @end
 
 #pragma GCC diagnostic pop
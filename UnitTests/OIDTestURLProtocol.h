@@ -0,0 +1,63 @@
+/*! @file OIDTestURLProtocol.h
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! @brief Returns the JSON object to answer a request with, and sets its HTTP status code, which
+        is 200 unless set otherwise; or returns nil to fail the request with a network error.
+    @param request The request.
+    @param body The body of the request, as a string.
+    @param statusCode The HTTP status code of the response.
+    @discussion Called on the URL loading system's threads.
+ */
+typedef id _Nullable (^OIDTestURLProtocolHandler)(NSURLRequest *request,
+                                                   NSString *body,
+                                                   NSInteger *statusCode);
+
+/*! @brief A URL protocol which answers the requests of the sessions it returns with a handler,
+        so that tests can stub the network requests made through @c EkoOIDURLSessionProvider.
+    @discussion One handler is installed at a time. The protocol also keeps count of the requests
+        it answers, and of how many of them were in flight at once.
+ */
+@interface OIDTestURLProtocol : NSURLProtocol
+
+/*! @brief Installs @c handler, resets the counts, and returns a session whose requests are
+        answered by @c handler.
+    @param handler Answers the requests.
+    @param delay How long each response is held back, so that requests overlap.
+ */
++ (NSURLSession *)sessionWithHandler:(OIDTestURLProtocolHandler)handler
+                       responseDelay:(NSTimeInterval)delay;
+
+/*! @brief Removes the installed handler.
+ */
++ (void)removeHandler;
+
+/*! @brief The number of requests answered since the handler was installed.
+ */
++ (NSUInteger)requestCount;
+
+/*! @brief The most requests which were in flight at once since the handler was installed.
+ */
++ (NSUInteger)maxConcurrentRequestCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
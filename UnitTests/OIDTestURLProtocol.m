@@ -0,0 +1,143 @@
+/*! @file OIDTestURLProtocol.m
+    @brief AppAuth iOS SDK
+    @copyright
+        Copyright 2015 Google Inc. All Rights Reserved.
+    @copydetails
+        Licensed under the Apache License, Version 2.0 (the "License");
+        you may not use this file except in compliance with the License.
+        You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+        Unless required by applicable law or agreed to in writing, software
+        distributed under the License is distributed on an "AS IS" BASIS,
+        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+        See the License for the specific language governing permissions and
+        limitations under the License.
+ */
+
+#import "OIDTestURLProtocol.h"
+
+/*! @brief The installed handler. Guarded by the @c OIDTestURLProtocol class.
+ */
+static OIDTestURLProtocolHandler gHandler;
+
+/*! @brief How long each response is held back. Guarded by the @c OIDTestURLProtocol class.
+ */
+static NSTimeInterval gResponseDelay;
+
+/*! @brief The request counts. Guarded by the @c OIDTestURLProtocol class.
+ */
+static NSUInteger gRequestCount;
+static NSUInteger gConcurrentRequestCount;
+static NSUInteger gMaxConcurrentRequestCount;
+
+/*! @brief Returns the body of a request, which the URL loading system may have turned into a
+        stream by the time the request reaches a protocol.
+ */
+static NSString *OIDTestURLRequestBody(NSURLRequest *request) {
+  NSData *body = request.HTTPBody;
+  if (!body && request.HTTPBodyStream) {
+    NSMutableData *streamedBody = [NSMutableData data];
+    NSInputStream *stream = request.HTTPBodyStream;
+    [stream open];
+    uint8_t buffer[4096];
+    NSInteger length;
+    while ((length = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+      [streamedBody appendBytes:buffer length:(NSUInteger)length];
+    }
+    [stream close];
+    body = streamedBody;
+  }
+  return [[NSString alloc] initWithData:body ?: [NSData data] encoding:NSUTF8StringEncoding];
+}
+
+@implementation OIDTestURLProtocol
+
++ (NSURLSession *)sessionWithHandler:(OIDTestURLProtocolHandler)handler
+                       responseDelay:(NSTimeInterval)delay {
+  @synchronized(self) {
+    gHandler = [handler copy];
+    gResponseDelay = delay;
+    gRequestCount = 0;
+    gConcurrentRequestCount = 0;
+    gMaxConcurrentRequestCount = 0;
+  }
+  NSURLSessionConfiguration *configuration =
+      [NSURLSessionConfiguration ephemeralSessionConfiguration];
+  configuration.protocolClasses = @[ self ];
+  return [NSURLSession sessionWithConfiguration:configuration];
+}
+
++ (void)removeHandler {
+  @synchronized(self) {
+    gHandler = nil;
+  }
+}
+
++ (NSUInteger)requestCount {
+  @synchronized(self) {
+    return gRequestCount;
+  }
+}
+
++ (NSUInteger)maxConcurrentRequestCount {
+  @synchronized(self) {
+    return gMaxConcurrentRequestCount;
+  }
+}
+
+#pragma mark - NSURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+  return YES;
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+  return request;
+}
+
+- (void)startLoading {
+  OIDTestURLProtocolHandler handler;
+  NSTimeInterval delay;
+  @synchronized([self class]) {
+    handler = gHandler;
+    delay = gResponseDelay;
+    gRequestCount++;
+    gConcurrentRequestCount++;
+    gMaxConcurrentRequestCount = MAX(gMaxConcurrentRequestCount, gConcurrentRequestCount);
+  }
+
+  NSInteger statusCode = 200;
+  id JSON = handler ? handler(self.request, OIDTestURLRequestBody(self.request), &statusCode) : nil;
+  dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC));
+  dispatch_after(when, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    // counts the request as done before the client can start another one in its completion
+    @synchronized([self class]) {
+      gConcurrentRequestCount--;
+    }
+    if (!JSON) {
+      [self.client URLProtocol:self
+              didFailWithError:[NSError errorWithDomain:NSURLErrorDomain
+                                                   code:NSURLErrorNotConnectedToInternet
+                                               userInfo:nil]];
+      return;
+    }
+    NSHTTPURLResponse *response =
+        [[NSHTTPURLResponse alloc] initWithURL:self.request.URL
+                                    statusCode:statusCode
+                                   HTTPVersion:@"HTTP/1.1"
+                                  headerFields:@{ @"Content-Type" : @"application/json" }];
+    [self.client URLProtocol:self
+          didReceiveResponse:response
+          cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocol:self
+                 didLoadData:[NSJSONSerialization dataWithJSONObject:JSON options:0 error:NULL]];
+    [self.client URLProtocolDidFinishLoading:self];
+  });
+}
+
+- (void)stopLoading {
+}
+
+@end
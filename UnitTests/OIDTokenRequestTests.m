@@ -20,15 +20,19 @@
 
 #import "OIDAuthorizationResponseTests.h"
 #import "OIDServiceConfigurationTests.h"
+#import "OIDTestURLProtocol.h"
 
 #if SWIFT_PACKAGE
 @import AppAuthCore;
 #else
 #import "Source/AppAuthCore/OIDAuthorizationRequest.h"
 #import "Source/AppAuthCore/OIDAuthorizationResponse.h"
+#import "Source/AppAuthCore/OIDAuthorizationService.h"
 #import "Source/AppAuthCore/OIDScopeUtilities.h"
 #import "Source/AppAuthCore/OIDServiceConfiguration.h"
 #import "Source/AppAuthCore/OIDTokenRequest.h"
+#import "Source/AppAuthCore/OIDTokenResponse.h"
+#import "Source/AppAuthCore/OIDURLSessionProvider.h"
 #endif
 
 // Ignore warnings about "Use of GNU statement expression extension" which is raised by our use of
@@ -50,6 +54,12 @@ static NSString *const kTestAdditionalParameterValue = @"1";
 
 @implementation OIDTokenRequestTests
 
+- (void)tearDown {
+  [EkoOIDURLSessionProvider setSession:[NSURLSession sharedSession]];
+  [OIDTestURLProtocol removeHandler];
+  [super tearDown];
+}
+
 + (OIDTokenRequest *)testInstance {
   OIDAuthorizationResponse *authResponse = [OIDAuthorizationResponseTests testInstance];
   NSArray<NSString *> *scopesArray =
@@ -242,6 +252,167 @@ static NSString *const kTestAdditionalParameterValue = @"1";
   XCTAssertNotNil(authorization);
 }
 
+/*! @brief Tests that a token exchange request sends the subject token and audience.
+ */
+- (void)testTokenExchange {
+  EkoOIDServiceConfiguration *configuration = [OIDServiceConfigurationTests testInstance];
+  EkoOIDTokenRequest *request =
+      [[EkoOIDTokenRequest alloc] initWithConfiguration:configuration
+                                               clientID:@"client"
+                                           clientSecret:nil
+                                           subjectToken:@"subject"
+                                       subjectTokenType:EkoOIDTokenTypeAccessToken
+                                               audience:@"orders"
+                                                  scope:@"read"
+                                   additionalParameters:nil];
+  XCTAssertEqualObjects(request.grantType, EkoOIDGrantTypeTokenExchange, @"");
+  XCTAssertEqualObjects(request.scope, @"read", @"");
+  XCTAssertEqualObjects(request.additionalParameters[@"subject_token"], @"subject", @"");
+  XCTAssertEqualObjects(request.additionalParameters[@"subject_token_type"],
+                        EkoOIDTokenTypeAccessToken, @"");
+  XCTAssertEqualObjects(request.additionalParameters[@"audience"], @"orders", @"");
+
+  NSString *body = [[NSString alloc] initWithData:request.URLRequest.HTTPBody
+                                         encoding:NSUTF8StringEncoding];
+  XCTAssertTrue([body containsString:@"subject_token=subject"], @"");
+  XCTAssertTrue([body containsString:@"audience=orders"], @"");
+}
+
+/*! @brief Stubs the token endpoint with one which issues a new access token for each request,
+        numbered from 1, which expires in @c expiresIn seconds.
+ */
+- (void)stubTokenEndpointWithExpiresIn:(NSNumber *)expiresIn {
+  __block NSUInteger count = 0;
+  [EkoOIDURLSessionProvider setSession:[OIDTestURLProtocol
+      sessionWithHandler:^id(NSURLRequest *request, NSString *body, NSInteger *statusCode) {
+        NSUInteger number;
+        @synchronized(self) {
+          number = ++count;
+        }
+        return @{
+          @"access_token" : [NSString stringWithFormat:@"access token %lu", (unsigned long)number],
+          @"issued_token_type" : EkoOIDTokenTypeAccessToken,
+          @"token_type" : @"Bearer",
+          @"expires_in" : expiresIn,
+        };
+      }
+           responseDelay:0]];
+}
+
+/*! @brief Returns a token exchange request for a subject token unique to the test, as results are
+        cached for the whole process.
+ */
+- (EkoOIDTokenRequest *)exchangeRequestWithSubjectToken:(NSString *)subjectToken
+                                               audience:(NSString *)audience
+                                                  scope:(NSString *)scope {
+  NSString *uniqueSubjectToken = [NSString stringWithFormat:@"%@ %@", self.name, subjectToken];
+  EkoOIDServiceConfiguration *configuration = [OIDServiceConfigurationTests testInstance];
+  return [[EkoOIDTokenRequest alloc] initWithConfiguration:configuration
+                                                  clientID:@"client"
+                                              clientSecret:nil
+                                              subjectToken:uniqueSubjectToken
+                                          subjectTokenType:EkoOIDTokenTypeAccessToken
+                                                  audience:audience
+                                                     scope:scope
+                                      additionalParameters:nil];
+}
+
+/*! @brief Performs the token exchanges of @c requests without waiting for any of them in between,
+        and returns the access tokens their callbacks are called with, in the order of
+        @c requests.
+ */
+- (NSArray<NSString *> *)accessTokensFromExchanges:(NSArray<EkoOIDTokenRequest *> *)requests {
+  NSMutableArray<NSString *> *accessTokens = [NSMutableArray array];
+  for (EkoOIDTokenRequest *request in requests) {
+    [accessTokens addObject:@""];
+    NSUInteger index = accessTokens.count - 1;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Exchange completed."];
+    EkoOIDTokenCallback callback = ^(EkoOIDTokenResponse *_Nullable response,
+                                     NSError *_Nullable error) {
+      XCTAssertNil(error, @"");
+      accessTokens[index] = response.accessToken ?: @"";
+      [expectation fulfill];
+    };
+    [EkoOIDAuthorizationService performTokenExchangeRequest:request callback:callback];
+  }
+  [self waitForExpectationsWithTimeout:2 handler:nil];
+  return accessTokens;
+}
+
+/*! @brief Tests that a token exchange result is served from the cache without another request.
+ */
+- (void)testTokenExchangeResultIsCached {
+  [self stubTokenEndpointWithExpiresIn:@3600];
+  EkoOIDTokenRequest *request = [self exchangeRequestWithSubjectToken:@"subject"
+                                                             audience:@"orders"
+                                                                scope:@"read"];
+  XCTAssertEqualObjects([self accessTokensFromExchanges:@[ request ]], @[ @"access token 1" ],
+                        @"");
+  XCTAssertEqualObjects([self accessTokensFromExchanges:@[ request ]], @[ @"access token 1" ],
+                        @"");
+  XCTAssertEqual([OIDTestURLProtocol requestCount], (NSUInteger)1, @"");
+}
+
+/*! @brief Tests that a cached result is no longer served once its token expires within the
+        tolerance of 60 seconds.
+ */
+- (void)testTokenExchangeResultExpiresEarly {
+  [self stubTokenEndpointWithExpiresIn:@60];
+  EkoOIDTokenRequest *request = [self exchangeRequestWithSubjectToken:@"subject"
+                                                             audience:@"orders"
+                                                                scope:@"read"];
+  XCTAssertEqualObjects([self accessTokensFromExchanges:@[ request ]], @[ @"access token 1" ],
+                        @"");
+  XCTAssertEqualObjects([self accessTokensFromExchanges:@[ request ]], @[ @"access token 2" ],
+                        @"");
+  XCTAssertEqual([OIDTestURLProtocol requestCount], (NSUInteger)2, @"");
+
+  // a token which outlives the tolerance is served from the cache
+  [self stubTokenEndpointWithExpiresIn:@120];
+  request = [self exchangeRequestWithSubjectToken:@"longer-lived subject"
+                                         audience:@"orders"
+                                            scope:@"read"];
+  XCTAssertEqualObjects([self accessTokensFromExchanges:@[ request, request ]],
+                        (@[ @"access token 1", @"access token 1" ]), @"");
+  XCTAssertEqualObjects([self accessTokensFromExchanges:@[ request ]], @[ @"access token 1" ],
+                        @"");
+  XCTAssertEqual([OIDTestURLProtocol requestCount], (NSUInteger)1, @"");
+}
+
+/*! @brief Tests that exchanges for a different subject token, audience or scope are cached
+        separately.
+ */
+- (void)testTokenExchangeCacheKeys {
+  [self stubTokenEndpointWithExpiresIn:@3600];
+  NSArray<EkoOIDTokenRequest *> *requests = @[
+    [self exchangeRequestWithSubjectToken:@"subject" audience:@"orders" scope:@"read"],
+    [self exchangeRequestWithSubjectToken:@"other" audience:@"orders" scope:@"read"],
+    [self exchangeRequestWithSubjectToken:@"subject" audience:@"payments" scope:@"read"],
+    [self exchangeRequestWithSubjectToken:@"subject" audience:@"orders" scope:@"write"],
+  ];
+  NSArray<NSString *> *accessTokens = [self accessTokensFromExchanges:requests];
+  XCTAssertEqual([NSSet setWithArray:accessTokens].count, requests.count, @"%@", accessTokens);
+  XCTAssertEqual([OIDTestURLProtocol requestCount], requests.count, @"");
+
+  // each result is cached under its own key
+  XCTAssertEqualObjects([self accessTokensFromExchanges:requests], accessTokens, @"");
+  XCTAssertEqual([OIDTestURLProtocol requestCount], requests.count, @"");
+}
+
+/*! @brief Tests that concurrent exchanges with the same key share a single request.
+ */
+- (void)testConcurrentTokenExchangesShareRequest {
+  [self stubTokenEndpointWithExpiresIn:@3600];
+  NSArray<EkoOIDTokenRequest *> *requests = @[
+    [self exchangeRequestWithSubjectToken:@"subject" audience:@"orders" scope:@"read"],
+    [self exchangeRequestWithSubjectToken:@"subject" audience:@"orders" scope:@"read"],
+    [self exchangeRequestWithSubjectToken:@"subject" audience:@"orders" scope:@"read"],
+  ];
+  XCTAssertEqualObjects([self accessTokensFromExchanges:requests],
+                        (@[ @"access token 1", @"access token 1", @"access token 1" ]), @"");
+  XCTAssertEqual([OIDTestURLProtocol requestCount], (NSUInteger)1, @"");
+}
+
 - (void)testAuthorizationCodeNullRedirectURL {
   OIDAuthorizationResponse *authResponse = [OIDAuthorizationResponseTests testInstance];
   NSArray<NSString *> *scopesArray =
@@ -194,6 +194,58 @@ static NSString *const kTestAdditionalParameterValue = @"example_value";
                         kTestAdditionalParameterValue, @"");
 }
 
+/*! @brief Tests that lazily decoded properties are consistent across threads and unaffected by
+        later changes to the parameters the response was created with.
+ */
+- (void)testLazyDecoding {
+  NSMutableDictionary<NSString *, NSObject<NSCopying> *> *parameters =
+      [@{
+        kAccessTokenKey : kAccessTokenTestValue,
+        kExpiresInKey : @(kExpiresInTestValue),
+        kTestAdditionalParameterKey : kTestAdditionalParameterValue
+      } mutableCopy];
+  EkoOIDTokenResponse *response =
+      [[EkoOIDTokenResponse alloc] initWithRequest:[OIDTokenRequestTests testInstance]
+                                        parameters:parameters];
+  parameters[kAccessTokenKey] = @"changed";
+
+  NSMutableArray<NSDate *> *expirationDates = [NSMutableArray array];
+  dispatch_apply(16, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+    XCTAssertEqualObjects(response.accessToken, kAccessTokenTestValue, @"");
+    XCTAssertEqualObjects(response.additionalParameters[kTestAdditionalParameterKey],
+                          kTestAdditionalParameterValue, @"");
+    @synchronized(expirationDates) {
+      [expirationDates addObject:response.accessTokenExpirationDate];
+    }
+  });
+  XCTAssertEqual([NSSet setWithArray:expirationDates].count, 1u, @"");
+}
+
+/*! @brief Measures constructing token responses from parsed parameters, which exercises the
+        static field table of @c EkoOIDTokenResponse.
+ */
+- (void)testInitializationPerformance {
+  EkoOIDTokenRequest *request = [OIDTokenRequestTests testInstance];
+  NSDictionary<NSString *, NSObject<NSCopying> *> *parameters = @{
+    kAccessTokenKey : kAccessTokenTestValue,
+    kExpiresInKey : @(kExpiresInTestValue),
+    kTokenTypeKey : kTokenTypeTestValue,
+    kIDTokenKey : kIDTokenTestValue,
+    kRefreshTokenKey : kRefreshTokenTestValue,
+    kScopesKey : kScopesTestValue,
+    kTestAdditionalParameterKey : kTestAdditionalParameterValue
+  };
+  [self measureBlock:^{
+    for (NSUInteger i = 0; i < 10000; i++) {
+      @autoreleasepool {
+        EkoOIDTokenResponse *response =
+            [[EkoOIDTokenResponse alloc] initWithRequest:request parameters:parameters];
+        XCTAssertEqualObjects(response.accessToken, kAccessTokenTestValue, @"");
+      }
+    }
+  }];
+}
+
 @end
 
 #pragma GCC diagnostic pop
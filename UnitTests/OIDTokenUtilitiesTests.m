@@ -53,4 +53,32 @@
   XCTAssertEqualObjects([OIDTokenUtilities formUrlEncode:@""], @"", @"");
 }
 
+- (void)testBasicAuthorizationHeaderValue {
+  NSString *value = [EkoOIDTokenUtilities basicAuthorizationHeaderValueWithClientID:@"client id"
+                                                                       clientSecret:@"s:e"];
+  // Base64 of "client+id:s%3Ae".
+  XCTAssertEqualObjects(value, @"Basic Y2xpZW50K2lkOnMlM0Fl", @"");
+}
+
+- (void)testInternedString {
+  NSMutableString *scope = [NSMutableString stringWithString:@"openid profile email"];
+  NSString *interned = [EkoOIDTokenUtilities internedString:scope];
+  XCTAssertEqualObjects(interned, scope, @"");
+  XCTAssertEqual(interned, [EkoOIDTokenUtilities internedString:[scope copy]], @"");
+
+  // The interned string is immutable.
+  [scope appendString:@" phone"];
+  XCTAssertEqualObjects(interned, @"openid profile email", @"");
+
+  XCTAssertNil([EkoOIDTokenUtilities internedString:nil], @"");
+}
+
+- (void)testInternedURL {
+  NSURL *interned = [EkoOIDTokenUtilities internedURL:[NSURL URLWithString:@"https://a.test/token"]];
+  XCTAssertEqual(interned,
+                 [EkoOIDTokenUtilities internedURL:[NSURL URLWithString:@"https://a.test/token"]],
+                 @"");
+  XCTAssertNil([EkoOIDTokenUtilities internedURL:nil], @"");
+}
+
 @end
@@ -166,6 +166,83 @@ static NSString *const kTestURLRoot = @"https://www.example.com/";
   }
 }
 
+/*! @brief Tests that values long enough to take the word-at-a-time paths of the codec are
+        encoded and decoded correctly.
+ */
+- (void)testEncodingLongValues {
+  NSString *value = @"abcdefghABCDEFGH01234567 abcdefgh+ijklmnop%qrstuvwx";
+  EkoOIDURLQueryComponent *query = [[EkoOIDURLQueryComponent alloc] init];
+  [query addParameter:kTestParameterName value:value];
+  NSString *encodedParams = [query URLEncodedParameters];
+  NSString *expected =
+      @"ParameterName=abcdefghABCDEFGH01234567%20abcdefgh%2Bijklmnop%25qrstuvwx";
+  XCTAssertEqualObjects(encodedParams, expected, @"");
+
+  NSString *URLString = [NSString stringWithFormat:@"%@?%@", kTestURLRoot, encodedParams];
+  EkoOIDURLQueryComponent *parsedQuery =
+      [[EkoOIDURLQueryComponent alloc] initWithURL:[NSURL URLWithString:URLString]];
+  XCTAssertEqualObjects([parsedQuery valuesForParameter:kTestParameterName].firstObject,
+                        value, @"");
+}
+
+/*! @brief Tests that parameters are encoded in the order they were added, with dictionaries of
+        parameters added in order of their names.
+ */
+- (void)testParameterOrder {
+  EkoOIDURLQueryComponent *query = [[EkoOIDURLQueryComponent alloc] init];
+  [query addParameter:@"z" value:@"1"];
+  [query addParameter:@"a" value:@"2"];
+  [query addParameter:@"z" value:@"3"];
+  [query addParameters:@{ @"c" : @"5", @"b" : @"4" }];
+  XCTAssertEqualObjects([query URLEncodedParameters], @"z=1&a=2&z=3&b=4&c=5", @"");
+  XCTAssertEqualObjects(query.parameters, (@[ @"z", @"a", @"b", @"c" ]), @"");
+  XCTAssertEqualObjects([query valuesForParameter:@"z"], (@[ @"1", @"3" ]), @"");
+}
+
+/*! @brief Tests parameter lookups once the query is large enough to be indexed.
+ */
+- (void)testManyParameters {
+  EkoOIDURLQueryComponent *query = [[EkoOIDURLQueryComponent alloc] init];
+  for (NSUInteger i = 0; i < 20; i++) {
+    NSString *value = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+    [query addParameter:(i % 2) ? kTestParameterName : kTestParameterName2 value:value];
+  }
+  XCTAssertEqual([query valuesForParameter:kTestParameterName].count, 10, @"");
+  XCTAssertEqualObjects([query valuesForParameter:kTestParameterName2].lastObject, @"18", @"");
+  XCTAssertNil([query valuesForParameter:@"missing"], @"");
+}
+
+/*! @brief Tests that responses returned in the query are read from the query alone.
+ */
+- (void)testParsingRedirectURLWithResponseInQuery {
+  NSURL *URL = [NSURL URLWithString:@"com.example.app:/oauth2redirect?state=abc&code=x%2By"
+                                     "#access_token=t+1&state=ignored"];
+  EkoOIDURLQueryComponent *query =
+      [[EkoOIDURLQueryComponent alloc] initWithRedirectURL:URL responseInFragment:NO];
+  NSDictionary<NSString *, NSObject<NSCopying> *> *expected = @{
+    @"state" : @"abc",
+    @"code" : @"x+y"
+  };
+  XCTAssertEqualObjects(query.dictionaryValue, expected, @"");
+  XCTAssertEqual(query.dictionaryValue, query.dictionaryValue, @"");
+}
+
+/*! @brief Tests that responses returned in the fragment are read from both the fragment and the
+        query, with the fragment taking precedence.
+ */
+- (void)testParsingRedirectURLWithResponseInFragment {
+  NSURL *URL = [NSURL URLWithString:@"com.example.app:/oauth2redirect?app=1&state=ignored"
+                                     "#access_token=t+1&state=abc"];
+  EkoOIDURLQueryComponent *query =
+      [[EkoOIDURLQueryComponent alloc] initWithRedirectURL:URL responseInFragment:YES];
+  NSDictionary<NSString *, NSObject<NSCopying> *> *expected = @{
+    @"app" : @"1",
+    @"state" : @"abc",
+    @"access_token" : @"t 1"
+  };
+  XCTAssertEqualObjects(query.dictionaryValue, expected, @"");
+}
+
 - (void)testAddingTwoParameters {
   OIDURLQueryComponent *query = [[OIDURLQueryComponent alloc] init];
   [query addParameter:kTestParameterName value:kTestParameterValue];